@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <thread>
+#include "hardwareCounters.h"
+#include "src/cache/balanceTable.h"
+#include "src/db/inMemory.h"
+
+// CheckBalance reads of one hot account while a background thread keeps
+// moving money in and out of it: the seqlocked BalanceTable against the
+// stripe locked InMemoryDatabase underneath it
+
+static constexpr int kHotAccount = 1;
+
+class HotAccount {
+public:
+    HotAccount() : db(1024) {
+        db.CreateAccount(kHotAccount, 1e12);
+        db.CreateAccount(2, 1e12);
+        db.SetBalanceObserver([this](int user_id, double balance, int version) {
+            table.Publish(user_id, balance, version);
+        });
+        db.DepositMoney(kHotAccount, 1.0);
+        writer = std::thread([this] {
+            while (!stopping.load(std::memory_order_relaxed)) {
+                db.TransferMoney(kHotAccount, 2, 1.0);
+                db.TransferMoney(2, kHotAccount, 1.0);
+            }
+        });
+    }
+
+    ~HotAccount() {
+        stopping = true;
+        writer.join();
+    }
+
+    InMemoryDatabase db;
+    BalanceTable table{1024};
+
+private:
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+};
+
+static HotAccount* hot;
+
+static void SetUp(const benchmark::State&) {
+    hot = new HotAccount();
+}
+
+static void TearDown(const benchmark::State&) {
+    delete hot;
+}
+
+static void BM_BalanceTableRead(benchmark::State& state) {
+    double balance;
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hot->table.Read(kHotAccount, &balance));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BalanceTableRead)->Setup(SetUp)->Teardown(TearDown)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_LockedGetBalance(benchmark::State& state) {
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hot->db.GetBalance(kHotAccount));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LockedGetBalance)->Setup(SetUp)->Teardown(TearDown)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdlib>
+#include <string>
+#include "tests/temporaryPostgres.h"
+
+// The throwaway Postgres database of the benchmarks. Without
+// PAYMENT_BENCH_DB it lives in a TemporaryPostgres cluster started on
+// first use and removed at exit, tuned by PAYMENT_BENCH_PG_SETTINGS
+// ("synchronous_commit=off,shared_buffers=1GB"). PAYMENT_BENCH_DB names
+// an existing database instead (a libpq connection string); resetting
+// drops its public schema, so never point it at anything that matters.
+
+inline std::string BenchConnectionString() {
+    const char* conn = getenv("PAYMENT_BENCH_DB");
+    if (conn) {
+        return conn;
+    }
+    const char* settings = getenv("PAYMENT_BENCH_PG_SETTINGS");
+    static TemporaryPostgres cluster(TemporaryPostgres::ParseSettings(settings ? settings : ""));
+    return cluster.ConnectionString();
+}
+
+// a fresh schema.sql with accounts 1..accounts holding balance each
+inline void ResetBenchDatabase(pqxx::connection& conn, int accounts, double balance) {
+    ResetPaymentSchema(conn, PAYMENT_SCHEMA, accounts, balance);
+}
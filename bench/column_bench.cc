@@ -0,0 +1,125 @@
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <vector>
+#include "hardwareCounters.h"
+#include "src/analytics/columnStore.h"
+
+// Aggregations over a two million row ledger: Transaction rows as
+// GetTransactions returns them, LedgerRecord rows, and the ColumnStore
+// with each kernel set. Bytes are what the layout has to read per pass.
+
+static constexpr int kRows = 2000000;
+static constexpr int kUsers = 100000;
+static constexpr int64_t kStart = 1700000000000000;
+
+struct Ledger {
+    Ledger() : scalar(ScanIsa::Scalar), best(BestScanIsa()) {
+        for (int i = 0; i < kRows; ++i) {
+            LedgerRecord record;
+            std::memset(&record, 0, sizeof(record));
+            record.transaction_id = i + 1;
+            record.sender_id = 1 + (int64_t(i) * 7919) % kUsers;
+            record.receiver_id = 1 + (int64_t(i) * 104729) % kUsers;
+            record.status = kStatusTransfer;
+            record.amount = (i % 10000) / 100.0;
+            record.time_us = kStart + int64_t(i) * 1000;
+            records.push_back(record);
+            rows.push_back(ToTransaction(record));
+            scalar.Append(record);
+            best.Append(record);
+        }
+        // one account's rows over the whole ledger, so every block is decoded
+        query.user_id = 4242;
+    }
+
+    std::vector<LedgerRecord> records;
+    std::vector<Transaction> rows;
+    ColumnStore scalar;
+    ColumnStore best;
+    LedgerQuery query;
+};
+
+static Ledger& Data() {
+    static Ledger ledger;
+    return ledger;
+}
+
+static void BM_TransactionRows(benchmark::State& state) {
+    Ledger& ledger = Data();
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        LedgerTotals totals;
+        for (const Transaction& row : ledger.rows) {
+            if (row.sender_id == ledger.query.user_id || row.receiver_id == ledger.query.user_id) {
+                totals.count++;
+                totals.amount += row.amount;
+            }
+        }
+        benchmark::DoNotOptimize(totals);
+    }
+    state.SetBytesProcessed(state.iterations() * kRows * sizeof(Transaction));
+}
+BENCHMARK(BM_TransactionRows)->Unit(benchmark::kMillisecond);
+
+static void BM_LedgerRecords(benchmark::State& state) {
+    Ledger& ledger = Data();
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        LedgerTotals totals;
+        for (const LedgerRecord& record : ledger.records) {
+            if (record.sender_id == ledger.query.user_id || record.receiver_id == ledger.query.user_id) {
+                totals.count++;
+                totals.amount += record.amount;
+            }
+        }
+        benchmark::DoNotOptimize(totals);
+    }
+    state.SetBytesProcessed(state.iterations() * kRows * sizeof(LedgerRecord));
+}
+BENCHMARK(BM_LedgerRecords)->Unit(benchmark::kMillisecond);
+
+static void ColumnSum(benchmark::State& state, ColumnStore& store) {
+    Ledger& ledger = Data();
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(store.Sum(ledger.query));
+    }
+    state.SetBytesProcessed(state.iterations() * store.EncodedBytes());
+}
+
+static void BM_ColumnSumScalar(benchmark::State& state) {
+    ColumnSum(state, Data().scalar);
+}
+BENCHMARK(BM_ColumnSumScalar)->Unit(benchmark::kMillisecond);
+
+static void BM_ColumnSumBest(benchmark::State& state) {
+    ColumnSum(state, Data().best);
+}
+BENCHMARK(BM_ColumnSumBest)->Unit(benchmark::kMillisecond);
+
+// a time window that cuts two blocks, the rest come from the zone maps
+static void BM_ColumnSumWindow(benchmark::State& state) {
+    Ledger& ledger = Data();
+    LedgerQuery window;
+    window.from_us = kStart + 1000 * 1000;
+    window.to_us = kStart + int64_t(kRows - 1000) * 1000;
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ledger.best.Sum(window));
+    }
+}
+BENCHMARK(BM_ColumnSumWindow)->Unit(benchmark::kMicrosecond);
+
+static void BM_ColumnHistogram(benchmark::State& state) {
+    Ledger& ledger = Data();
+    LedgerQuery query = ledger.query;
+    query.from_us = kStart;
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ledger.best.Histogram(query, 60000000, 60));
+    }
+    state.SetBytesProcessed(state.iterations() * ledger.best.EncodedBytes());
+}
+BENCHMARK(BM_ColumnHistogram)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "benchDatabase.h"
+#include "src/db/inMemory.h"
+#include "src/db/postgres.h"
+#include "src/load/latencyHistogram.h"
+
+// Concurrent TransferMoney where CONTENTION_HOT_FRACTION of the transfers
+// pay one of CONTENTION_HOT_ACCOUNTS merchant accounts (ids 1..N) and the
+// rest go between uniformly drawn accounts out of CONTENTION_ACCOUNTS.
+// Runs CONTENTION_SECONDS at 1, 2, 4 ... CONTENTION_MAX_THREADS threads
+// and prints one row per step: throughput, latency, the average number of
+// backends waiting on a row lock (sampled from pg_stat_activity), and the
+// transfers Postgres aborted as deadlocks or serialization failures.
+//
+// CONTENTION_ENGINE=postgres (the default) runs on the throwaway database
+// of benchDatabase.h with one pooled connection per thread; =memory runs
+// the same workload on InMemoryDatabase, where no lock waits are sampled.
+
+using Clock = std::chrono::steady_clock;
+
+static int env_int(const char* name, int fallback) {
+    const char* value = getenv(name);
+    return value ? std::stoi(value) : fallback;
+}
+
+static double env_double(const char* name, double fallback) {
+    const char* value = getenv(name);
+    return value ? std::stod(value) : fallback;
+}
+
+struct Options {
+    bool postgres;
+    int accounts;
+    int hot_accounts;
+    double hot_fraction;
+    int seconds;
+};
+
+struct Step {
+    int threads = 0;
+    int64_t transfers = 0;
+    int64_t deadlocks = 0;
+    int64_t serialization_failures = 0;
+    int64_t failures = 0;
+    double lock_waiters = -1;
+    LatencyHistogram latency;
+};
+
+static int64_t Micros(Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+static Step Run(IDatabase* db, const Options& options, int threads) {
+    Step step;
+    step.threads = threads;
+    std::mutex mtx;
+    std::atomic<bool> running{true};
+
+    // average backends of this database blocked on a lock, every 10 ms
+    std::thread sampler;
+    double waiter_sum = 0;
+    int samples = 0;
+    if (options.postgres) {
+        sampler = std::thread([&] {
+            pqxx::connection conn(BenchConnectionString());
+            while (running.load()) {
+                pqxx::read_transaction txn(conn);
+                waiter_sum += txn.exec("SELECT count(*) FROM pg_stat_activity "
+                                       "WHERE wait_event_type = 'Lock' AND datname = current_database()")[0][0].as<int>();
+                samples++;
+                txn.commit();
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+    }
+
+    Clock::time_point end = Clock::now() + std::chrono::seconds(options.seconds);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            std::uniform_int_distribution<int> any(1, options.accounts);
+            std::uniform_int_distribution<int> hot(1, options.hot_accounts);
+            std::bernoulli_distribution pays_hot(options.hot_fraction);
+            Step mine;
+            while (Clock::now() < end) {
+                int sender_id = any(rng);
+                int receiver_id = pays_hot(rng) ? hot(rng) : any(rng);
+                Clock::time_point start = Clock::now();
+                try {
+                    db->TransferMoney(sender_id, receiver_id, 1.0);
+                    mine.transfers++;
+                }
+                catch (const pqxx::deadlock_detected&) {
+                    mine.deadlocks++;
+                }
+                catch (const pqxx::serialization_failure&) {
+                    mine.serialization_failures++;
+                }
+                catch (const std::exception&) {
+                    mine.failures++;
+                }
+                mine.latency.Record(Micros(Clock::now() - start));
+            }
+            std::lock_guard<std::mutex> lock(mtx);
+            step.transfers += mine.transfers;
+            step.deadlocks += mine.deadlocks;
+            step.serialization_failures += mine.serialization_failures;
+            step.failures += mine.failures;
+            step.latency.Merge(mine.latency);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    running = false;
+    if (sampler.joinable()) {
+        sampler.join();
+        step.lock_waiters = samples > 0 ? waiter_sum / samples : 0;
+    }
+    return step;
+}
+
+int main() {
+    const char* engine = getenv("CONTENTION_ENGINE");
+    Options options;
+    options.postgres = !engine || std::string(engine) == "postgres";
+    options.accounts = std::max(env_int("CONTENTION_ACCOUNTS", 10000), 2);
+    options.hot_accounts = std::clamp(env_int("CONTENTION_HOT_ACCOUNTS", 1), 1, options.accounts);
+    options.hot_fraction = std::clamp(env_double("CONTENTION_HOT_FRACTION", 0.5), 0.0, 1.0);
+    options.seconds = std::max(env_int("CONTENTION_SECONDS", 5), 1);
+    int max_threads = std::max(env_int("CONTENTION_MAX_THREADS", 64), 1);
+
+    std::unique_ptr<InMemoryDatabase> memory;
+    if (options.postgres) {
+        pqxx::connection conn(BenchConnectionString());
+        ResetBenchDatabase(conn, options.accounts, 1e12);
+    }
+    else {
+        memory = std::make_unique<InMemoryDatabase>(options.accounts + 1);
+        for (int user_id = 1; user_id <= options.accounts; ++user_id) {
+            memory->CreateAccount(user_id, 1e12);
+        }
+    }
+
+    std::cout << (options.postgres ? "Postgres" : "InMemoryDatabase") << ", " << options.accounts << " accounts, "
+              << options.hot_fraction * 100 << "% of transfers to " << options.hot_accounts << " hot account(s), "
+              << options.seconds << " s per step" << std::endl << std::endl;
+    char line[200];
+    std::snprintf(line, sizeof(line), "%7s %12s %9s %9s %9s %12s %9s %9s %8s  %s\n", "threads", "transfers/s",
+                  "p50 ms", "p99 ms", "max ms", "lock waiters", "deadlock", "serializ", "failed", "scaling");
+    std::cout << line;
+
+    std::vector<Step> steps;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        std::unique_ptr<PostgresDatabase> postgres;
+        if (options.postgres) {
+            postgres = std::make_unique<PostgresDatabase>(BenchConnectionString(), threads);
+        }
+        steps.push_back(Run(options.postgres ? static_cast<IDatabase*>(postgres.get()) : memory.get(), options, threads));
+
+        const Step& step = steps.back();
+        double rate = step.transfers / double(options.seconds);
+        // throughput against one thread; the bar is 40 marks long at linear scaling
+        double speedup = rate / std::max(steps.front().transfers / double(options.seconds), 1e-9);
+        std::string bar(static_cast<size_t>(40 * std::min(speedup / threads, 1.0)), '#');
+        char waiters[16] = "-";
+        if (step.lock_waiters >= 0) {
+            std::snprintf(waiters, sizeof(waiters), "%.2f", step.lock_waiters);
+        }
+        std::snprintf(line, sizeof(line), "%7d %12.0f %9.3f %9.3f %9.3f %12s %9lld %9lld %8lld  %5.2fx %s\n",
+                      step.threads, rate, step.latency.ValueAtPercentile(50) / 1000.0,
+                      step.latency.ValueAtPercentile(99) / 1000.0, step.latency.Max() / 1000.0, waiters,
+                      static_cast<long long>(step.deadlocks), static_cast<long long>(step.serialization_failures),
+                      static_cast<long long>(step.failures), speedup, bar.c_str());
+        std::cout << line << std::flush;
+    }
+    return 0;
+}
@@ -0,0 +1,385 @@
+#include <benchmark/benchmark.h>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include "benchDatabase.h"
+#include "hardwareCounters.h"
+#include "proto/payment_service.pb.h"
+#include "src/db/databaseInterface.h"
+
+// What one history row costs on its way from the database to the wire, at
+// 10 to 100k rows per response:
+//
+//   BM_Convert*  rows (std::vector<Transaction>) into the serialized
+//                HistoryResponse bytes gRPC would send. Every variant starts
+//                from a fresh copy of the rows, as GetTransactionHistory gets
+//                them from the database; BM_FreshRows is that copy alone.
+//   BM_Decode*   a pqxx::result of the history query into rows, the loop of
+//                PostgresDatabase::GetTransactions. The results are fetched
+//                once from the throwaway database of benchDatabase.h; without
+//                one these report an error and the rest still runs.
+//
+// time/row is printed with SI prefixes (25n is 25 ns per row), bytes/row
+// is the serialized size. Results go to conversion_bench.json unless
+// --benchmark_out is given.
+
+using google::protobuf::Arena;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::StringOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+static const char* const kStatuses[] = {"transfer", "deposit", "withdrawal"};
+
+// rows as Postgres returns them: growing ids, microsecond timestamps
+// (longer than the small string buffer) and short statuses
+static std::vector<Transaction> MakeRows(int count) {
+    std::mt19937 rng(count);
+    std::uniform_int_distribution<int> account(1, 100000);
+    std::uniform_int_distribution<int> cents(1, 1000000);
+    std::vector<Transaction> rows;
+    rows.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        char timestamp[32];
+        std::snprintf(timestamp, sizeof(timestamp), "2024-%02d-%02d %02d:%02d:%02d.%06d", 1 + i % 12, 1 + i % 28,
+                      i % 24, i % 60, (i / 60) % 60, cents(rng) % 1000000);
+        rows.push_back({1000000 + i, account(rng), account(rng), cents(rng) / 100.0, timestamp, kStatuses[i % 3]});
+    }
+    return rows;
+}
+
+static const std::vector<Transaction>& Rows(int count) {
+    static std::map<int, std::vector<Transaction>> rows;
+    auto it = rows.find(count);
+    if (it == rows.end()) {
+        it = rows.emplace(count, MakeRows(count)).first;
+    }
+    return it->second;
+}
+
+// FillTransaction of paymentService.cc
+static void CopyTransaction(payment::Transaction* transaction, const Transaction& row) {
+    transaction->set_transaction_id(row.transaction_id);
+    transaction->set_sender_id(row.sender_id);
+    transaction->set_receiver_id(row.receiver_id);
+    transaction->set_amount(row.amount);
+    transaction->set_timestamp(row.timestamp);
+    transaction->set_status(row.status);
+}
+
+static void MoveTransaction(payment::Transaction* transaction, Transaction& row) {
+    transaction->set_transaction_id(row.transaction_id);
+    transaction->set_sender_id(row.sender_id);
+    transaction->set_receiver_id(row.receiver_id);
+    transaction->set_amount(row.amount);
+    transaction->set_timestamp(std::move(row.timestamp));
+    transaction->set_status(std::move(row.status));
+}
+
+// payment.Transaction as protobuf lays it out: fields in number order,
+// proto3 defaults left out
+static size_t TransactionSize(const Transaction& row) {
+    size_t size = 0;
+    size += row.transaction_id != 0 ? 1 + WireFormatLite::Int32Size(row.transaction_id) : 0;
+    size += row.sender_id != 0 ? 1 + WireFormatLite::Int32Size(row.sender_id) : 0;
+    size += row.receiver_id != 0 ? 1 + WireFormatLite::Int32Size(row.receiver_id) : 0;
+    size += row.amount != 0 ? 1 + WireFormatLite::kDoubleSize : 0;
+    size += !row.timestamp.empty() ? 1 + WireFormatLite::StringSize(row.timestamp) : 0;
+    size += !row.status.empty() ? 1 + WireFormatLite::StringSize(row.status) : 0;
+    return size;
+}
+
+static void WriteTransaction(const Transaction& row, CodedOutputStream* out) {
+    if (row.transaction_id != 0) {
+        WireFormatLite::WriteInt32(1, row.transaction_id, out);
+    }
+    if (row.sender_id != 0) {
+        WireFormatLite::WriteInt32(2, row.sender_id, out);
+    }
+    if (row.receiver_id != 0) {
+        WireFormatLite::WriteInt32(3, row.receiver_id, out);
+    }
+    if (row.amount != 0) {
+        WireFormatLite::WriteDouble(4, row.amount, out);
+    }
+    if (!row.timestamp.empty()) {
+        WireFormatLite::WriteString(5, row.timestamp, out);
+    }
+    if (!row.status.empty()) {
+        WireFormatLite::WriteString(6, row.status, out);
+    }
+}
+
+// the bytes of a HistoryResponse holding rows, written straight from them
+// without building the message
+static std::string SerializeRows(const std::vector<Transaction>& rows, int latest_transaction_id) {
+    std::vector<uint32_t> sizes;
+    sizes.reserve(rows.size());
+    size_t total = 0;
+    for (const Transaction& row : rows) {
+        sizes.push_back(static_cast<uint32_t>(TransactionSize(row)));
+        total += 1 + CodedOutputStream::VarintSize32(sizes.back()) + sizes.back();
+    }
+    if (latest_transaction_id != 0) {
+        total += 1 + WireFormatLite::Int32Size(latest_transaction_id);
+    }
+    std::string bytes;
+    bytes.reserve(total);
+    {
+        StringOutputStream stream(&bytes);
+        CodedOutputStream out(&stream);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            WireFormatLite::WriteTag(1, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, &out);
+            out.WriteVarint32(sizes[i]);
+            WriteTransaction(rows[i], &out);
+        }
+        if (latest_transaction_id != 0) {
+            WireFormatLite::WriteInt32(2, latest_transaction_id, &out);
+        }
+    }
+    bytes.resize(total);
+    return bytes;
+}
+
+static int Latest(const std::vector<Transaction>& rows) {
+    return rows.empty() ? 0 : rows.back().transaction_id;
+}
+
+template <typename Convert>
+static void RunConversion(benchmark::State& state, Convert convert) {
+    const std::vector<Transaction>& source = Rows(int(state.range(0)));
+    size_t bytes = 0;
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        std::vector<Transaction> rows = source;
+        std::string out = convert(rows);
+        bytes = out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["time/row"] = benchmark::Counter(double(state.range(0)),
+        benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.counters["bytes/row"] = double(bytes) / double(state.range(0));
+}
+
+static void BM_FreshRows(benchmark::State& state) {
+    RunConversion(state, [](std::vector<Transaction>& rows) { return std::string(); });
+}
+
+// GetTransactionHistory as it is
+static void BM_ConvertCopy(benchmark::State& state) {
+    RunConversion(state, [](std::vector<Transaction>& rows) {
+        payment::HistoryResponse response;
+        for (const auto& row : rows) {
+            CopyTransaction(response.add_transactions(), row);
+        }
+        response.set_latest_transaction_id(Latest(rows));
+        return response.SerializeAsString();
+    });
+}
+
+static void BM_ConvertReserve(benchmark::State& state) {
+    RunConversion(state, [](std::vector<Transaction>& rows) {
+        payment::HistoryResponse response;
+        response.mutable_transactions()->Reserve(int(rows.size()));
+        for (const auto& row : rows) {
+            CopyTransaction(response.add_transactions(), row);
+        }
+        response.set_latest_transaction_id(Latest(rows));
+        return response.SerializeAsString();
+    });
+}
+
+// the rows are the handler's own, their strings can be handed over
+static void BM_ConvertMove(benchmark::State& state) {
+    RunConversion(state, [](std::vector<Transaction>& rows) {
+        payment::HistoryResponse response;
+        response.mutable_transactions()->Reserve(int(rows.size()));
+        int latest = Latest(rows);
+        for (auto& row : rows) {
+            MoveTransaction(response.add_transactions(), row);
+        }
+        response.set_latest_transaction_id(latest);
+        return response.SerializeAsString();
+    });
+}
+
+// one arena per response: the messages are carved out of its blocks and
+// freed together instead of one by one
+static void BM_ConvertArena(benchmark::State& state) {
+    RunConversion(state, [](std::vector<Transaction>& rows) {
+        Arena arena;
+        auto* response = Arena::CreateMessage<payment::HistoryResponse>(&arena);
+        response->mutable_transactions()->Reserve(int(rows.size()));
+        for (const auto& row : rows) {
+            CopyTransaction(response->add_transactions(), row);
+        }
+        response->set_latest_transaction_id(Latest(rows));
+        return response->SerializeAsString();
+    });
+}
+
+// no messages at all: what a custom gRPC serializer for rows would do
+static void BM_ConvertDirect(benchmark::State& state) {
+    RunConversion(state, [](std::vector<Transaction>& rows) { return SerializeRows(rows, Latest(rows)); });
+}
+
+// argument: rows per response
+BENCHMARK(BM_FreshRows)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK(BM_ConvertCopy)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK(BM_ConvertReserve)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK(BM_ConvertMove)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK(BM_ConvertArena)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK(BM_ConvertDirect)->RangeMultiplier(10)->Range(10, 100000);
+
+// history query results by row count, empty when there is no database
+static std::map<int, pqxx::result> results;
+static std::string database_error;
+
+static constexpr int kDecodeSizes[] = {10, 100, 1000, 10000, 100000};
+
+// account i + 1 holds kDecodeSizes[i] rows
+static void LoadResults() {
+    pqxx::connection conn(BenchConnectionString());
+    ResetBenchDatabase(conn, int(std::size(kDecodeSizes)), 1e12);
+    pqxx::work txn(conn);
+    for (int i = 0; i < int(std::size(kDecodeSizes)); ++i) {
+        txn.exec_params("INSERT INTO transactions (sender_id, receiver_id, amount, status, timestamp) "
+                        "SELECT $1, $1, n / 100.0, (ARRAY['transfer', 'deposit', 'withdrawal'])[n % 3 + 1], "
+                        "now() - n * interval '1 second' FROM generate_series(1, $2) n", i + 1, kDecodeSizes[i]);
+    }
+    for (int i = 0; i < int(std::size(kDecodeSizes)); ++i) {
+        results[kDecodeSizes[i]] = txn.exec_params(
+            "SELECT transaction_id, sender_id, receiver_id, amount, timestamp, status FROM transactions "
+            "WHERE sender_id=$1 OR receiver_id=$1", i + 1);
+    }
+    txn.commit();
+}
+
+template <typename Decode>
+static void RunDecode(benchmark::State& state, Decode decode) {
+    auto it = results.find(int(state.range(0)));
+    if (it == results.end()) {
+        state.SkipWithError(("no database: " + database_error).c_str());
+        return;
+    }
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        auto out = decode(it->second);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["time/row"] = benchmark::Counter(double(state.range(0)),
+        benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+// PostgresDatabase::GetTransactions as it is
+static void BM_DecodeByName(benchmark::State& state) {
+    RunDecode(state, [](const pqxx::result& r) {
+        std::vector<Transaction> out;
+        out.reserve(r.size());
+        for (auto const& row : r) {
+            out.push_back({
+                row["transaction_id"].as<int>(),
+                row["sender_id"].as<int>(),
+                row["receiver_id"].as<int>(),
+                row["amount"].as<double>(),
+                row["timestamp"].as<std::string>(),
+                row["status"].as<std::string>()
+            });
+        }
+        return out;
+    });
+}
+
+// no column lookup by name per field
+static void BM_DecodeByIndex(benchmark::State& state) {
+    RunDecode(state, [](const pqxx::result& r) {
+        std::vector<Transaction> out;
+        out.reserve(r.size());
+        for (auto const& row : r) {
+            out.push_back({
+                row[0].as<int>(),
+                row[1].as<int>(),
+                row[2].as<int>(),
+                row[3].as<double>(),
+                std::string(row[4].view()),
+                std::string(row[5].view())
+            });
+        }
+        return out;
+    });
+}
+
+// straight into the response, skipping the Transaction rows
+static void BM_DecodeToResponse(benchmark::State& state) {
+    RunDecode(state, [](const pqxx::result& r) {
+        payment::HistoryResponse response;
+        response.mutable_transactions()->Reserve(int(r.size()));
+        for (auto const& row : r) {
+            payment::Transaction* transaction = response.add_transactions();
+            transaction->set_transaction_id(row[0].as<int>());
+            transaction->set_sender_id(row[1].as<int>());
+            transaction->set_receiver_id(row[2].as<int>());
+            transaction->set_amount(row[3].as<double>());
+            std::string_view timestamp = row[4].view();
+            transaction->set_timestamp(timestamp.data(), timestamp.size());
+            std::string_view status = row[5].view();
+            transaction->set_status(status.data(), status.size());
+        }
+        return response.SerializeAsString();
+    });
+}
+
+// argument: rows per result
+BENCHMARK(BM_DecodeByName)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK(BM_DecodeByIndex)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK(BM_DecodeToResponse)->RangeMultiplier(10)->Range(10, 100000);
+
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+    bool has_out = false;
+    for (int i = 1; i < argc; ++i) {
+        has_out |= std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+    }
+    char out[] = "--benchmark_out=conversion_bench.json";
+    char format[] = "--benchmark_out_format=json";
+    if (!has_out) {
+        args.push_back(out);
+        args.push_back(format);
+    }
+    int count = int(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+
+    // the shortcut has to produce exactly what protobuf does
+    std::vector<Transaction> rows = Rows(1000);
+    payment::HistoryResponse response;
+    for (const auto& row : rows) {
+        CopyTransaction(response.add_transactions(), row);
+    }
+    response.set_latest_transaction_id(Latest(rows));
+    if (SerializeRows(rows, Latest(rows)) != response.SerializeAsString()) {
+        std::cerr << "direct serialization differs from protobuf's" << std::endl;
+        return 1;
+    }
+
+    try {
+        LoadResults();
+    }
+    catch (const std::exception& e) {
+        database_error = e.what();
+        std::cerr << "row decoding is skipped: " << database_error << std::endl;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
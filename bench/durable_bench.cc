@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <random>
+#include <stdlib.h>
+#include "hardwareCounters.h"
+#include "src/db/durable.h"
+
+// durable mutations per second; every operation waits for its fdatasync,
+// so throughput comes from group commit across the benchmark threads
+
+static constexpr int kAccounts = 10000;
+
+static std::unique_ptr<DurableDatabase> db;
+static std::string dir;
+
+static void SetUp(const benchmark::State& state) {
+    char pattern[] = "/tmp/durable_bench_XXXXXX";
+    dir = mkdtemp(pattern);
+    db = std::make_unique<DurableDatabase>(dir, kAccounts, state.range(0), 1);
+    for (int user_id = 1; user_id <= kAccounts; ++user_id) {
+        db->CreateAccount(user_id, 1e12);
+    }
+}
+
+static void TearDown(const benchmark::State&) {
+    db.reset();
+    std::filesystem::remove_all(dir);
+}
+
+static void BM_DurableTransfer(benchmark::State& state) {
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->TransferMoney(account(rng), account(rng), 1.0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+// argument: group commit window in microseconds
+BENCHMARK(BM_DurableTransfer)->Setup(SetUp)->Teardown(TearDown)
+    ->ArgsProduct({{0, 100}})->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_Recovery(benchmark::State& state) {
+    char pattern[] = "/tmp/durable_bench_XXXXXX";
+    std::string recovery_dir = mkdtemp(pattern);
+    {
+        DurableDatabase writer(recovery_dir, kAccounts, 100, 1);
+        for (int user_id = 1; user_id <= kAccounts; ++user_id) {
+            writer.CreateAccount(user_id, 1e12);
+        }
+        writer.Checkpoint();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 32; ++t) {
+            threads.emplace_back([&writer, t] {
+                std::mt19937 rng(t);
+                std::uniform_int_distribution<int> account(1, kAccounts);
+                for (int i = 0; i < 3000; ++i) {
+                    writer.TransferMoney(account(rng), account(rng), 1.0);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        DurableDatabase reader(recovery_dir, kAccounts, 0, state.range(0));
+        benchmark::DoNotOptimize(reader.AccountCount());
+    }
+    std::filesystem::remove_all(recovery_dir);
+}
+// argument: replay threads
+BENCHMARK(BM_Recovery)->RangeMultiplier(2)->Range(1, 8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
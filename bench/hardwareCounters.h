@@ -0,0 +1,149 @@
+#pragma once
+#include <benchmark/benchmark.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+// Hardware counters of a benchmark's timed loop, read through
+// perf_event_open when PAYMENT_BENCH_COUNTERS=1 and added to its counters
+// (and so to the JSON output) per iteration:
+//
+//   cycles/op, instructions/op, IPC, L1d-misses/op (loads),
+//   LLC-misses/op, branch-misses/op, ctx-switches/op
+//
+// Declare one right before the loop:
+//
+//   HardwareCounters hardware(state);
+//   for (auto _ : state) { ... }
+//
+// Each benchmark thread counts itself only, not the threads it hands work
+// to (gRPC's server threads, a group commit writer). Kernel time is
+// included where perf_event_paranoid allows it and left out otherwise.
+// Events the machine or its permissions do not offer (no PMU in a VM,
+// seccomp in a container) are skipped with one note on stderr; counters
+// the kernel had to multiplex are scaled up to the whole loop.
+class HardwareCounters {
+public:
+    explicit HardwareCounters(benchmark::State& state) : state(state) {
+        if (!Enabled()) {
+            return;
+        }
+        for (int i = 0; i < kEvents; ++i) {
+            fds[i] = Open(kEventList[i]);
+        }
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    ~HardwareCounters() {
+        double values[kEvents];
+        bool counted[kEvents] = {};
+        for (int i = 0; i < kEvents; ++i) {
+            if (fds[i] >= 0) {
+                ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                counted[i] = Read(fds[i], &values[i]);
+                close(fds[i]);
+            }
+        }
+        for (int i = 0; i < kEvents; ++i) {
+            if (counted[i]) {
+                state.counters[kEventList[i].name] = benchmark::Counter(values[i], benchmark::Counter::kAvgIterations);
+            }
+        }
+        if (counted[kCycles] && counted[kInstructions] && values[kCycles] > 0) {
+            // summed over threads like the rest, so averaged back
+            state.counters["IPC"] = benchmark::Counter(values[kInstructions] / values[kCycles],
+                                                       benchmark::Counter::kAvgThreads);
+        }
+    }
+
+    HardwareCounters(const HardwareCounters&) = delete;
+    HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+    static bool Enabled() {
+        static const bool enabled = [] {
+            const char* value = getenv("PAYMENT_BENCH_COUNTERS");
+            return value != nullptr && *value != '\0' && std::strcmp(value, "0") != 0;
+        }();
+        return enabled;
+    }
+
+private:
+    struct Event {
+        const char* name;
+        uint32_t type;
+        uint64_t config;
+        // a count limited to user space is not worth reporting
+        bool needs_kernel;
+    };
+
+    enum { kCycles, kInstructions, kEvents = 6 };
+
+    // PERF_TYPE_HW_CACHE config of read misses, to be or'ed with the cache
+    static constexpr uint64_t kReadMisses = (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    static constexpr Event kEventList[kEvents] = {
+        {"cycles/op", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, false},
+        {"instructions/op", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, false},
+        {"L1d-misses/op", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | kReadMisses, false},
+        {"LLC-misses/op", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | kReadMisses, false},
+        {"branch-misses/op", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, false},
+        {"ctx-switches/op", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, true},
+    };
+
+    // a disabled counter of the calling thread, or -1
+    static int Open(const Event& event) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = event.type;
+        attr.config = event.config;
+        attr.disabled = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd < 0 && (errno == EACCES || errno == EPERM) && !event.needs_kernel) {
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+        if (fd < 0) {
+            Skipped(event, errno);
+        }
+        return int(fd);
+    }
+
+    static bool Read(int fd, double* value) {
+        uint64_t data[3];
+        if (read(fd, data, sizeof(data)) != ssize_t(sizeof(data)) || data[2] == 0) {
+            return false;
+        }
+        *value = double(data[0]) * (double(data[1]) / double(data[2]));
+        return true;
+    }
+
+    static void Skipped(const Event& event, int error) {
+        static std::mutex mutex;
+        static bool noted[kEvents] = {};
+        std::lock_guard<std::mutex> lock(mutex);
+        int index = int(&event - kEventList);
+        if (!noted[index]) {
+            noted[index] = true;
+            std::cerr << "hardware counters: no " << event.name << " (" << std::strerror(error) << ")" << std::endl;
+        }
+    }
+
+    benchmark::State& state;
+    int fds[kEvents] = {-1, -1, -1, -1, -1, -1};
+};
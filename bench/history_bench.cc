@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+#include "hardwareCounters.h"
+#include "src/cache/indexedDatabase.h"
+#include "src/db/inMemory.h"
+
+// the last page of an account with a long history: a view over the index
+// against the copying reads of the engine and of IndexedDatabase
+
+static constexpr int kRows = 10000;
+static constexpr int kPage = 20;
+
+class LongHistory {
+public:
+    LongHistory() : db(16), index(64 << 20), indexed(&db, &index) {
+        db.CreateAccount(1, 1e12);
+        db.CreateAccount(2, 1e12);
+        db.SetBalanceObserver([this](int user_id, double balance, int version) {
+            index.Observe(user_id, version);
+        });
+        for (int i = 0; i < kRows; ++i) {
+            db.TransferMoney(1, 2, 1.0);
+        }
+        latest = indexed.GetLatestTransactionId(1);
+    }
+
+    InMemoryDatabase db;
+    HistoryIndex index;
+    IndexedDatabase indexed;
+    int latest = 0;
+};
+
+static LongHistory& History() {
+    static LongHistory history;
+    return history;
+}
+
+static void BM_IndexView(benchmark::State& state) {
+    LongHistory& history = History();
+    HistoryIndex::View view;
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        double total = 0;
+        history.index.Read(1, history.latest - kPage, &view);
+        for (const RecordSpan& span : view.Spans()) {
+            for (const LedgerRecord& record : span) {
+                total += record.amount;
+            }
+        }
+        view.Release();
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * kPage);
+}
+BENCHMARK(BM_IndexView);
+
+static void BM_IndexedGetTransactionsSince(benchmark::State& state) {
+    LongHistory& history = History();
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(history.indexed.GetTransactionsSince(1, history.latest - kPage));
+    }
+    state.SetItemsProcessed(state.iterations() * kPage);
+}
+BENCHMARK(BM_IndexedGetTransactionsSince);
+
+static void BM_EngineGetTransactionsSince(benchmark::State& state) {
+    LongHistory& history = History();
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(history.db.GetTransactionsSince(1, history.latest - kPage));
+    }
+    state.SetItemsProcessed(state.iterations() * kPage);
+}
+BENCHMARK(BM_EngineGetTransactionsSince);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include "hardwareCounters.h"
+#include "src/db/inMemory.h"
+
+// throughput of InMemoryDatabase on uniformly picked accounts, shared by
+// all benchmark threads
+
+static constexpr int kAccounts = 100000;
+
+static InMemoryDatabase& Ledger() {
+    static InMemoryDatabase* db = [] {
+        auto* db = new InMemoryDatabase(kAccounts);
+        for (int user_id = 1; user_id <= kAccounts; ++user_id) {
+            db->CreateAccount(user_id, 1e12);
+        }
+        return db;
+    }();
+    return *db;
+}
+
+static void BM_GetBalance(benchmark::State& state) {
+    InMemoryDatabase& db = Ledger();
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.GetBalance(account(rng)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetBalance)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_DepositMoney(benchmark::State& state) {
+    InMemoryDatabase& db = Ledger();
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        db.DepositMoney(account(rng), 1.0);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DepositMoney)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_TransferMoney(benchmark::State& state) {
+    InMemoryDatabase& db = Ledger();
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.TransferMoney(account(rng), account(rng), 1.0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransferMoney)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_WithdrawMoney(benchmark::State& state) {
+    InMemoryDatabase& db = Ledger();
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.WithdrawMoney(account(rng), 1.0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_WithdrawMoney)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,139 @@
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include "benchDatabase.h"
+#include "hardwareCounters.h"
+#include "src/db/postgres.h"
+
+// PostgresDatabase round trips against the throwaway database of
+// benchDatabase.h, which is rebuilt on start.
+//
+// Results go to payment_bench.json unless --benchmark_out is given:
+//   PAYMENT_BENCH_PG_SETTINGS="synchronous_commit=off" ./payment_bench
+//   PAYMENT_BENCH_DB="host=localhost dbname=payment_bench" ./payment_bench
+//   ./payment_bench --benchmark_filter=Transfer --benchmark_out=transfer.json
+
+static constexpr int kAccounts = 10000;
+// GetTransactions reads accounts holding exactly this many rows
+static constexpr int kHistorySizes[] = {10, 100, 1000, 10000};
+
+static std::unique_ptr<PostgresDatabase> db;
+
+static int HistoryAccount(int rows) {
+    int user_id = kAccounts;
+    for (int size : kHistorySizes) {
+        ++user_id;
+        if (size == rows) {
+            break;
+        }
+    }
+    return user_id;
+}
+
+// kAccounts funded accounts and one account per history size
+static void ResetDatabase() {
+    pqxx::connection conn(BenchConnectionString());
+    ResetBenchDatabase(conn, kAccounts + int(std::size(kHistorySizes)), 1e12);
+    pqxx::work txn(conn);
+    for (int rows : kHistorySizes) {
+        txn.exec_params("INSERT INTO transactions (sender_id, receiver_id, amount, status) "
+                        "SELECT $1, $1, 1, 'deposit' FROM generate_series(1, $2)", HistoryAccount(rows), rows);
+    }
+    txn.commit();
+    pqxx::nontransaction(conn).exec("VACUUM ANALYZE");
+}
+
+// the pool size is the first argument of every benchmark
+static void SetUp(const benchmark::State& state) {
+    db = std::make_unique<PostgresDatabase>(BenchConnectionString(), state.range(0));
+}
+
+static void TearDown(const benchmark::State&) {
+    db.reset();
+}
+
+// opposite transfers between the same pair can deadlock; Postgres aborts
+// one of them and the server would report it as an internal error
+template <typename Operation>
+static void Run(benchmark::State& state, Operation operation) {
+    int64_t rollbacks = 0;
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        try {
+            operation();
+        }
+        catch (const pqxx::transaction_rollback&) {
+            rollbacks++;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["rollbacks"] = benchmark::Counter(double(rollbacks), benchmark::Counter::kIsRate);
+}
+
+static void BM_GetBalance(benchmark::State& state) {
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    Run(state, [&] { benchmark::DoNotOptimize(db->GetBalance(account(rng))); });
+}
+
+static void BM_TransferMoney(benchmark::State& state) {
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    Run(state, [&] { benchmark::DoNotOptimize(db->TransferMoney(account(rng), account(rng), 1.0)); });
+}
+
+static void BM_DepositMoney(benchmark::State& state) {
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    Run(state, [&] { db->DepositMoney(account(rng), 1.0); });
+}
+
+static void BM_WithdrawMoney(benchmark::State& state) {
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    Run(state, [&] { benchmark::DoNotOptimize(db->WithdrawMoney(account(rng), 1.0)); });
+}
+
+// argument: pool size
+BENCHMARK(BM_GetBalance)->Setup(SetUp)->Teardown(TearDown)
+    ->ArgsProduct({{1, 4, 16}})->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_TransferMoney)->Setup(SetUp)->Teardown(TearDown)
+    ->ArgsProduct({{1, 4, 16}})->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_DepositMoney)->Setup(SetUp)->Teardown(TearDown)
+    ->ArgsProduct({{1, 4, 16}})->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_WithdrawMoney)->Setup(SetUp)->Teardown(TearDown)
+    ->ArgsProduct({{1, 4, 16}})->ThreadRange(1, 32)->UseRealTime();
+
+static void BM_GetTransactions(benchmark::State& state) {
+    int user_id = HistoryAccount(state.range(1));
+    Run(state, [&] { benchmark::DoNotOptimize(db->GetTransactions(user_id)); });
+    state.counters["rows"] = double(state.range(1));
+}
+// arguments: pool size, history rows
+BENCHMARK(BM_GetTransactions)->Setup(SetUp)->Teardown(TearDown)
+    ->ArgsProduct({{1, 16}, {10, 100, 1000, 10000}})->ThreadRange(1, 16)->UseRealTime();
+
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+    bool has_out = false;
+    for (int i = 1; i < argc; ++i) {
+        has_out |= std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+    }
+    char out[] = "--benchmark_out=payment_bench.json";
+    char format[] = "--benchmark_out_format=json";
+    if (!has_out) {
+        args.push_back(out);
+        args.push_back(format);
+    }
+    int count = int(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+
+    ResetDatabase();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "hardwareCounters.h"
+#include "src/db/inMemory.h"
+
+// The benchmark set guarded by the perf test (tests/CMakeLists.txt, built
+// with PAYMENT_PERF_TESTS=ON, label perf): the five operations of the
+// service on InMemoryDatabase, one thread, fixed seeds, so that run to run
+// noise stays well below the tolerances of perf_baseline.json.
+// BM_Calibration does a fixed amount of work that does not depend on the
+// service; perf_check.py scales the baseline by its time, which keeps the
+// baseline usable on machines (or noisy neighbours) slower or faster than
+// the one it was taken on.
+
+static constexpr int kAccounts = 100000;
+static constexpr int kHistoryRows = 100;
+// read by BM_GetTransactions only, so its history never grows
+static constexpr int kHistoryAccount = kAccounts + 1;
+
+// a fresh ledger for every run of a benchmark, so the rows one run adds
+// never slow down the next one or its repetitions
+static InMemoryDatabase* ledger;
+
+static void SetUp(const benchmark::State&) {
+    ledger = new InMemoryDatabase(kAccounts + 1);
+    for (int user_id = 1; user_id <= kHistoryAccount; ++user_id) {
+        ledger->CreateAccount(user_id, 1e12);
+    }
+    for (int i = 0; i < kHistoryRows; ++i) {
+        ledger->DepositMoney(kHistoryAccount, 1.0);
+    }
+}
+
+static void TearDown(const benchmark::State&) {
+    delete ledger;
+    ledger = nullptr;
+}
+
+// dependent loads across a table the size of the ledger's, then arithmetic,
+// so the scale follows both the memory and the core of the machine
+static void BM_Calibration(benchmark::State& state) {
+    static std::vector<uint32_t> next = [] {
+        std::vector<uint32_t> order(kAccounts * 16);
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::shuffle(order.begin() + 1, order.end(), std::mt19937(5));
+        // one cycle through every cell
+        std::vector<uint32_t> next(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            next[order[i]] = order[(i + 1) % order.size()];
+        }
+        return next;
+    }();
+    uint32_t cell = 0;
+    uint64_t x = 88172645463325252ull;
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        for (int i = 0; i < 8; ++i) {
+            cell = next[cell];
+        }
+        for (int i = 0; i < 100; ++i) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            benchmark::DoNotOptimize(x);
+        }
+        benchmark::DoNotOptimize(cell);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Calibration)->UseRealTime();
+
+static void BM_TransferMoney(benchmark::State& state) {
+    InMemoryDatabase& db = *ledger;
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.TransferMoney(account(rng), account(rng), 1.0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransferMoney)->Setup(SetUp)->Teardown(TearDown)->UseRealTime();
+
+static void BM_GetBalance(benchmark::State& state) {
+    InMemoryDatabase& db = *ledger;
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.GetBalance(account(rng)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetBalance)->Setup(SetUp)->Teardown(TearDown)->UseRealTime();
+
+static void BM_GetTransactions(benchmark::State& state) {
+    InMemoryDatabase& db = *ledger;
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.GetTransactions(kHistoryAccount));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetTransactions)->Setup(SetUp)->Teardown(TearDown)->UseRealTime();
+
+static void BM_DepositMoney(benchmark::State& state) {
+    InMemoryDatabase& db = *ledger;
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        db.DepositMoney(account(rng), 1.0);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DepositMoney)->Setup(SetUp)->Teardown(TearDown)->UseRealTime();
+
+static void BM_WithdrawMoney(benchmark::State& state) {
+    InMemoryDatabase& db = *ledger;
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.WithdrawMoney(account(rng), 1.0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_WithdrawMoney)->Setup(SetUp)->Teardown(TearDown)->UseRealTime();
+
+BENCHMARK_MAIN();
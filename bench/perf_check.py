@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Runs perf_bench and compares it with perf_baseline.json.
+
+Every benchmark of the baseline is checked on the median of a few
+repetitions: its time per operation may rise and its items_per_second may
+drop by at most the benchmark's tolerance (a fraction, default_tolerance
+unless given). The baseline is first scaled by how much slower or faster
+this machine runs the calibration benchmark. Prints one row per check and
+exits 1 when any check fails or a baseline benchmark did not run.
+
+    perf_check.py --bench build/bench/perf_bench --baseline bench/perf_baseline.json
+    perf_check.py --bench ... --baseline ... --update   # rewrite the numbers, keep the tolerances
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+TIME_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def run_bench(bench, repetitions, min_time):
+    with tempfile.TemporaryDirectory() as tmp:
+        out = os.path.join(tmp, "perf.json")
+        subprocess.run([bench, "--benchmark_repetitions=%d" % repetitions,
+                        "--benchmark_report_aggregates_only=true",
+                        "--benchmark_min_time=%g" % min_time,
+                        "--benchmark_out=" + out, "--benchmark_out_format=json"],
+                       check=True, stdout=subprocess.DEVNULL)
+        with open(out) as f:
+            report = json.load(f)
+    medians = {}
+    for run in report["benchmarks"]:
+        if run.get("aggregate_name", "median") != "median" or run.get("error_occurred"):
+            continue
+        medians[run["run_name"]] = {
+            "real_time_ns": run["real_time"] * TIME_UNITS[run["time_unit"]],
+            "items_per_second": run.get("items_per_second", 0.0),
+        }
+    return medians
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--bench", required=True)
+    parser.add_argument("--baseline", required=True)
+    parser.add_argument("--repetitions", type=int, default=5)
+    parser.add_argument("--min-time", type=float, default=0.2)
+    parser.add_argument("--update", action="store_true")
+    args = parser.parse_args()
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    current = run_bench(args.bench, args.repetitions, args.min_time)
+
+    if args.update:
+        for name, result in current.items():
+            entry = baseline["benchmarks"].setdefault(name, {})
+            entry["real_time_ns"] = round(result["real_time_ns"], 1)
+            entry["items_per_second"] = round(result["items_per_second"])
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=4)
+            f.write("\n")
+        print("updated %s with %d benchmarks" % (args.baseline, len(current)))
+        return 0
+
+    calibration = baseline["calibration"]
+    if calibration not in current:
+        print("calibration benchmark %s did not run" % calibration)
+        return 1
+    # > 1 on a slower machine
+    scale = current[calibration]["real_time_ns"] / baseline["benchmarks"][calibration]["real_time_ns"]
+    print("machine speed: %.2fx the baseline's (%s)\n" % (1 / scale, calibration))
+
+    rows = []
+    failed = 0
+    for name, expected in sorted(baseline["benchmarks"].items()):
+        if name == calibration:
+            continue
+        tolerance = expected.get("tolerance", baseline["default_tolerance"])
+        if name not in current:
+            rows.append((name, "-", "-", "-", "-", "%.0f%%" % (tolerance * 100), "MISSING"))
+            failed += 1
+            continue
+        # (metric, baseline, current, whether higher is better)
+        checks = [("ns/op", expected["real_time_ns"] * scale, current[name]["real_time_ns"], False)]
+        if expected.get("items_per_second"):
+            checks.append(("items/s", expected["items_per_second"] / scale, current[name]["items_per_second"], True))
+        for metric, want, got, higher_is_better in checks:
+            change = got / want - 1
+            worse = -change if higher_is_better else change
+            verdict = "REGRESSED" if worse > tolerance else ("improved" if worse < -tolerance else "ok")
+            failed += verdict == "REGRESSED"
+            rows.append((name, metric, "%.4g" % want, "%.4g" % got, "%+.1f%%" % (change * 100),
+                         "%.0f%%" % (tolerance * 100), verdict))
+
+    header = ("benchmark", "metric", "baseline", "current", "change", "allowed", "")
+    widths = [max(len(row[i]) for row in rows + [header]) for i in range(len(header))]
+    for row in [header] + rows:
+        print("  ".join(cell.ljust(width) if i < 2 else cell.rjust(width)
+                        for i, (cell, width) in enumerate(zip(row, widths))).rstrip())
+    if failed:
+        print("\n%d check(s) failed" % failed)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
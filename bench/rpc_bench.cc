@@ -0,0 +1,194 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include "hardwareCounters.h"
+#include "src/paymentService.h"
+
+// The gRPC and protobuf cost of each RPC: PaymentServiceImpl behind an
+// in-process channel, over a database that answers from constants. What
+// is left per call is serialization, the channel, the server's threads
+// and the service code. Besides time, every benchmark reports the heap
+// allocations (count and bytes) of both sides per call, counted by
+// interposing glibc's malloc.
+
+static std::atomic<int64_t> allocations{0};
+static std::atomic<int64_t> allocated_bytes{0};
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+static void CountAllocation(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+}
+
+void* malloc(size_t size) noexcept {
+    CountAllocation(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    CountAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) noexcept {
+    CountAllocation(size);
+    return __libc_realloc(pointer, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+    CountAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    CountAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** pointer, size_t alignment, size_t size) noexcept {
+    CountAllocation(size);
+    *pointer = __libc_memalign(alignment, size);
+    return *pointer ? 0 : ENOMEM;
+}
+}
+
+static constexpr int kHistoryRows = 20;
+
+// every account exists with the same balance and the same short history
+class ConstantDatabase : public IDatabase {
+public:
+    ConstantDatabase() {
+        for (int i = 1; i <= kHistoryRows; ++i) {
+            history.push_back({i, 1, 2, 10.0, "2024-01-01 12:00:00", "transfer"});
+        }
+    }
+
+    int TransferMoney(int sender_id, int receiver_id, double amount) override { return 0; }
+    std::pair<double, bool> GetBalance(int user_id) override { return {1000.0, 0}; }
+    void DepositMoney(int user_id, double amount) override {}
+    int WithdrawMoney(int user_id, double amount) override { return 0; }
+    std::vector<Transaction> GetTransactions(int user_id) override { return history; }
+    std::vector<Transaction> FindTransactions(int user_id, const HistoryFilter& filter) override { return history; }
+    int GetLatestTransactionId(int user_id) override { return kHistoryRows; }
+
+private:
+    std::vector<Transaction> history;
+};
+
+class InProcessServer {
+public:
+    InProcessServer() : bus(256), compression(GRPC_COMPRESS_NONE, 1 << 30, 64), balances(1024),
+                        service(&db, &bus, &compression, &balances) {
+        grpc::ServerBuilder builder;
+        builder.RegisterService(&service);
+        server = builder.BuildAndStart();
+        stub = payment::PaymentService::NewStub(server->InProcessChannel(grpc::ChannelArguments()));
+    }
+
+    ~InProcessServer() {
+        server->Shutdown();
+    }
+
+    ConstantDatabase db;
+    EventBus bus;
+    CompressionPolicy compression;
+    BalanceTable balances;
+    PaymentServiceImpl service;
+    std::unique_ptr<grpc::Server> server;
+    std::unique_ptr<payment::PaymentService::Stub> stub;
+};
+
+static InProcessServer* rpc;
+static int64_t allocations_before;
+static int64_t bytes_before;
+
+static void SetUp(const benchmark::State&) {
+    rpc = new InProcessServer();
+}
+
+static void TearDown(const benchmark::State&) {
+    delete rpc;
+}
+
+// the first thread brackets the timed loop, which starts and ends in step
+// on every thread, so the difference covers all threads' calls
+template <typename Call>
+static void Run(benchmark::State& state, Call call) {
+    if (state.thread_index() == 0) {
+        allocations_before = allocations.load();
+        bytes_before = allocated_bytes.load();
+    }
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        grpc::ClientContext context;
+        grpc::Status status = call(&context);
+        if (!status.ok()) {
+            state.SkipWithError(status.error_message().c_str());
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        state.counters["allocs/op"] = benchmark::Counter(double(allocations.load() - allocations_before),
+                                                         benchmark::Counter::kAvgIterations);
+        state.counters["bytes/op"] = benchmark::Counter(double(allocated_bytes.load() - bytes_before),
+                                                        benchmark::Counter::kAvgIterations);
+    }
+}
+
+static void BM_TransferMoney(benchmark::State& state) {
+    payment::TransferRequest request;
+    request.set_sender_id(1);
+    request.set_receiver_id(2);
+    request.set_amount(10.0);
+    payment::TransferResponse response;
+    Run(state, [&](grpc::ClientContext* context) { return rpc->stub->TransferMoney(context, request, &response); });
+}
+
+// answered from the BalanceTable after the first call, as in the server
+static void BM_CheckBalance(benchmark::State& state) {
+    payment::BalanceRequest request;
+    request.set_user_id(1);
+    payment::BalanceResponse response;
+    Run(state, [&](grpc::ClientContext* context) { return rpc->stub->CheckBalance(context, request, &response); });
+}
+
+static void BM_GetTransactionHistory(benchmark::State& state) {
+    payment::HistoryRequest request;
+    request.set_user_id(1);
+    request.set_limit(kHistoryRows);
+    payment::HistoryResponse response;
+    Run(state, [&](grpc::ClientContext* context) {
+        return rpc->stub->GetTransactionHistory(context, request, &response);
+    });
+}
+
+static void BM_DepositMoney(benchmark::State& state) {
+    payment::DepositRequest request;
+    request.set_user_id(1);
+    request.set_amount(10.0);
+    payment::DepositResponse response;
+    Run(state, [&](grpc::ClientContext* context) { return rpc->stub->DepositMoney(context, request, &response); });
+}
+
+static void BM_WithdrawMoney(benchmark::State& state) {
+    payment::WithdrawRequest request;
+    request.set_user_id(1);
+    request.set_amount(10.0);
+    payment::WithdrawResponse response;
+    Run(state, [&](grpc::ClientContext* context) { return rpc->stub->WithdrawMoney(context, request, &response); });
+}
+
+BENCHMARK(BM_TransferMoney)->Setup(SetUp)->Teardown(TearDown)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_CheckBalance)->Setup(SetUp)->Teardown(TearDown)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_GetTransactionHistory)->Setup(SetUp)->Teardown(TearDown)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_DepositMoney)->Setup(SetUp)->Teardown(TearDown)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_WithdrawMoney)->Setup(SetUp)->Teardown(TearDown)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include "hardwareCounters.h"
+#include "src/db/sequenced.h"
+
+// round trips through the sequencer: every call is published into the
+// ring and waits for the applier, so batching shows up as more threads
+
+static constexpr int kAccounts = 100000;
+
+static std::unique_ptr<SequencedDatabase> db;
+
+// arguments: wait strategy (0 spin, 1 yield, 2 block), batch size
+static void SetUp(const benchmark::State& state) {
+    SequencerOptions options;
+    options.wait = static_cast<WaitStrategy>(state.range(0));
+    options.batch_size = state.range(1);
+    db = std::make_unique<SequencedDatabase>(kAccounts, options);
+    for (int user_id = 1; user_id <= kAccounts; ++user_id) {
+        db->CreateAccount(user_id, 1e12);
+    }
+}
+
+static void TearDown(const benchmark::State&) {
+    db.reset();
+}
+
+static void BM_SequencedTransfer(benchmark::State& state) {
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->TransferMoney(account(rng), account(rng), 1.0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SequencedTransfer)->Setup(SetUp)->Teardown(TearDown)
+    ->ArgsProduct({{0, 1, 2}, {1, 256}})->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_SequencedGetBalance(benchmark::State& state) {
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->GetBalance(account(rng)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SequencedGetBalance)->Setup(SetUp)->Teardown(TearDown)
+    ->ArgsProduct({{1, 2}, {256}})->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
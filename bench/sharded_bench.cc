@@ -0,0 +1,41 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include "hardwareCounters.h"
+#include "src/db/sharded.h"
+
+// transfers between uniformly picked accounts; with n shards about
+// (n - 1) / n of them cross shards, so this also prices the message
+// exchange
+
+static constexpr int kAccounts = 100000;
+
+static std::unique_ptr<ShardedDatabase> db;
+
+// argument: number of shards
+static void SetUp(const benchmark::State& state) {
+    ShardOptions options;
+    options.shards = state.range(0);
+    db = std::make_unique<ShardedDatabase>(kAccounts, options);
+    for (int user_id = 1; user_id <= kAccounts; ++user_id) {
+        db->CreateAccount(user_id, 1e12);
+    }
+}
+
+static void TearDown(const benchmark::State&) {
+    db.reset();
+}
+
+static void BM_ShardedTransfer(benchmark::State& state) {
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<int> account(1, kAccounts);
+    HardwareCounters hardware(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db->TransferMoney(account(rng), account(rng), 1.0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ShardedTransfer)->Setup(SetUp)->Teardown(TearDown)
+    ->ArgsProduct({{1, 2, 4, 8}})->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,20 @@
+#include "adminService.h"
+#include <iostream>
+
+grpc::Status AdminServiceImpl::SetFaults(grpc::ServerContext* context, const payment::FaultsRequest* request, payment::FaultsResponse* response) {
+    try {
+        faults->Configure(request->spec(), request->clear());
+    }
+    catch (const std::invalid_argument& e) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, e.what());
+    }
+    response->set_spec(faults->Describe());
+    response->set_message("Faults updated");
+    std::cout << "Database faults: " << (response->spec().empty() ? "none" : response->spec()) << std::endl;
+    return grpc::Status::OK;
+}
+
+grpc::Status AdminServiceImpl::GetFaults(grpc::ServerContext* context, const payment::FaultsRequest* request, payment::FaultsResponse* response) {
+    response->set_spec(faults->Describe());
+    return grpc::Status::OK;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <grpcpp/grpcpp.h>
+#include "proto/payment_service.grpc.pb.h"
+#include "src/db/faultInjecting.h"
+
+class AdminServiceImpl final : public payment::AdminService::Service {
+private:
+    FaultInjectingDatabase* faults;
+public:
+    explicit AdminServiceImpl(FaultInjectingDatabase* fault_injecting) : faults(fault_injecting) {}
+
+    grpc::Status SetFaults(grpc::ServerContext* context, const payment::FaultsRequest* request, payment::FaultsResponse* response) override;
+    grpc::Status GetFaults(grpc::ServerContext* context, const payment::FaultsRequest* request, payment::FaultsResponse* response) override;
+};
@@ -0,0 +1,292 @@
+#include "columnStore.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+int WidthFor(uint64_t range) {
+    if (range <= 0xff) {
+        return 1;
+    }
+    if (range <= 0xffff) {
+        return 2;
+    }
+    return range <= 0xffffffff ? 4 : 8;
+}
+
+// appends the offsets of values from their minimum, little endian
+template <typename T>
+void EncodeColumn(const T* values, size_t rows, std::vector<uint8_t>* data, int64_t* base, uint32_t* offset,
+                  uint8_t* width) {
+    int64_t low = *std::min_element(values, values + rows);
+    int64_t high = *std::max_element(values, values + rows);
+    *base = low;
+    *offset = static_cast<uint32_t>(data->size());
+    *width = static_cast<uint8_t>(WidthFor(static_cast<uint64_t>(high) - static_cast<uint64_t>(low)));
+    data->resize(data->size() + rows * *width);
+    uint8_t* out = data->data() + *offset;
+    for (size_t i = 0; i < rows; ++i, out += *width) {
+        uint64_t delta = static_cast<uint64_t>(static_cast<int64_t>(values[i])) - static_cast<uint64_t>(low);
+        std::memcpy(out, &delta, *width);
+    }
+}
+
+// whole cents that fit the 32 bit lanes of the decoder, or false
+bool ToCents(const std::vector<double>& amounts, std::vector<int64_t>* cents) {
+    cents->resize(amounts.size());
+    for (size_t i = 0; i < amounts.size(); ++i) {
+        double scaled = amounts[i] * 100.0;
+        if (!(std::fabs(scaled) < std::numeric_limits<int32_t>::max())) {
+            return false;
+        }
+        (*cents)[i] = std::llround(scaled);
+        if ((*cents)[i] / 100.0 != amounts[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+void ColumnStore::Rows::Resize(size_t rows) {
+    ids.resize(rows);
+    senders.resize(rows);
+    receivers.resize(rows);
+    times.resize(rows);
+    statuses.resize(rows);
+    amounts.resize(rows);
+}
+
+ColumnBatch ColumnStore::Rows::Batch() const {
+    ColumnBatch batch;
+    batch.rows = Size();
+    batch.time_us = times.data();
+    batch.sender_id = senders.data();
+    batch.receiver_id = receivers.data();
+    batch.status = statuses.data();
+    batch.amount = amounts.data();
+    return batch;
+}
+
+ColumnStore::ColumnStore(ScanIsa isa) : isa(isa) {}
+
+void ColumnStore::Append(const LedgerRecord& record) {
+    open.ids.push_back(record.transaction_id);
+    open.senders.push_back(record.sender_id);
+    open.receivers.push_back(record.receiver_id);
+    open.times.push_back(record.time_us);
+    open.statuses.push_back(record.status);
+    open.amounts.push_back(record.amount);
+    if (open.Size() == kBlockRows) {
+        Seal();
+    }
+}
+
+size_t ColumnStore::EncodedBytes() const {
+    size_t bytes = 0;
+    for (const Block& block : blocks) {
+        bytes += block.data.size();
+    }
+    return bytes;
+}
+
+void ColumnStore::Seal() {
+    size_t rows = open.Size();
+    Block block;
+    block.rows = static_cast<uint32_t>(rows);
+    auto encode = [&block, rows](Column& column, const auto& values) {
+        EncodeColumn(values.data(), rows, &block.data, &column.base, &column.offset, &column.width);
+    };
+    encode(block.ids, open.ids);
+    encode(block.senders, open.senders);
+    encode(block.receivers, open.receivers);
+    encode(block.times, open.times);
+
+    std::vector<int64_t> cents;
+    if (ToCents(open.amounts, &cents)) {
+        encode(block.amounts, cents);
+    }
+    else {
+        block.amounts.offset = static_cast<uint32_t>(block.data.size());
+        block.data.resize(block.data.size() + rows * sizeof(double));
+        std::memcpy(block.data.data() + block.amounts.offset, open.amounts.data(), rows * sizeof(double));
+    }
+    block.statuses = static_cast<uint32_t>(block.data.size());
+    block.data.insert(block.data.end(), open.statuses.begin(), open.statuses.end());
+    block.data.shrink_to_fit();
+
+    auto senders = std::minmax_element(open.senders.begin(), open.senders.end());
+    auto receivers = std::minmax_element(open.receivers.begin(), open.receivers.end());
+    auto times = std::minmax_element(open.times.begin(), open.times.end());
+    block.min_sender = *senders.first;
+    block.max_sender = *senders.second;
+    block.min_receiver = *receivers.first;
+    block.max_receiver = *receivers.second;
+    block.min_time = *times.first;
+    block.max_time = *times.second;
+    block.totals.count = rows;
+    for (double amount : open.amounts) {
+        block.totals.amount += amount;
+    }
+
+    blocks.push_back(std::move(block));
+    sealed_rows += rows;
+    open = Rows();
+}
+
+ColumnStore::Coverage ColumnStore::Covers(const Block& block, const LedgerQuery& query) const {
+    if (block.max_time < query.from_us || block.min_time >= query.to_us) {
+        return None;
+    }
+    if (query.user_id == 0) {
+        return block.min_time >= query.from_us && block.max_time < query.to_us ? All : Some;
+    }
+    bool sender = block.min_sender <= query.user_id && query.user_id <= block.max_sender;
+    bool receiver = block.min_receiver <= query.user_id && query.user_id <= block.max_receiver;
+    switch (query.direction) {
+    case HistoryFilter::Sent:
+        return sender ? Some : None;
+    case HistoryFilter::Received:
+        return receiver ? Some : None;
+    default:
+        return sender || receiver ? Some : None;
+    }
+}
+
+// the account columns go first, a block without the account's rows ends
+// up empty before its times and amounts are touched
+ColumnBatch ColumnStore::Decode(const Block& block, const LedgerQuery& query, bool full, Rows* scratch,
+                                uint8_t* selected) const {
+    const uint8_t* data = block.data.data();
+    auto unpack32 = [&](const Column& column, std::vector<int32_t>& out) {
+        UnpackInt32(data + column.offset, column.width, column.base, block.rows, out.data(), isa);
+    };
+
+    ColumnBatch batch;
+    batch.rows = block.rows;
+    batch.status = data + block.statuses;
+    if (query.user_id != 0 || full) {
+        unpack32(block.senders, scratch->senders);
+        unpack32(block.receivers, scratch->receivers);
+        batch.sender_id = scratch->senders.data();
+        batch.receiver_id = scratch->receivers.data();
+        if (query.user_id != 0 && SelectAccount(batch, query, selected, isa) == 0) {
+            return ColumnBatch();
+        }
+    }
+    UnpackInt64(data + block.times.offset, block.times.width, block.times.base, block.rows,
+                scratch->times.data(), isa);
+    batch.time_us = scratch->times.data();
+    if (block.amounts.width == 0) {
+        std::memcpy(scratch->amounts.data(), data + block.amounts.offset, block.rows * sizeof(double));
+    }
+    else {
+        UnpackCents(data + block.amounts.offset, block.amounts.width, block.amounts.base, block.rows,
+                    scratch->amounts.data(), isa);
+    }
+    batch.amount = scratch->amounts.data();
+    if (full) {
+        unpack32(block.ids, scratch->ids);
+    }
+    return batch;
+}
+
+LedgerTotals ColumnStore::Sum(const LedgerQuery& query) const {
+    LedgerTotals totals;
+    Rows scratch;
+    scratch.Resize(kBlockRows);
+    std::vector<uint8_t> selected(kBlockRows);
+    auto add = [&](const ColumnBatch& batch) {
+        if (SelectRows(batch, query, selected.data(), isa) == 0) {
+            return;
+        }
+        LedgerTotals part = SumSelected(batch.amount, selected.data(), batch.rows, isa);
+        totals.count += part.count;
+        totals.amount += part.amount;
+    };
+
+    for (const Block& block : blocks) {
+        Coverage coverage = Covers(block, query);
+        if (coverage == All) {
+            totals.count += block.totals.count;
+            totals.amount += block.totals.amount;
+        }
+        else if (coverage == Some) {
+            add(Decode(block, query, false, &scratch, selected.data()));
+        }
+    }
+    add(open.Batch());
+    return totals;
+}
+
+std::vector<LedgerTotals> ColumnStore::Histogram(const LedgerQuery& query, int64_t bucket_us, size_t buckets) const {
+    std::vector<LedgerTotals> out(buckets);
+    if (bucket_us <= 0) {
+        return out;
+    }
+    auto bucket_of = [&query, bucket_us](int64_t time_us) {
+        return (static_cast<uint64_t>(time_us) - static_cast<uint64_t>(query.from_us)) / bucket_us;
+    };
+    Rows scratch;
+    scratch.Resize(kBlockRows);
+    std::vector<uint8_t> selected(kBlockRows);
+    auto add = [&](const ColumnBatch& batch) {
+        SelectRows(batch, query, selected.data(), isa);
+        for (size_t i = 0; i < batch.rows; ++i) {
+            uint64_t bucket = bucket_of(batch.time_us[i]);
+            if (selected[i] && bucket < buckets) {
+                out[bucket].count++;
+                out[bucket].amount += batch.amount[i];
+            }
+        }
+    };
+
+    for (const Block& block : blocks) {
+        Coverage coverage = Covers(block, query);
+        if (coverage == All && bucket_of(block.min_time) == bucket_of(block.max_time)) {
+            if (bucket_of(block.min_time) < buckets) {
+                out[bucket_of(block.min_time)].count += block.totals.count;
+                out[bucket_of(block.min_time)].amount += block.totals.amount;
+            }
+        }
+        else if (coverage != None) {
+            add(Decode(block, query, false, &scratch, selected.data()));
+        }
+    }
+    add(open.Batch());
+    return out;
+}
+
+std::vector<LedgerRecord> ColumnStore::Find(const LedgerQuery& query) const {
+    std::vector<LedgerRecord> out;
+    Rows scratch;
+    scratch.Resize(kBlockRows);
+    std::vector<uint8_t> selected(kBlockRows);
+    auto add = [&](const ColumnBatch& batch, const int32_t* ids) {
+        SelectRows(batch, query, selected.data(), isa);
+        for (size_t i = 0; i < batch.rows; ++i) {
+            if (selected[i]) {
+                LedgerRecord record;
+                std::memset(&record, 0, sizeof(record));
+                record.transaction_id = ids[i];
+                record.sender_id = batch.sender_id[i];
+                record.receiver_id = batch.receiver_id[i];
+                record.status = batch.status[i];
+                record.amount = batch.amount[i];
+                record.time_us = batch.time_us[i];
+                out.push_back(record);
+            }
+        }
+    };
+
+    for (const Block& block : blocks) {
+        if (Covers(block, query) != None) {
+            add(Decode(block, query, true, &scratch, selected.data()), scratch.ids.data());
+        }
+    }
+    add(open.Batch(), open.ids.data());
+    return out;
+}
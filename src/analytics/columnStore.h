@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "scanKernels.h"
+#include "src/db/ledgerRecord.h"
+
+// Column oriented copy of the ledger for analytics. Rows are appended into
+// an open block; every kBlockRows rows the block is sealed, and each column
+// is stored frame of reference: the block minimum plus one fixed width
+// (1, 2, 4 or 8 byte) offset per row, so decoding is a widening load the
+// AVX2 kernels do eight or four lanes at a time. Amounts are stored as
+// whole cents when every amount of the block is exactly that, as raw
+// doubles otherwise. Each block keeps a zone map (min/max of every column
+// plus its row count and amount total), so queries skip blocks that cannot
+// match and take whole-block totals without decoding anything.
+//
+// Not synchronized: append and query from one thread, or guard the store.
+class ColumnStore {
+public:
+    static constexpr size_t kBlockRows = 4096;
+
+    explicit ColumnStore(ScanIsa isa = BestScanIsa());
+
+    void Append(const LedgerRecord& record);
+    void Append(const Transaction& row) { Append(ToRecord(row)); }
+
+    size_t Size() const { return sealed_rows + open.Size(); }
+    // bytes held by the sealed blocks' columns
+    size_t EncodedBytes() const;
+
+    LedgerTotals Sum(const LedgerQuery& query) const;
+    // buckets of bucket_us starting at query.from_us, rows past the last
+    // bucket are left out
+    std::vector<LedgerTotals> Histogram(const LedgerQuery& query, int64_t bucket_us, size_t buckets) const;
+    // matching rows in append order
+    std::vector<LedgerRecord> Find(const LedgerQuery& query) const;
+
+private:
+    struct Column {
+        int64_t base = 0;
+        uint32_t offset = 0;
+        // 0 for amounts kept as raw doubles
+        uint8_t width = 0;
+    };
+
+    struct Block {
+        uint32_t rows = 0;
+        int32_t min_sender = 0, max_sender = 0;
+        int32_t min_receiver = 0, max_receiver = 0;
+        int64_t min_time = 0, max_time = 0;
+        LedgerTotals totals;
+        Column ids, senders, receivers, times, amounts;
+        uint32_t statuses = 0;
+        std::vector<uint8_t> data;
+    };
+
+    // decoded columns, for the open block and as scratch of a query
+    struct Rows {
+        std::vector<int32_t> ids, senders, receivers;
+        std::vector<int64_t> times;
+        std::vector<uint8_t> statuses;
+        std::vector<double> amounts;
+
+        size_t Size() const { return ids.size(); }
+        void Resize(size_t rows);
+        ColumnBatch Batch() const;
+    };
+
+    enum Coverage { None, Some, All };
+
+    void Seal();
+    Coverage Covers(const Block& block, const LedgerQuery& query) const;
+    // decodes what query reads into scratch, every column when full; an
+    // empty batch when no row of the block is the query's account
+    ColumnBatch Decode(const Block& block, const LedgerQuery& query, bool full, Rows* scratch,
+                       uint8_t* selected) const;
+
+    ScanIsa isa;
+    std::vector<Block> blocks;
+    size_t sealed_rows = 0;
+    Rows open;
+};
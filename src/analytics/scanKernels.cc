@@ -0,0 +1,317 @@
+#include "scanKernels.h"
+#include <cstring>
+#include "src/db/ledgerRecord.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+template <typename T>
+uint64_t Load(const uint8_t* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+uint64_t Packed(const uint8_t* packed, int width, size_t i) {
+    switch (width) {
+    case 1:
+        return packed[i];
+    case 2:
+        return Load<uint16_t>(packed + 2 * i);
+    case 4:
+        return Load<uint32_t>(packed + 4 * i);
+    default:
+        return Load<uint64_t>(packed + 8 * i);
+    }
+}
+
+// from row begin on; the AVX2 kernels finish their tails with these
+void UnpackInt32Scalar(const uint8_t* packed, int width, int64_t base, size_t begin, size_t rows, int32_t* out) {
+    for (size_t i = begin; i < rows; ++i) {
+        out[i] = static_cast<int32_t>(static_cast<uint64_t>(base) + Packed(packed, width, i));
+    }
+}
+
+void UnpackInt64Scalar(const uint8_t* packed, int width, int64_t base, size_t begin, size_t rows, int64_t* out) {
+    for (size_t i = begin; i < rows; ++i) {
+        out[i] = static_cast<int64_t>(static_cast<uint64_t>(base) + Packed(packed, width, i));
+    }
+}
+
+void UnpackCentsScalar(const uint8_t* packed, int width, int64_t base, size_t begin, size_t rows, double* out) {
+    for (size_t i = begin; i < rows; ++i) {
+        out[i] = static_cast<int32_t>(static_cast<uint64_t>(base) + Packed(packed, width, i)) / 100.0;
+    }
+}
+
+bool AccountMatches(const ColumnBatch& batch, const LedgerQuery& query, size_t i) {
+    if (query.user_id == 0) {
+        return true;
+    }
+    bool sender = batch.sender_id[i] == query.user_id;
+    bool receiver = batch.receiver_id[i] == query.user_id;
+    switch (query.direction) {
+    case HistoryFilter::Sent:
+        return sender && batch.status[i] != kStatusDeposit;
+    case HistoryFilter::Received:
+        return receiver && batch.status[i] != kStatusWithdrawal;
+    default:
+        return sender || receiver;
+    }
+}
+
+size_t SelectScalar(const ColumnBatch& batch, const LedgerQuery& query, size_t begin, uint8_t* selected) {
+    size_t count = 0;
+    for (size_t i = begin; i < batch.rows; ++i) {
+        bool match = batch.time_us[i] >= query.from_us && batch.time_us[i] < query.to_us &&
+                     AccountMatches(batch, query, i);
+        selected[i] = match ? 0xff : 0;
+        count += match;
+    }
+    return count;
+}
+
+size_t SelectAccountScalar(const ColumnBatch& batch, const LedgerQuery& query, size_t begin, uint8_t* selected) {
+    size_t count = 0;
+    for (size_t i = begin; i < batch.rows; ++i) {
+        bool match = AccountMatches(batch, query, i);
+        selected[i] = match ? 0xff : 0;
+        count += match;
+    }
+    return count;
+}
+
+LedgerTotals SumScalar(const double* amount, const uint8_t* selected, size_t begin, size_t rows) {
+    LedgerTotals totals;
+    for (size_t i = begin; i < rows; ++i) {
+        totals.count += selected[i] & 1;
+        totals.amount += selected[i] ? amount[i] : 0.0;
+    }
+    return totals;
+}
+
+#if defined(__x86_64__)
+
+// the four lanes of a 4 bit movemask as selection bytes
+constexpr uint32_t kExpand[16] = {
+    0x00000000, 0x000000ff, 0x0000ff00, 0x0000ffff, 0x00ff0000, 0x00ff00ff, 0x00ffff00, 0x00ffffff,
+    0xff000000, 0xff0000ff, 0xff00ff00, 0xff00ffff, 0xffff0000, 0xffff00ff, 0xffffff00, 0xffffffff,
+};
+
+__attribute__((target("avx2")))
+__m128i Load4Bytes(const uint8_t* p) {
+    int32_t value;
+    std::memcpy(&value, p, 4);
+    return _mm_cvtsi32_si128(value);
+}
+
+__attribute__((target("avx2")))
+void UnpackInt32Avx2(const uint8_t* packed, int width, int64_t base, size_t rows, int32_t* out) {
+    const __m256i offset = _mm256_set1_epi32(static_cast<int32_t>(base));
+    size_t i = 0;
+    for (; width <= 4 && i + 8 <= rows; i += 8) {
+        __m256i values;
+        if (width == 1) {
+            values = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(packed + i)));
+        }
+        else if (width == 2) {
+            values = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(packed + 2 * i)));
+        }
+        else {
+            values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(packed + 4 * i));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi32(values, offset));
+    }
+    UnpackInt32Scalar(packed, width, base, i, rows, out);
+}
+
+__attribute__((target("avx2")))
+void UnpackInt64Avx2(const uint8_t* packed, int width, int64_t base, size_t rows, int64_t* out) {
+    const __m256i offset = _mm256_set1_epi64x(base);
+    size_t i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        __m256i values;
+        if (width == 1) {
+            values = _mm256_cvtepu8_epi64(Load4Bytes(packed + i));
+        }
+        else if (width == 2) {
+            values = _mm256_cvtepu16_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(packed + 2 * i)));
+        }
+        else if (width == 4) {
+            values = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(packed + 4 * i)));
+        }
+        else {
+            values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(packed + 8 * i));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi64(values, offset));
+    }
+    UnpackInt64Scalar(packed, width, base, i, rows, out);
+}
+
+__attribute__((target("avx2")))
+void UnpackCentsAvx2(const uint8_t* packed, int width, int64_t base, size_t rows, double* out) {
+    const __m128i offset = _mm_set1_epi32(static_cast<int32_t>(base));
+    const __m256d hundred = _mm256_set1_pd(100.0);
+    size_t i = 0;
+    for (; width <= 4 && i + 4 <= rows; i += 4) {
+        __m128i values;
+        if (width == 1) {
+            values = _mm_cvtepu8_epi32(Load4Bytes(packed + i));
+        }
+        else if (width == 2) {
+            values = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(packed + 2 * i)));
+        }
+        else {
+            values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(packed + 4 * i));
+        }
+        __m256d cents = _mm256_cvtepi32_pd(_mm_add_epi32(values, offset));
+        _mm256_storeu_pd(out + i, _mm256_div_pd(cents, hundred));
+    }
+    UnpackCentsScalar(packed, width, base, i, rows, out);
+}
+
+// account part of the query for four rows, as 32 bit lane masks
+__attribute__((target("avx2")))
+__m128i Account4(const ColumnBatch& batch, const LedgerQuery& query, size_t i) {
+    const __m128i user = _mm_set1_epi32(query.user_id);
+    __m128i sender = _mm_loadu_si128(reinterpret_cast<const __m128i*>(batch.sender_id + i));
+    __m128i receiver = _mm_loadu_si128(reinterpret_cast<const __m128i*>(batch.receiver_id + i));
+    sender = _mm_cmpeq_epi32(sender, user);
+    receiver = _mm_cmpeq_epi32(receiver, user);
+    if (query.direction == HistoryFilter::Sent) {
+        __m128i status = _mm_cvtepu8_epi32(Load4Bytes(batch.status + i));
+        return _mm_andnot_si128(_mm_cmpeq_epi32(status, _mm_set1_epi32(kStatusDeposit)), sender);
+    }
+    if (query.direction == HistoryFilter::Received) {
+        __m128i status = _mm_cvtepu8_epi32(Load4Bytes(batch.status + i));
+        return _mm_andnot_si128(_mm_cmpeq_epi32(status, _mm_set1_epi32(kStatusWithdrawal)), receiver);
+    }
+    return _mm_or_si128(sender, receiver);
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t SelectAvx2(const ColumnBatch& batch, const LedgerQuery& query, uint8_t* selected) {
+    const __m256i from = _mm256_set1_epi64x(query.from_us);
+    const __m256i to = _mm256_set1_epi64x(query.to_us);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= batch.rows; i += 4) {
+        __m256i time = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(batch.time_us + i));
+        // from <= time < to
+        __m256i mask = _mm256_andnot_si256(_mm256_cmpgt_epi64(from, time), _mm256_cmpgt_epi64(to, time));
+        if (query.user_id != 0) {
+            mask = _mm256_and_si256(mask, _mm256_cvtepi32_epi64(Account4(batch, query, i)));
+        }
+        int bits = _mm256_movemask_pd(_mm256_castsi256_pd(mask));
+        std::memcpy(selected + i, &kExpand[bits], 4);
+        count += _mm_popcnt_u32(bits);
+    }
+    return count + SelectScalar(batch, query, i, selected);
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t SelectAccountAvx2(const ColumnBatch& batch, const LedgerQuery& query, uint8_t* selected) {
+    size_t count = 0;
+    size_t i = 0;
+    for (; query.user_id != 0 && i + 8 <= batch.rows; i += 8) {
+        __m256i mask = _mm256_set_m128i(Account4(batch, query, i + 4), Account4(batch, query, i));
+        int bits = _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+        std::memcpy(selected + i, &kExpand[bits & 15], 4);
+        std::memcpy(selected + i + 4, &kExpand[bits >> 4], 4);
+        count += _mm_popcnt_u32(bits);
+    }
+    return count + SelectAccountScalar(batch, query, i, selected);
+}
+
+__attribute__((target("avx2,popcnt")))
+LedgerTotals SumAvx2(const double* amount, const uint8_t* selected, size_t rows) {
+    // two accumulators hide the latency of the adds
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    int64_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= rows; i += 8) {
+        __m256d mask0 = _mm256_castsi256_pd(_mm256_cvtepi8_epi64(Load4Bytes(selected + i)));
+        __m256d mask1 = _mm256_castsi256_pd(_mm256_cvtepi8_epi64(Load4Bytes(selected + i + 4)));
+        sum0 = _mm256_add_pd(sum0, _mm256_and_pd(mask0, _mm256_loadu_pd(amount + i)));
+        sum1 = _mm256_add_pd(sum1, _mm256_and_pd(mask1, _mm256_loadu_pd(amount + i + 4)));
+        count += _mm_popcnt_u32(_mm256_movemask_pd(mask0) | (_mm256_movemask_pd(mask1) << 4));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+    LedgerTotals totals = SumScalar(amount, selected, i, rows);
+    totals.count += count;
+    totals.amount += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return totals;
+}
+
+#endif
+
+}
+
+ScanIsa BestScanIsa() {
+#if defined(__x86_64__)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+    if (has_avx2) {
+        return ScanIsa::Avx2;
+    }
+#endif
+    return ScanIsa::Scalar;
+}
+
+void UnpackInt32(const uint8_t* packed, int width, int64_t base, size_t rows, int32_t* out, ScanIsa isa) {
+#if defined(__x86_64__)
+    if (isa == ScanIsa::Avx2) {
+        return UnpackInt32Avx2(packed, width, base, rows, out);
+    }
+#endif
+    UnpackInt32Scalar(packed, width, base, 0, rows, out);
+}
+
+void UnpackInt64(const uint8_t* packed, int width, int64_t base, size_t rows, int64_t* out, ScanIsa isa) {
+#if defined(__x86_64__)
+    if (isa == ScanIsa::Avx2) {
+        return UnpackInt64Avx2(packed, width, base, rows, out);
+    }
+#endif
+    UnpackInt64Scalar(packed, width, base, 0, rows, out);
+}
+
+void UnpackCents(const uint8_t* packed, int width, int64_t base, size_t rows, double* out, ScanIsa isa) {
+#if defined(__x86_64__)
+    if (isa == ScanIsa::Avx2) {
+        return UnpackCentsAvx2(packed, width, base, rows, out);
+    }
+#endif
+    UnpackCentsScalar(packed, width, base, 0, rows, out);
+}
+
+size_t SelectRows(const ColumnBatch& batch, const LedgerQuery& query, uint8_t* selected, ScanIsa isa) {
+#if defined(__x86_64__)
+    if (isa == ScanIsa::Avx2) {
+        return SelectAvx2(batch, query, selected);
+    }
+#endif
+    return SelectScalar(batch, query, 0, selected);
+}
+
+size_t SelectAccount(const ColumnBatch& batch, const LedgerQuery& query, uint8_t* selected, ScanIsa isa) {
+#if defined(__x86_64__)
+    if (isa == ScanIsa::Avx2) {
+        return SelectAccountAvx2(batch, query, selected);
+    }
+#endif
+    return SelectAccountScalar(batch, query, 0, selected);
+}
+
+LedgerTotals SumSelected(const double* amount, const uint8_t* selected, size_t rows, ScanIsa isa) {
+#if defined(__x86_64__)
+    if (isa == ScanIsa::Avx2) {
+        return SumAvx2(amount, selected, rows);
+    }
+#endif
+    return SumScalar(amount, selected, 0, rows);
+}
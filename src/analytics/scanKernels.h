@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "src/db/databaseInterface.h"
+
+// Rows of an account and a time range. user_id 0 selects every account
+// and ignores direction; otherwise direction follows HistoryFilter, so
+// deposits are not sent and withdrawals are not received.
+struct LedgerQuery {
+    int user_id = 0;
+    HistoryFilter::Direction direction = HistoryFilter::Any;
+    int64_t from_us = std::numeric_limits<int64_t>::min();
+    // exclusive
+    int64_t to_us = std::numeric_limits<int64_t>::max();
+};
+
+struct LedgerTotals {
+    int64_t count = 0;
+    double amount = 0;
+};
+
+// Decoded columns of up to one block, as the kernels read them. Columns a
+// query does not look at may be null.
+struct ColumnBatch {
+    size_t rows = 0;
+    const int64_t* time_us = nullptr;
+    const int32_t* sender_id = nullptr;
+    const int32_t* receiver_id = nullptr;
+    const uint8_t* status = nullptr;
+    const double* amount = nullptr;
+};
+
+// Every kernel has a scalar and an AVX2 version; the AVX2 ones are only
+// compiled for x86-64 and must only be picked when the CPU has AVX2.
+enum class ScanIsa { Scalar, Avx2 };
+
+ScanIsa BestScanIsa();
+
+// out[i] = base + the width byte little endian unsigned value at packed[i]
+void UnpackInt32(const uint8_t* packed, int width, int64_t base, size_t rows, int32_t* out, ScanIsa isa);
+void UnpackInt64(const uint8_t* packed, int width, int64_t base, size_t rows, int64_t* out, ScanIsa isa);
+// amounts stored as whole cents
+void UnpackCents(const uint8_t* packed, int width, int64_t base, size_t rows, double* out, ScanIsa isa);
+
+// selected[i] = 0xff when row i matches the query, 0 otherwise; returns
+// the number of rows selected
+size_t SelectRows(const ColumnBatch& batch, const LedgerQuery& query, uint8_t* selected, ScanIsa isa);
+// the same for the account part of the query only, without time_us and
+// amount, so a block can be dropped before they are decoded
+size_t SelectAccount(const ColumnBatch& batch, const LedgerQuery& query, uint8_t* selected, ScanIsa isa);
+LedgerTotals SumSelected(const double* amount, const uint8_t* selected, size_t rows, ScanIsa isa);
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "src/config/environment.h"
+#include "src/db/postgres.h"
+#include "src/db/segment.h"
+
+// Moves transactions older than ARCHIVE_DAYS days out of Postgres into
+// segment files in ARCHIVE_DIR, ARCHIVE_SEGMENT_ROWS rows at most each,
+// then deletes the rows of segments written more than ARCHIVE_GRACE
+// seconds ago. The grace period has to exceed the servers' ARCHIVE_REFRESH
+// so every server maps a segment before its rows leave the table; until
+// then they are read from Postgres. Meant to run periodically, each run
+// continues where the newest segment ends and deleting is idempotent.
+
+static bool SegmentRange(const std::string& path, int* after, int* last) {
+    std::string name = std::filesystem::path(path).filename().string();
+    return std::sscanf(name.c_str(), "segment-%10d-%10d.seg", after, last) == 2;
+}
+
+// archives the oldest rows up to the first one that is not old enough, so
+// segments cover consecutive id ranges; returns the segments written
+static int ArchiveRows(PostgresDatabase& db, const std::string& dir, int after, int64_t cutoff_us,
+                       int segment_rows) {
+    const int batch = 10000;
+    int written = 0;
+    std::vector<LedgerRecord> records;
+    bool done = false;
+    int cursor = after;
+    while (!done) {
+        std::vector<Transaction> rows = db.GetTransactionsAfter(cursor, batch);
+        done = (int)rows.size() < batch;
+        for (const Transaction& row : rows) {
+            LedgerRecord record = ToRecord(row);
+            if (record.time_us >= cutoff_us) {
+                done = true;
+                break;
+            }
+            records.push_back(record);
+            cursor = row.transaction_id;
+            if ((int)records.size() == segment_rows) {
+                std::cout << "Wrote " << WriteSegment(dir, after, cursor, records) << std::endl;
+                written++;
+                after = cursor;
+                records.clear();
+            }
+        }
+    }
+    if (!records.empty()) {
+        std::cout << "Wrote " << WriteSegment(dir, after, cursor, records) << std::endl;
+        written++;
+    }
+    return written;
+}
+
+int main() {
+    load_env();
+    PostgresDatabase db(PostgresConnection());
+
+    const char* dir_env = getenv("ARCHIVE_DIR");
+    std::string dir = dir_env ? dir_env : "archive";
+    std::filesystem::create_directories(dir);
+
+    int after = 0, last = 0;
+    std::vector<std::string> segments = ListSegments(dir);
+    if (!segments.empty()) {
+        SegmentRange(segments.back(), &after, &last);
+    }
+    int64_t cutoff_us = NowMicros() - static_cast<int64_t>(env_int("ARCHIVE_DAYS", 90)) * 86400 * 1000000;
+    ArchiveRows(db, dir, last, cutoff_us, std::max(env_int("ARCHIVE_SEGMENT_ROWS", 1 << 20), 1));
+
+    auto grace = std::chrono::seconds(env_int("ARCHIVE_GRACE", 600));
+    for (const std::string& path : ListSegments(dir)) {
+        auto age = std::filesystem::file_time_type::clock::now() - std::filesystem::last_write_time(path);
+        if (age < grace || !SegmentRange(path, &after, &last)) {
+            continue;
+        }
+        // the rows only leave Postgres once their copy reads back intact
+        try {
+            MappedSegment segment(path);
+            if (segment.AfterTransactionId() != after || segment.LastTransactionId() != last) {
+                throw std::runtime_error("Segment " + path + " does not cover the ids in its name");
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << ", keeping its rows" << std::endl;
+            continue;
+        }
+        int deleted = db.DeleteTransactions(after, last);
+        if (deleted > 0) {
+            std::cout << "Deleted " << deleted << " rows archived in " << path << std::endl;
+        }
+    }
+    return 0;
+}
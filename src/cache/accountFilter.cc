@@ -0,0 +1,52 @@
+#include "accountFilter.h"
+
+AccountFilter::AccountFilter() : pages(new std::atomic<std::atomic<uint64_t>*>[kPages]) {
+    for (size_t i = 0; i < kPages; ++i) {
+        pages[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+AccountFilter::~AccountFilter() {
+    for (size_t i = 0; i < kPages; ++i) {
+        delete[] pages[i].load(std::memory_order_relaxed);
+    }
+}
+
+void AccountFilter::Add(int user_id) {
+    if (user_id <= 0) {
+        return;
+    }
+    std::atomic<std::atomic<uint64_t>*>& slot = pages[user_id / kPageBits];
+    std::atomic<uint64_t>* page = slot.load(std::memory_order_acquire);
+    if (page == nullptr) {
+        std::atomic<uint64_t>* fresh = new std::atomic<uint64_t>[kPageWords]();
+        if (slot.compare_exchange_strong(page, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            page = fresh;
+        }
+        else {
+            delete[] fresh;
+        }
+    }
+    size_t bit = user_id % kPageBits;
+    page[bit / 64].fetch_or(uint64_t(1) << (bit % 64), std::memory_order_release);
+    int seen = highest.load(std::memory_order_relaxed);
+    while (seen < user_id && !highest.compare_exchange_weak(seen, user_id, std::memory_order_acq_rel)) {
+    }
+}
+
+bool AccountFilter::Contains(int user_id) const {
+    if (user_id <= 0) {
+        return false;
+    }
+    const std::atomic<uint64_t>* page = pages[user_id / kPageBits].load(std::memory_order_acquire);
+    if (page == nullptr) {
+        return false;
+    }
+    size_t bit = user_id % kPageBits;
+    return (page[bit / 64].load(std::memory_order_acquire) >> (bit % 64)) & 1;
+}
+
+bool AccountFilter::MayBeUnannounced(int user_id) const {
+    int seen = Highest();
+    return user_id > seen && user_id - seen <= kUnannouncedIds;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Set of the user ids that exist, as a dense bitmap split into pages of
+// kPageBits ids that are allocated on first use, so the whole positive
+// int range is covered and memory is only spent where accounts are.
+// Lock free: Contains is two loads, Add a fetch_or plus, for a new page,
+// one compare and swap. Ids are never removed, but a creation the filter
+// has not heard of yet makes a miss only a "probably does not exist".
+// Account ids come from a serial, so such a creation can only be a little
+// above the highest id added so far.
+class AccountFilter {
+public:
+    static constexpr int kPageBits = 1 << 16;
+    // how far past Highest() a creation still in flight may land
+    static constexpr int kUnannouncedIds = 1024;
+
+    AccountFilter();
+    ~AccountFilter();
+    AccountFilter(const AccountFilter&) = delete;
+    AccountFilter& operator=(const AccountFilter&) = delete;
+
+    void Add(int user_id);
+    bool Contains(int user_id) const;
+    int Highest() const { return highest.load(std::memory_order_acquire); }
+    // a miss that could be a creation the filter has not heard of yet
+    bool MayBeUnannounced(int user_id) const;
+
+    // set once every existing account was added; until then misses prove nothing
+    void MarkLoaded() { loaded.store(true, std::memory_order_release); }
+    // creations may be missed from here on, until the next MarkLoaded
+    void MarkUnloaded() { loaded.store(false, std::memory_order_release); }
+    bool Loaded() const { return loaded.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t kPages = (size_t(1) << 31) / kPageBits;
+    static constexpr size_t kPageWords = kPageBits / 64;
+
+    std::unique_ptr<std::atomic<std::atomic<uint64_t>*>[]> pages;
+    std::atomic<int> highest{0};
+    std::atomic<bool> loaded{false};
+};
@@ -0,0 +1,124 @@
+#include "balanceTable.h"
+#include "src/metrics/metrics.h"
+
+namespace {
+
+uint32_t Mix(int user_id) {
+    uint32_t h = static_cast<uint32_t>(user_id);
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+}
+
+BalanceTable::BalanceTable(size_t capacity)
+    : read_retries(Metrics::Global().Counter("balance_table.read_retries")),
+      misses(Metrics::Global().Counter("balance_table.misses")) {
+    // keep the load factor at or below one half
+    size_t size = 16;
+    while (size < capacity * 2) {
+        size <<= 1;
+    }
+    mask = size - 1;
+    slots.reset(new Slot[size]);
+}
+
+const BalanceTable::Slot* BalanceTable::Find(int user_id) const {
+    for (size_t i = Mix(user_id) & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+        int id = slots[i].user_id.load(std::memory_order_acquire);
+        if (id == user_id) {
+            return &slots[i];
+        }
+        if (id == kEmpty) {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+// writers of the same account take turns on the odd sequence
+template <typename Update>
+void BalanceTable::Write(Slot* slot, Update update) {
+    uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    while ((sequence & 1) != 0 ||
+           !slot->sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire)) {
+        sequence = slot->sequence.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    update();
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool BalanceTable::Publish(int user_id, double balance, int version) {
+    if (user_id == kEmpty) {
+        return false;
+    }
+    Slot* slot = nullptr;
+    for (size_t i = Mix(user_id) & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+        int id = slots[i].user_id.load(std::memory_order_acquire);
+        if (id == kEmpty && slots[i].user_id.compare_exchange_strong(id, user_id, std::memory_order_acq_rel)) {
+            id = user_id;
+        }
+        if (id == user_id) {
+            slot = &slots[i];
+            break;
+        }
+    }
+    if (slot == nullptr) {
+        return false;
+    }
+    if (slot->version.load(std::memory_order_relaxed) >= version) {
+        return true; // already newer, no need to disturb readers
+    }
+
+    Write(slot, [slot, balance, version] {
+        if (slot->version.load(std::memory_order_relaxed) < version) {
+            slot->balance.store(balance, std::memory_order_relaxed);
+            slot->version.store(version, std::memory_order_relaxed);
+        }
+    });
+    return true;
+}
+
+void BalanceTable::Clear() {
+    for (size_t i = 0; i <= mask; ++i) {
+        Slot* slot = &slots[i];
+        if (slot->user_id.load(std::memory_order_acquire) != kEmpty) {
+            Write(slot, [slot] { slot->version.store(-1, std::memory_order_relaxed); });
+        }
+    }
+    bypassed.store(false, std::memory_order_release);
+}
+
+bool BalanceTable::Read(int user_id, double* balance, int* version) const {
+    const Slot* slot = bypassed.load(std::memory_order_acquire) ? nullptr : Find(user_id);
+    if (slot == nullptr) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    while (true) {
+        uint32_t before = slot->sequence.load(std::memory_order_acquire);
+        if ((before & 1) == 0) {
+            double value = slot->balance.load(std::memory_order_relaxed);
+            int seen = slot->version.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->sequence.load(std::memory_order_relaxed) == before) {
+                if (seen < 0) {
+                    // claimed, first value not published yet
+                    misses.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                *balance = value;
+                if (version) {
+                    *version = seen;
+                }
+                return true;
+            }
+        }
+        read_retries.fetch_add(1, std::memory_order_relaxed);
+    }
+}
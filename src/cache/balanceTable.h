@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// In-process copy of account balances for CheckBalance. Entries are fed
+// by the engines' balance observer and published through a per-account
+// seqlock: readers never block and only retry when a writer was in the
+// middle of the same account (counted as balance_table.read_retries).
+// Versions are transaction ids, so a late or duplicate update can never
+// move an entry backwards. Accounts are never removed; a full table just
+// stops caching. Bypass makes every read miss while updates may be
+// missed, Clear forgets every balance once they no longer are.
+class BalanceTable {
+public:
+    explicit BalanceTable(size_t capacity);
+
+    // false when the table is full; versions not newer than the entry's are dropped
+    bool Publish(int user_id, double balance, int version);
+    // false when the account has no entry yet
+    bool Read(int user_id, double* balance, int* version = nullptr) const;
+    // every read misses until the next Clear
+    void Bypass() { bypassed.store(true, std::memory_order_release); }
+    // every account misses until it is published again, at any version
+    void Clear();
+
+private:
+    static constexpr int kEmpty = 0;
+
+    struct alignas(64) Slot {
+        std::atomic<int> user_id{kEmpty};
+        // odd while a writer is inside
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<double> balance{0};
+        std::atomic<int> version{-1};
+    };
+
+    const Slot* Find(int user_id) const;
+    // runs update between the odd and even sequence of slot
+    template <typename Update>
+    static void Write(Slot* slot, Update update);
+
+    size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<bool> bypassed{false};
+    std::atomic<int64_t>& read_retries;
+    std::atomic<int64_t>& misses;
+};
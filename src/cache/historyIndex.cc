@@ -0,0 +1,259 @@
+#include "historyIndex.h"
+#include <algorithm>
+#include <mutex>
+#include "src/metrics/metrics.h"
+
+namespace {
+
+constexpr size_t kMaxBlockBytes = 1 << 20;
+// blocks are small enough that accounts still fit next to them
+constexpr size_t kMinBlocks = 16;
+
+}
+
+size_t HistoryIndex::View::Size() const {
+    size_t size = 0;
+    for (const RecordSpan& span : spans) {
+        size += span.size;
+    }
+    return size;
+}
+
+void HistoryIndex::View::Release() {
+    spans.clear();
+    if (lock.owns_lock()) {
+        lock.unlock();
+    }
+}
+
+HistoryIndex::HistoryIndex(size_t memory_limit, size_t chunk_records)
+    : memory_limit(memory_limit),
+      chunk_records(std::max<size_t>(chunk_records, 1)),
+      hits(Metrics::Global().Counter("history_index.hits")),
+      misses(Metrics::Global().Counter("history_index.misses")),
+      evictions(Metrics::Global().Counter("history_index.evictions")) {
+    static_assert(sizeof(Chunk) % alignof(LedgerRecord) == 0, "records follow the chunk header");
+    chunk_bytes = ChunkBytes(this->chunk_records);
+    block_bytes = std::max(std::min(kMaxBlockBytes, memory_limit / kMinBlocks) / chunk_bytes, size_t(1)) * chunk_bytes;
+}
+
+HistoryIndex::~HistoryIndex() = default;
+
+size_t HistoryIndex::ChunkBytes(size_t chunk_records) {
+    return sizeof(Chunk) + chunk_records * sizeof(LedgerRecord);
+}
+
+// the map node, its bucket and the chunk list of a one chunk account
+size_t HistoryIndex::EntryBytes() {
+    return sizeof(std::pair<const int, Entry>) + 3 * sizeof(void*);
+}
+
+LedgerRecord* HistoryIndex::Records(Chunk* chunk) const {
+    return reinterpret_cast<LedgerRecord*>(reinterpret_cast<char*>(chunk) + sizeof(Chunk));
+}
+
+HistoryIndex::Lookup HistoryIndex::Read(int user_id, int since_transaction_id, View* view) {
+    view->Release();
+    view->lock = std::shared_lock<std::shared_mutex>(mtx);
+    auto it = entries.find(user_id);
+    if (it == entries.end() || it->second.synced < it->second.known.load(std::memory_order_acquire)) {
+        view->Release();
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return Stale;
+    }
+    const Entry& entry = it->second;
+    // rows at or before covered_after may have gaps, they are never served
+    int after = std::max(since_transaction_id, entry.covered_after);
+    // chunks hold ascending ids, skip the ones entirely at or before it
+    auto chunk = std::upper_bound(entry.chunks.begin(), entry.chunks.end(), after,
+                                  [this](int id, Chunk* chunk) {
+                                      return id < Records(chunk)[chunk->count - 1].transaction_id;
+                                  });
+    for (; chunk != entry.chunks.end(); ++chunk) {
+        const LedgerRecord* first = Records(*chunk);
+        const LedgerRecord* last = first + (*chunk)->count;
+        if (first->transaction_id <= after) {
+            first = std::upper_bound(first, last, after, [](int id, const LedgerRecord& record) {
+                return id < record.transaction_id;
+            });
+        }
+        view->spans.push_back({first, static_cast<size_t>(last - first)});
+    }
+    if (since_transaction_id < entry.covered_after) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return Evicted;
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return Hit;
+}
+
+bool HistoryIndex::Latest(int user_id, int* transaction_id) {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto it = entries.find(user_id);
+    if (it == entries.end() || it->second.synced < it->second.known.load(std::memory_order_acquire)) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    *transaction_id = it->second.last_id;
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void HistoryIndex::Observe(int user_id, int version) {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto it = entries.find(user_id);
+    if (it == entries.end()) {
+        return;
+    }
+    std::atomic<int>& known = it->second.known;
+    int seen = known.load(std::memory_order_relaxed);
+    while (seen < version && !known.compare_exchange_weak(seen, version, std::memory_order_release)) {
+    }
+}
+
+int HistoryIndex::BeginSync(int user_id, int* version) {
+    // the entry exists before the caller reads, so commits from then on
+    // are observed and a read that misses them leaves the entry stale
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        auto it = entries.find(user_id);
+        if (it != entries.end()) {
+            *version = it->second.known.load(std::memory_order_acquire);
+            return it->second.last_id;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    auto it = entries.find(user_id);
+    if (it == entries.end()) {
+        // make room by giving up the accounts with the oldest chunks
+        while (oldest != nullptr && Used() + EntryBytes() > memory_limit) {
+            Chunk* chunk = oldest;
+            Evict(chunk, user_id);
+            chunk->newer = free_chunks;
+            free_chunks = chunk;
+        }
+        if (Used() + EntryBytes() > memory_limit) {
+            // not tracked, so Store drops the rows
+            *version = 0;
+            return 0;
+        }
+        it = entries.try_emplace(user_id).first;
+    }
+    *version = it->second.known.load(std::memory_order_acquire);
+    return it->second.last_id;
+}
+
+bool HistoryIndex::Store(int user_id, const std::vector<Transaction>& rows, int version) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    auto it = entries.find(user_id);
+    if (it == entries.end()) {
+        return true;
+    }
+    Entry& entry = it->second;
+    if (rows.empty() && entry.last_id == 0 && entry.known.load(std::memory_order_acquire) == 0) {
+        // unknown ids must not fill the index
+        entries.erase(it);
+        return false;
+    }
+    for (const Transaction& row : rows) {
+        if (row.transaction_id > entry.last_id) {
+            Append(entry, user_id, ToRecord(row));
+        }
+        else if (row.transaction_id > entry.covered_after && !Holds(entry, row.transaction_id)) {
+            // committed after a newer row another caller stored first: the
+            // rows held up to that one have a gap and are given up
+            entry.covered_after = entry.last_id;
+        }
+        // else another caller stored the same row first
+    }
+    entry.synced = std::max({entry.synced, version, entry.last_id});
+    return true;
+}
+
+bool HistoryIndex::Holds(const Entry& entry, int transaction_id) const {
+    auto chunk = std::lower_bound(entry.chunks.begin(), entry.chunks.end(), transaction_id,
+                                  [this](Chunk* chunk, int id) {
+                                      return Records(chunk)[chunk->count - 1].transaction_id < id;
+                                  });
+    if (chunk == entry.chunks.end()) {
+        return false;
+    }
+    const LedgerRecord* first = Records(*chunk);
+    const LedgerRecord* last = first + (*chunk)->count;
+    const LedgerRecord* record = std::lower_bound(first, last, transaction_id,
+                                                  [](const LedgerRecord& record, int id) {
+                                                      return record.transaction_id < id;
+                                                  });
+    return record != last && record->transaction_id == transaction_id;
+}
+
+size_t HistoryIndex::MemoryUsed() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return Used();
+}
+
+size_t HistoryIndex::Used() const {
+    return blocks.size() * block_bytes + entries.size() * EntryBytes();
+}
+
+void HistoryIndex::Append(Entry& entry, int user_id, const LedgerRecord& record) {
+    if (entry.chunks.empty() || entry.chunks.back()->count == chunk_records) {
+        Chunk* chunk = Allocate(user_id);
+        // the allocation may have evicted this account's own chunks
+        entry.chunks.push_back(chunk);
+    }
+    Chunk* tail = entry.chunks.back();
+    Records(tail)[tail->count++] = record;
+    entry.last_id = record.transaction_id;
+}
+
+HistoryIndex::Chunk* HistoryIndex::Allocate(int user_id) {
+    Chunk* chunk;
+    if (free_chunks != nullptr) {
+        chunk = free_chunks;
+        free_chunks = chunk->newer;
+    }
+    else if (!blocks.empty() && carved + chunk_bytes <= block_bytes) {
+        chunk = reinterpret_cast<Chunk*>(blocks.back().get() + carved);
+        carved += chunk_bytes;
+    }
+    else if (blocks.empty() || Used() + block_bytes <= memory_limit) {
+        blocks.emplace_back(new char[block_bytes]);
+        chunk = reinterpret_cast<Chunk*>(blocks.back().get());
+        carved = chunk_bytes;
+    }
+    else {
+        chunk = oldest;
+        Evict(chunk, user_id);
+    }
+
+    chunk->user_id = user_id;
+    chunk->count = 0;
+    chunk->newer = nullptr;
+    if (newest != nullptr) {
+        newest->newer = chunk;
+    }
+    else {
+        oldest = chunk;
+    }
+    newest = chunk;
+    return chunk;
+}
+
+// chunks of one account are allocated in order, so the oldest chunk in
+// the process is always the first of its account's chunks
+void HistoryIndex::Evict(Chunk* chunk, int keep_user_id) {
+    auto it = entries.find(chunk->user_id);
+    Entry& entry = it->second;
+    entry.chunks.erase(entry.chunks.begin());
+    entry.covered_after = std::max(entry.covered_after, Records(chunk)[chunk->count - 1].transaction_id);
+    if (entry.chunks.empty() && chunk->user_id != keep_user_id) {
+        entries.erase(it);
+    }
+
+    oldest = chunk->newer;
+    if (oldest == nullptr) {
+        newest = nullptr;
+    }
+    evictions.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include "src/db/databaseInterface.h"
+#include "src/db/ledgerRecord.h"
+
+// contiguous run of an account's rows inside one chunk
+struct RecordSpan {
+    const LedgerRecord* data = nullptr;
+    size_t size = 0;
+
+    const LedgerRecord* begin() const { return data; }
+    const LedgerRecord* end() const { return data + size; }
+};
+
+// In-process copy of recent account history. Every account that was read
+// gets an append-only list of fixed size chunks of LedgerRecords, carved
+// out of arena blocks of up to a megabyte. Freshness comes from the same
+// versions as BalanceTable: Observe records the newest transaction id an
+// account is known to have, and an entry holding less than that is stale
+// until the caller stores the missing rows. Accounts and chunks both count
+// against the memory limit; an account a read proves has no history is
+// not kept. When the limit is reached the oldest chunk in the process is
+// recycled, and the account it belonged to is then only complete for rows
+// newer than the evicted ones; older reads go back to the database. An
+// account loses its entry together with its last chunk.
+class HistoryIndex {
+public:
+    enum Lookup { Hit, Stale, Evicted };
+
+    // the account's rows newer than the requested id, oldest first; the
+    // index is read locked for as long as the view holds spans
+    class View {
+    public:
+        const std::vector<RecordSpan>& Spans() const { return spans; }
+        size_t Size() const;
+        void Release();
+
+    private:
+        friend class HistoryIndex;
+
+        std::shared_lock<std::shared_mutex> lock;
+        std::vector<RecordSpan> spans;
+    };
+
+    explicit HistoryIndex(size_t memory_limit, size_t chunk_records = 64);
+    ~HistoryIndex();
+
+    // Hit fills view with the rows after since_transaction_id; Stale when the
+    // account is unknown or behind its version, Evicted when it is current
+    // but no longer holds rows that old, the view then has what is left
+    Lookup Read(int user_id, int since_transaction_id, View* view);
+    // newest transaction id of a current account
+    bool Latest(int user_id, int* transaction_id);
+
+    // called on every commit; accounts nobody read are not tracked
+    void Observe(int user_id, int version);
+    // id to fetch the missing rows after; version receives what the rows
+    // fetched from now on are guaranteed to cover
+    int BeginSync(int user_id, int* version);
+    // rows after BeginSync's id, oldest first, as read from the database;
+    // one older than rows another caller stored meanwhile cannot be put in
+    // order, and the account is then only complete for the rows after those.
+    // False when the rows prove the account has no history; it is dropped.
+    bool Store(int user_id, const std::vector<Transaction>& rows, int version);
+
+    size_t MemoryUsed() const;
+    // what one chunk and one account take out of the limit
+    static size_t ChunkBytes(size_t chunk_records);
+    static size_t EntryBytes();
+
+private:
+    struct Chunk {
+        // allocation order across all accounts
+        Chunk* newer;
+        int user_id;
+        uint32_t count;
+    };
+
+    struct Entry {
+        // oldest first
+        std::vector<Chunk*> chunks;
+        // every row after this id is held, none at or before it is served
+        int covered_after = 0;
+        // newest row held, and the version the rows are known complete to
+        int last_id = 0;
+        int synced = -1;
+        std::atomic<int> known{0};
+    };
+
+    LedgerRecord* Records(Chunk* chunk) const;
+    size_t Used() const;
+    Chunk* Allocate(int user_id);
+    // drops the oldest chunk, and its account with its last one unless
+    // that is keep_user_id
+    void Evict(Chunk* chunk, int keep_user_id);
+    void Append(Entry& entry, int user_id, const LedgerRecord& record);
+    bool Holds(const Entry& entry, int transaction_id) const;
+
+    size_t memory_limit;
+    size_t chunk_records;
+    size_t chunk_bytes;
+    size_t block_bytes;
+
+    mutable std::shared_mutex mtx;
+    std::unordered_map<int, Entry> entries;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t carved = 0;
+    Chunk* oldest = nullptr;
+    Chunk* newest = nullptr;
+    // evicted to make room for an account, linked through newer
+    Chunk* free_chunks = nullptr;
+
+    std::atomic<int64_t>& hits;
+    std::atomic<int64_t>& misses;
+    std::atomic<int64_t>& evictions;
+};
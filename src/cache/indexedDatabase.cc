@@ -0,0 +1,153 @@
+#include "indexedDatabase.h"
+
+namespace {
+
+// the fields a record can be checked on without formatting its timestamp
+bool MayMatch(const LedgerRecord& record, const HistoryFilter& filter, int user_id, uint8_t status) {
+    if (record.transaction_id <= filter.since_transaction_id) {
+        return false;
+    }
+    if (!filter.status.empty() && record.status != status) {
+        return false;
+    }
+    if (filter.direction == HistoryFilter::Sent && record.sender_id != user_id) {
+        return false;
+    }
+    if (filter.direction == HistoryFilter::Received && record.receiver_id != user_id) {
+        return false;
+    }
+    return !(filter.min_amount && record.amount < *filter.min_amount) &&
+           !(filter.max_amount && record.amount > *filter.max_amount);
+}
+
+}
+
+IndexedDatabase::IndexedDatabase(IDatabase* database, HistoryIndex* history_index)
+    : db(database), index(history_index) {}
+
+int IndexedDatabase::TransferMoney(int sender_id, int receiver_id, double amount) {
+    return db->TransferMoney(sender_id, receiver_id, amount);
+}
+
+std::pair<double, bool> IndexedDatabase::GetBalance(int user_id) {
+    return db->GetBalance(user_id);
+}
+
+void IndexedDatabase::DepositMoney(int user_id, double amount) {
+    db->DepositMoney(user_id, amount);
+}
+
+int IndexedDatabase::WithdrawMoney(int user_id, double amount) {
+    return db->WithdrawMoney(user_id, amount);
+}
+
+std::pair<AccountSummary, bool> IndexedDatabase::GetAccountSummary(int user_id, int recent_limit, int window_days) {
+    return db->GetAccountSummary(user_id, recent_limit, window_days);
+}
+
+std::pair<double, bool> IndexedDatabase::GetVersionedBalance(int user_id, int* version) {
+    return db->GetVersionedBalance(user_id, version);
+}
+
+void IndexedDatabase::SetBalanceObserver(BalanceObserver observer) {
+    db->SetBalanceObserver(std::move(observer));
+}
+
+// a stale account gets one catch up query before the index is asked again
+HistoryIndex::Lookup IndexedDatabase::Read(int user_id, int since_transaction_id, HistoryIndex::View* view) {
+    HistoryIndex::Lookup lookup = index->Read(user_id, since_transaction_id, view);
+    if (lookup == HistoryIndex::Stale) {
+        if (!Sync(user_id)) {
+            return HistoryIndex::Hit; // nothing to read, view is empty
+        }
+        lookup = index->Read(user_id, since_transaction_id, view);
+    }
+    return lookup;
+}
+
+bool IndexedDatabase::Sync(int user_id) {
+    int version;
+    int after = index->BeginSync(user_id, &version);
+    return index->Store(user_id, db->GetTransactionsSince(user_id, after), version);
+}
+
+std::vector<Transaction> IndexedDatabase::GetTransactions(int user_id) {
+    return GetTransactionsSince(user_id, 0);
+}
+
+std::vector<Transaction> IndexedDatabase::GetTransactionsSince(int user_id, int since_transaction_id) {
+    HistoryIndex::View view;
+    if (Read(user_id, since_transaction_id, &view) != HistoryIndex::Hit) {
+        view.Release();
+        return db->GetTransactionsSince(user_id, since_transaction_id);
+    }
+    std::vector<Transaction> out;
+    out.reserve(view.Size());
+    for (const RecordSpan& span : view.Spans()) {
+        for (const LedgerRecord& record : span) {
+            out.push_back(ToTransaction(record));
+        }
+    }
+    return out;
+}
+
+// an account the index only partly holds can still answer a newest first
+// page, as long as the page fills up before the evicted rows
+std::vector<Transaction> IndexedDatabase::FindTransactions(int user_id, const HistoryFilter& filter) {
+    HistoryIndex::View view;
+    HistoryIndex::Lookup lookup = Read(user_id, filter.since_transaction_id, &view);
+    bool partial = lookup == HistoryIndex::Evicted && filter.newest_first && filter.limit > 0;
+    if (lookup != HistoryIndex::Hit && !partial) {
+        view.Release();
+        return db->FindTransactions(user_id, filter);
+    }
+
+    uint8_t status = StatusCode(filter.status);
+    std::vector<Transaction> out;
+    auto offer = [&](const LedgerRecord& record) {
+        if (!MayMatch(record, filter, user_id, status)) {
+            return true;
+        }
+        Transaction row = ToTransaction(record);
+        if (filter.Matches(row, user_id)) {
+            out.push_back(std::move(row));
+        }
+        return filter.limit <= 0 || (int)out.size() < filter.limit;
+    };
+
+    const std::vector<RecordSpan>& spans = view.Spans();
+    bool full = false;
+    if (filter.newest_first) {
+        for (auto span = spans.rbegin(); span != spans.rend() && !full; ++span) {
+            for (const LedgerRecord* record = span->end(); record != span->begin() && !full;) {
+                full = !offer(*--record);
+            }
+        }
+    }
+    else {
+        for (auto span = spans.begin(); span != spans.end() && !full; ++span) {
+            for (const LedgerRecord* record = span->begin(); record != span->end() && !full; ++record) {
+                full = !offer(*record);
+            }
+        }
+    }
+    if (partial && !full) {
+        view.Release();
+        return db->FindTransactions(user_id, filter);
+    }
+    return out;
+}
+
+int IndexedDatabase::GetLatestTransactionId(int user_id) {
+    int latest;
+    if (index->Latest(user_id, &latest)) {
+        return latest;
+    }
+    if (!Sync(user_id)) {
+        return 0;
+    }
+    if (index->Latest(user_id, &latest)) {
+        return latest;
+    }
+    return db->GetLatestTransactionId(user_id);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "historyIndex.h"
+#include "src/db/databaseInterface.h"
+
+// Serves history reads of another engine out of a HistoryIndex. The index
+// only learns about commits through Observe, so whoever owns the engine's
+// balance observer (and, on Postgres, the listener) has to feed it.
+// Accounts that are stale are brought up to date with one
+// GetTransactionsSince for the missing rows, which also answers reads of
+// accounts without history; reads older than what the index kept go to
+// the engine unchanged. Everything else is forwarded.
+class IndexedDatabase : public IDatabase {
+public:
+    IndexedDatabase(IDatabase* database, HistoryIndex* history_index);
+
+    int TransferMoney(int sender_id, int receiver_id, double amount) override;
+    std::pair<double, bool> GetBalance(int user_id) override;
+    void DepositMoney(int user_id, double amount) override;
+    int WithdrawMoney(int user_id, double amount) override;
+    std::vector<Transaction> GetTransactions(int user_id) override;
+    std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) override;
+    std::vector<Transaction> FindTransactions(int user_id, const HistoryFilter& filter) override;
+    int GetLatestTransactionId(int user_id) override;
+    std::pair<AccountSummary, bool> GetAccountSummary(int user_id, int recent_limit, int window_days) override;
+    std::pair<double, bool> GetVersionedBalance(int user_id, int* version) override;
+    void SetBalanceObserver(BalanceObserver observer) override;
+
+private:
+    HistoryIndex::Lookup Read(int user_id, int since_transaction_id, HistoryIndex::View* view);
+    // false when the account turned out to have no history
+    bool Sync(int user_id);
+
+    IDatabase* db;
+    HistoryIndex* index;
+};
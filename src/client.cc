@@ -49,14 +49,26 @@ public:
     void GetTransactionHistory(int sender_id){
         payment::HistoryRequest request;
         request.set_user_id(sender_id);
+        if (history_user == sender_id){
+            request.set_since_transaction_id(history_watermark);
+        }
 
         payment::HistoryResponse response;
         grpc::ClientContext context;
 
         grpc::Status status = stub_->GetTransactionHistory(&context, request, &response);
         if (status.ok()){
-            std::cout << "Your history of transactions: " << std::endl;
+            if (history_user != sender_id){
+                history.clear();
+                history_user = sender_id;
+            }
             for (const payment::Transaction& transaction : response.transactions()) {
+                history.push_back(transaction);
+            }
+            history_watermark = response.latest_transaction_id();
+
+            std::cout << "Your history of transactions: " << std::endl;
+            for (const payment::Transaction& transaction : history) {
                 std::cout << "Transaction ID: " << transaction.transaction_id() << std::endl;
                 std::cout << "Sender ID: " << transaction.sender_id() << std::endl;
                 std::cout << "Receiver ID: " << transaction.receiver_id() << std::endl;
@@ -107,8 +119,68 @@ public:
         }
     }
 
+    void GetAccountSummary(int sender_id){
+        payment::SummaryRequest request;
+        request.set_user_id(sender_id);
+        request.set_recent_limit(5);
+        request.set_window_days(30);
+
+        payment::SummaryResponse response;
+        grpc::ClientContext context;
+
+        grpc::Status status = stub_->GetAccountSummary(&context, request, &response);
+        if (status.ok()){
+            std::cout << "Current Balance: " << response.balance() << std::endl;
+            std::cout << "Last 30 days: " << response.transaction_count() << " transactions, "
+                      << response.total_in() << " in, " << response.total_out() << " out" << std::endl;
+            std::cout << "Recent transactions: " << std::endl;
+            for (const payment::Transaction& transaction : response.recent_transactions()) {
+                std::cout << transaction.timestamp() << "  " << transaction.status() << "  " << transaction.amount()
+                          << "  (" << transaction.sender_id() << " -> " << transaction.receiver_id() << ")" << std::endl;
+            }
+        }
+        else{
+            std::cerr << "Operation failed: " << status.error_message() << std::endl;
+        }
+    }
+
+    // blocks and prints balance updates and new transactions as they happen
+    void WatchAccount(int sender_id){
+        int last_seen = 0;
+        while (true){
+            payment::WatchRequest request;
+            request.set_user_id(sender_id);
+            request.set_resume_from_transaction_id(last_seen);
+
+            grpc::ClientContext context;
+            std::unique_ptr<grpc::ClientReader<payment::AccountEvent>> reader(stub_->WatchAccount(&context, request));
+
+            payment::AccountEvent event;
+            while (reader->Read(&event)){
+                std::cout << "Current Balance: " << event.balance() << std::endl;
+                if (event.has_transaction()){
+                    const payment::Transaction& transaction = event.transaction();
+                    std::cout << "New transaction " << transaction.transaction_id() << ": " << transaction.status()
+                              << " " << transaction.amount() << " (" << transaction.sender_id()
+                              << " -> " << transaction.receiver_id() << ")" << std::endl;
+                    last_seen = transaction.transaction_id();
+                }
+            }
+
+            grpc::Status status = reader->Finish();
+            if (status.error_code() != grpc::StatusCode::RESOURCE_EXHAUSTED){
+                std::cerr << "Watch ended: " << status.error_message() << std::endl;
+                return;
+            }
+        }
+    }
+
 private:
     std::unique_ptr<payment::PaymentService::Stub> stub_;
+    // already downloaded history, only newer rows are fetched again
+    std::vector<payment::Transaction> history;
+    int history_user = -1;
+    int history_watermark = 0;
 };
 
 int main(){
@@ -120,6 +192,8 @@ int main(){
         std::cout << "3: To deposit money" << std::endl;
         std::cout << "4: To withdraw money" << std::endl;
         std::cout << "5: To see history of transactions" << std::endl;
+        std::cout << "6: To watch your account" << std::endl;
+        std::cout << "7: To see account summary" << std::endl;
         int command = 0;
         std::cin >> command;
         if (command == 1) {
@@ -154,6 +228,12 @@ int main(){
         else if (command == 5) {
             client.GetTransactionHistory(personal_id);
         }
+        else if (command == 6) {
+            client.WatchAccount(personal_id);
+        }
+        else if (command == 7) {
+            client.GetAccountSummary(personal_id);
+        }
     }
     return 0;
 }
\ No newline at end of file
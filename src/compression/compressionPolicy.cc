@@ -0,0 +1,93 @@
+#include "compressionPolicy.h"
+#include <chrono>
+#include <limits>
+#include <vector>
+#include <zlib.h>
+#include "src/metrics/metrics.h"
+
+CompressionPolicy::CompressionPolicy(grpc_compression_algorithm algorithm, size_t min_bytes, int sample_every)
+    : algorithm(algorithm),
+      min_bytes(min_bytes),
+      sample_every(sample_every),
+      compressed_responses(Metrics::Global().Counter("compression.responses_compressed")),
+      compressed_bytes(Metrics::Global().Counter("compression.bytes_before_compression")),
+      skipped_responses(Metrics::Global().Counter("compression.responses_uncompressed")),
+      sampled_bytes_in(Metrics::Global().Counter("compression.sampled_bytes_in")),
+      sampled_bytes_out(Metrics::Global().Counter("compression.sampled_bytes_out")),
+      sampled_cpu_ns(Metrics::Global().Counter("compression.sampled_cpu_ns")) {
+    const char* name = nullptr;
+    if (grpc_compression_algorithm_name(algorithm, &name) && name) {
+        algorithm_name = name;
+    }
+}
+
+void CompressionPolicy::SetThreshold(const std::string& method, size_t min_bytes) {
+    thresholds[method] = min_bytes;
+}
+
+void CompressionPolicy::Disable(const std::string& method) {
+    thresholds[method] = std::numeric_limits<size_t>::max();
+}
+
+void CompressionPolicy::Apply(grpc::ServerContext* context, const std::string& method, const google::protobuf::Message& response) {
+    if (algorithm == GRPC_COMPRESS_NONE) {
+        return;
+    }
+    auto rule = thresholds.find(method);
+    size_t threshold = rule == thresholds.end() ? min_bytes : rule->second;
+    size_t size = threshold == std::numeric_limits<size_t>::max() ? 0 : response.ByteSizeLong();
+    if (size < threshold || !ClientAccepts(context)) {
+        context->set_compression_algorithm(GRPC_COMPRESS_NONE);
+        skipped_responses.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    context->set_compression_algorithm(algorithm);
+    compressed_responses.fetch_add(1, std::memory_order_relaxed);
+    compressed_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (sample_every > 0 && calls.fetch_add(1, std::memory_order_relaxed) % sample_every == 0) {
+        Sample(response);
+    }
+}
+
+// grpc core also falls back to identity for encodings the peer did not
+// advertise, this only avoids asking for it
+bool CompressionPolicy::ClientAccepts(const grpc::ServerContext* context) const {
+    auto range = context->client_metadata().equal_range("grpc-accept-encoding");
+    if (range.first == range.second) {
+        return true;
+    }
+    for (auto it = range.first; it != range.second; ++it) {
+        std::string encodings(it->second.data(), it->second.size());
+        if (encodings.find(algorithm_name) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CompressionPolicy::Sample(const google::protobuf::Message& response) {
+    std::string bytes = response.SerializeAsString();
+    uLongf out_size = compressBound(bytes.size());
+    std::vector<Bytef> out(out_size);
+
+    auto start = std::chrono::steady_clock::now();
+    if (compress2(out.data(), &out_size, reinterpret_cast<const Bytef*>(bytes.data()), bytes.size(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+        return;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    sampled_bytes_in.fetch_add(bytes.size(), std::memory_order_relaxed);
+    sampled_bytes_out.fetch_add(out_size, std::memory_order_relaxed);
+    sampled_cpu_ns.fetch_add(elapsed.count(), std::memory_order_relaxed);
+}
+
+grpc_compression_algorithm ParseCompressionAlgorithm(const std::string& name) {
+    if (name == "gzip") {
+        return GRPC_COMPRESS_GZIP;
+    }
+    if (name == "deflate") {
+        return GRPC_COMPRESS_DEFLATE;
+    }
+    return GRPC_COMPRESS_NONE;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <grpc/compression.h>
+#include <grpcpp/server_context.h>
+#include <google/protobuf/message.h>
+
+// Chooses per call whether a unary response is worth compressing. Small
+// responses go out as-is; methods can be excluded entirely. A sample of
+// the compressed responses is also deflated locally to report the ratio
+// and CPU cost as compression.* metrics.
+class CompressionPolicy {
+public:
+    CompressionPolicy(grpc_compression_algorithm algorithm, size_t min_bytes, int sample_every);
+
+    void SetThreshold(const std::string& method, size_t min_bytes);
+    void Disable(const std::string& method);
+
+    void Apply(grpc::ServerContext* context, const std::string& method, const google::protobuf::Message& response);
+
+private:
+    bool ClientAccepts(const grpc::ServerContext* context) const;
+    void Sample(const google::protobuf::Message& response);
+
+    grpc_compression_algorithm algorithm;
+    std::string algorithm_name;
+    size_t min_bytes;
+    int sample_every;
+    std::unordered_map<std::string, size_t> thresholds;
+    std::atomic<uint64_t> calls{0};
+
+    std::atomic<int64_t>& compressed_responses;
+    std::atomic<int64_t>& compressed_bytes;
+    std::atomic<int64_t>& skipped_responses;
+    std::atomic<int64_t>& sampled_bytes_in;
+    std::atomic<int64_t>& sampled_bytes_out;
+    std::atomic<int64_t>& sampled_cpu_ns;
+};
+
+// "gzip", "deflate" or "none"
+grpc_compression_algorithm ParseCompressionAlgorithm(const std::string& name);
@@ -0,0 +1,43 @@
+#include "environment.h"
+#include <cstdlib>
+#include <fstream>
+
+void load_env(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) return;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        size_t equal_pos = line.find('=');
+        if (equal_pos != std::string::npos) {
+            std::string key = line.substr(0, equal_pos);
+            std::string value = line.substr(equal_pos + 1);
+            setenv(key.c_str(), value.c_str(), true);
+        }
+    }
+}
+
+int env_int(const char* name, int fallback) {
+    const char* value = getenv(name);
+    return value ? std::stoi(value) : fallback;
+}
+
+double env_double(const char* name, double fallback) {
+    const char* value = getenv(name);
+    return value ? std::stod(value) : fallback;
+}
+
+std::string PostgresConnection() {
+    std::string db_user = getenv("DB_USER");
+    std::string db_pass = getenv("DB_PASSWORD");
+    std::string db_name = getenv("DB_NAME");
+    std::string db_host = getenv("DB_HOST");
+    std::string db_port = getenv("DB_PORT");
+
+    return "user=" + db_user +
+           " password=" + db_pass +
+           " dbname=" + db_name +
+           " host=" + db_host +
+           " port=" + db_port;
+}
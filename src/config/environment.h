@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+
+// Configuration of the binaries: KEY=VALUE lines of a .env file become
+// environment variables (overriding ones already set), which are then read
+// with the fallbacks below.
+
+void load_env(const std::string& filename = ".env");
+int env_int(const char* name, int fallback);
+double env_double(const char* name, double fallback);
+
+// libpq connection string from DB_USER, DB_PASSWORD, DB_NAME, DB_HOST and DB_PORT
+std::string PostgresConnection();
@@ -0,0 +1,233 @@
+#include "archived.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include "src/metrics/metrics.h"
+
+ArchivedDatabase::ArchivedDatabase(IDatabase* database, const std::string& archive_dir)
+    : db(database), dir(archive_dir), archive(std::make_shared<Archive>()),
+      rows_read(Metrics::Global().Counter("archive.rows_read")) {
+    Refresh();
+}
+
+ArchivedDatabase::~ArchivedDatabase() {
+    {
+        std::lock_guard<std::mutex> lock(refresher_mutex);
+        stopping = true;
+    }
+    refresher_cv.notify_all();
+    if (refresher.joinable()) {
+        refresher.join();
+    }
+}
+
+// maps the segments that continue the archive; one that leaves a gap, e.g.
+// because an older one failed to map, stops the refresh until it is fixed
+void ArchivedDatabase::Refresh() {
+    std::lock_guard<std::mutex> refresh_lock(refresh_mutex);
+    std::shared_ptr<const Archive> current = Current();
+    auto next = std::make_shared<Archive>(*current);
+    for (const std::string& path : ListSegments(dir)) {
+        int after, last;
+        std::string name = std::filesystem::path(path).filename().string();
+        if (std::sscanf(name.c_str(), "segment-%10d-%10d.seg", &after, &last) != 2 || last <= next->last_transaction_id) {
+            continue;
+        }
+        if (!next->segments.empty() && after != next->last_transaction_id) {
+            std::cerr << "Archive gap before " << path << std::endl;
+            break;
+        }
+        auto segment = std::make_shared<const MappedSegment>(path);
+        next->last_transaction_id = segment->LastTransactionId();
+        next->segments.push_back(std::move(segment));
+    }
+    if (next->segments.size() != current->segments.size()) {
+        std::lock_guard<std::mutex> lock(archive_mutex);
+        archive = std::move(next);
+    }
+}
+
+void ArchivedDatabase::StartRefresh(int interval_seconds) {
+    refresher = std::thread([this, interval_seconds] {
+        std::unique_lock<std::mutex> lock(refresher_mutex);
+        while (!refresher_cv.wait_for(lock, std::chrono::seconds(interval_seconds), [this] { return stopping; })) {
+            lock.unlock();
+            try {
+                Refresh();
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Archive refresh failed: " << e.what() << std::endl;
+            }
+            lock.lock();
+        }
+    });
+}
+
+std::shared_ptr<const ArchivedDatabase::Archive> ArchivedDatabase::Current() const {
+    std::lock_guard<std::mutex> lock(archive_mutex);
+    return archive;
+}
+
+int ArchivedDatabase::ArchivedThrough() const {
+    return Current()->last_transaction_id;
+}
+
+template <typename Visit>
+void ArchivedDatabase::Scan(const Archive& archive, int user_id, int since_transaction_id, bool newest_first,
+                            Visit visit) {
+    auto by_id = [](const LedgerRecord& record, int id) { return record.transaction_id < id; };
+    size_t count = archive.segments.size();
+    int64_t visited = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const MappedSegment& segment = *archive.segments[newest_first ? count - 1 - i : i];
+        if (segment.LastTransactionId() <= since_transaction_id) {
+            if (newest_first) {
+                break;
+            }
+            continue;
+        }
+        std::pair<const LedgerRecord*, size_t> records = segment.Find(user_id);
+        const LedgerRecord* end = records.first + records.second;
+        const LedgerRecord* begin = std::lower_bound(records.first, end, since_transaction_id + 1, by_id);
+        bool more = true;
+        if (newest_first) {
+            for (const LedgerRecord* record = end; more && record != begin; ++visited) {
+                more = visit(*--record);
+            }
+        }
+        else {
+            for (const LedgerRecord* record = begin; more && record != end; ++record, ++visited) {
+                more = visit(*record);
+            }
+        }
+        if (!more) {
+            break;
+        }
+    }
+    rows_read.fetch_add(visited, std::memory_order_relaxed);
+}
+
+int ArchivedDatabase::TransferMoney(int sender_id, int receiver_id, double amount) {
+    return db->TransferMoney(sender_id, receiver_id, amount);
+}
+
+std::pair<double, bool> ArchivedDatabase::GetBalance(int user_id) {
+    return db->GetBalance(user_id);
+}
+
+void ArchivedDatabase::DepositMoney(int user_id, double amount) {
+    db->DepositMoney(user_id, amount);
+}
+
+int ArchivedDatabase::WithdrawMoney(int user_id, double amount) {
+    return db->WithdrawMoney(user_id, amount);
+}
+
+void ArchivedDatabase::SetBalanceObserver(BalanceObserver observer) {
+    db->SetBalanceObserver(std::move(observer));
+}
+
+std::vector<Transaction> ArchivedDatabase::GetTransactions(int user_id) {
+    return GetTransactionsSince(user_id, 0);
+}
+
+std::vector<Transaction> ArchivedDatabase::GetTransactionsSince(int user_id, int since_transaction_id) {
+    std::shared_ptr<const Archive> current = Current();
+    std::vector<Transaction> out;
+    Scan(*current, user_id, since_transaction_id, false, [&out](const LedgerRecord& record) {
+        out.push_back(ToTransaction(record));
+        return true;
+    });
+    std::vector<Transaction> live =
+        db->GetTransactionsSince(user_id, std::max(since_transaction_id, current->last_transaction_id));
+    if (out.empty()) {
+        return live;
+    }
+    out.insert(out.end(), std::make_move_iterator(live.begin()), std::make_move_iterator(live.end()));
+    return out;
+}
+
+// in the filter's order: the archived rows come first oldest first and
+// last newest first, and the engine is only asked for what the limit leaves
+std::vector<Transaction> ArchivedDatabase::FindTransactions(int user_id, const HistoryFilter& filter) {
+    std::shared_ptr<const Archive> current = Current();
+    if (filter.since_transaction_id >= current->last_transaction_id) {
+        return db->FindTransactions(user_id, filter);
+    }
+    HistoryFilter live = filter;
+    live.since_transaction_id = current->last_transaction_id;
+    auto full = [&filter](const std::vector<Transaction>& rows) {
+        return filter.limit > 0 && (int)rows.size() >= filter.limit;
+    };
+    auto archived = [&](std::vector<Transaction>* out) {
+        Scan(*current, user_id, filter.since_transaction_id, filter.newest_first, [&](const LedgerRecord& record) {
+            Transaction row = ToTransaction(record);
+            if (filter.Matches(row, user_id)) {
+                out->push_back(std::move(row));
+            }
+            return !full(*out);
+        });
+    };
+
+    std::vector<Transaction> out;
+    if (filter.newest_first) {
+        out = db->FindTransactions(user_id, live);
+        if (!full(out)) {
+            archived(&out);
+        }
+        return out;
+    }
+    archived(&out);
+    if (full(out)) {
+        return out;
+    }
+    if (filter.limit > 0) {
+        live.limit = filter.limit - (int)out.size();
+    }
+    std::vector<Transaction> rows = db->FindTransactions(user_id, live);
+    out.insert(out.end(), std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.end()));
+    return out;
+}
+
+int ArchivedDatabase::GetLatestTransactionId(int user_id) {
+    int latest = db->GetLatestTransactionId(user_id);
+    if (latest == 0) {
+        Scan(*Current(), user_id, 0, true, [&latest](const LedgerRecord& record) {
+            latest = record.transaction_id;
+            return false;
+        });
+    }
+    return latest;
+}
+
+std::pair<double, bool> ArchivedDatabase::GetVersionedBalance(int user_id, int* version) {
+    std::pair<double, bool> balance = db->GetVersionedBalance(user_id, version);
+    if (balance.second == 0 && *version == 0) {
+        Scan(*Current(), user_id, 0, true, [version](const LedgerRecord& record) {
+            *version = record.transaction_id;
+            return false;
+        });
+    }
+    return balance;
+}
+
+// the engine's totals are kept as is (Postgres keeps them in
+// account_daily_stats, which archiving does not touch); recent is topped
+// up with archived rows older than the ones the engine returned
+std::pair<AccountSummary, bool> ArchivedDatabase::GetAccountSummary(int user_id, int recent_limit, int window_days) {
+    std::pair<AccountSummary, bool> summary = db->GetAccountSummary(user_id, recent_limit, window_days);
+    std::vector<Transaction>& recent = summary.first.recent;
+    if (summary.second != 0 || (int)recent.size() >= recent_limit) {
+        return summary;
+    }
+    int before = recent.empty() ? std::numeric_limits<int>::max() : recent.back().transaction_id;
+    Scan(*Current(), user_id, 0, true, [&](const LedgerRecord& record) {
+        if (record.transaction_id < before) {
+            recent.push_back(ToTransaction(record));
+        }
+        return (int)recent.size() < recent_limit;
+    });
+    return summary;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "databaseInterface.h"
+#include "segment.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Serves another engine's history merged with the segments the archiver
+// moved out of it. Segments cover consecutive id ranges, so everything up
+// to ArchivedThrough() is read from the mmap'd files and only newer rows
+// are asked of the engine; rows the archiver copied but has not deleted
+// yet are skipped rather than merged twice. Refresh maps segments written
+// since the last call, segments are never removed while a server runs.
+// Everything else is forwarded.
+class ArchivedDatabase : public IDatabase {
+public:
+    ArchivedDatabase(IDatabase* database, const std::string& archive_dir);
+    ~ArchivedDatabase() override;
+
+    void Refresh();
+    void StartRefresh(int interval_seconds);
+    // highest transaction id served from segments, 0 with an empty archive
+    int ArchivedThrough() const;
+
+    int TransferMoney(int sender_id, int receiver_id, double amount) override;
+    std::pair<double, bool> GetBalance(int user_id) override;
+    void DepositMoney(int user_id, double amount) override;
+    int WithdrawMoney(int user_id, double amount) override;
+    std::vector<Transaction> GetTransactions(int user_id) override;
+    std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) override;
+    std::vector<Transaction> FindTransactions(int user_id, const HistoryFilter& filter) override;
+    int GetLatestTransactionId(int user_id) override;
+    std::pair<AccountSummary, bool> GetAccountSummary(int user_id, int recent_limit, int window_days) override;
+    std::pair<double, bool> GetVersionedBalance(int user_id, int* version) override;
+    void SetBalanceObserver(BalanceObserver observer) override;
+
+private:
+    // immutable once published, replaced as a whole by Refresh
+    struct Archive {
+        std::vector<std::shared_ptr<const MappedSegment>> segments;
+        int last_transaction_id = 0;
+    };
+
+    std::shared_ptr<const Archive> Current() const;
+    // calls visit with the account's archived records newer than
+    // since_transaction_id, in id order or newest first, until it returns false
+    template <typename Visit>
+    void Scan(const Archive& archive, int user_id, int since_transaction_id, bool newest_first, Visit visit);
+
+    IDatabase* db;
+    std::string dir;
+    std::mutex refresh_mutex;
+    mutable std::mutex archive_mutex;
+    std::shared_ptr<const Archive> archive;
+    std::atomic<int64_t>& rows_read;
+
+    std::mutex refresher_mutex;
+    std::condition_variable refresher_cv;
+    bool stopping = false;
+    std::thread refresher;
+};
@@ -0,0 +1,159 @@
+#pragma once
+#include "databaseInterface.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Hand-off between gRPC handler threads and the engine threads that own
+// account state (SequencedDatabase, ShardedDatabase).
+
+// How a thread waits for work: Spin burns a core for the lowest latency,
+// Yield gives the core away between polls, Block sleeps on a condition
+// variable once there is nothing to do.
+enum class WaitStrategy { Spin, Yield, Block };
+
+// "spin", "yield" or "block"; anything else is Block
+inline WaitStrategy ParseWaitStrategy(const std::string& name) {
+    if (name == "spin") {
+        return WaitStrategy::Spin;
+    }
+    if (name == "yield") {
+        return WaitStrategy::Yield;
+    }
+    return WaitStrategy::Block;
+}
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// false when the thread could not be pinned or pinning is not supported
+inline bool PinToCpu(std::thread& thread, int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+// Outcome of one call. It lives on the caller's stack: the engine fills in
+// the fields and signals, Wait returns once that happened and rethrows
+// whatever the engine caught.
+struct Completion {
+    int result = 0;
+    double balance = 0;
+    int version = 0;
+    std::vector<Transaction> rows;
+    std::exception_ptr error;
+
+    void Wait(WaitStrategy wait) {
+        switch (wait) {
+        case WaitStrategy::Spin:
+            while (!ready.load(std::memory_order_acquire)) {
+                CpuRelax();
+            }
+            break;
+        case WaitStrategy::Yield:
+            while (!ready.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            break;
+        case WaitStrategy::Block:
+            for (int i = 0; i < kBlockSpins && !ready.load(std::memory_order_acquire); ++i) {
+                CpuRelax();
+            }
+            {
+                // also taken when ready was already seen, so Signal has let
+                // go of mtx before the completion leaves the caller's frame
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this] { return ready.load(std::memory_order_acquire); });
+            }
+            break;
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // the completion must not be touched afterwards
+    void Signal(WaitStrategy wait) {
+        if (wait != WaitStrategy::Block) {
+            ready.store(true, std::memory_order_release);
+            return;
+        }
+        // the waiter may be between its last poll and cv.wait
+        std::lock_guard<std::mutex> lock(mtx);
+        ready.store(true, std::memory_order_release);
+        cv.notify_one();
+    }
+
+private:
+    // polls before a Block waiter goes to sleep
+    static constexpr int kBlockSpins = 64;
+
+    std::atomic<bool> ready{false};
+    std::mutex mtx;
+    std::condition_variable cv;
+};
+
+// Lets an engine thread sleep when it has no work under WaitStrategy::Block.
+// Producers Ring after publishing; the fences make sure that either the
+// sleeper sees the new work or the producer sees it sleeping.
+class Doorbell {
+public:
+    explicit Doorbell(WaitStrategy wait) : wait(wait) {}
+
+    void Ring() {
+        if (wait != WaitStrategy::Block) {
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mtx);
+            cv.notify_one();
+        }
+    }
+
+    // has_work must also turn true when the owner is asked to stop
+    template <typename Predicate>
+    void Sleep(Predicate has_work) {
+        switch (wait) {
+        case WaitStrategy::Spin:
+            CpuRelax();
+            return;
+        case WaitStrategy::Yield:
+            std::this_thread::yield();
+            return;
+        case WaitStrategy::Block:
+            break;
+        }
+        sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!has_work()) {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, has_work);
+        }
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+
+private:
+    WaitStrategy wait;
+    std::atomic<bool> sleeping{false};
+    std::mutex mtx;
+    std::condition_variable cv;
+};
@@ -0,0 +1,6 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli); uses the SSE4.2 crc32 instruction when the CPU has it
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc = 0);
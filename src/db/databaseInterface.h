@@ -1,4 +1,8 @@
 #pragma once
+#include <algorithm>
+#include <ctime>
+#include <functional>
+#include <optional>
 #include <vector>
 #include <string>
 #include <utility>
@@ -12,6 +16,60 @@ struct Transaction {
     std::string status;
 };
 
+// empty / unset fields do not filter; timestamps compare as ISO strings,
+// from is inclusive and to is exclusive
+struct HistoryFilter {
+    enum Direction { Any, Sent, Received };
+
+    std::string from_timestamp;
+    std::string to_timestamp;
+    std::optional<double> min_amount;
+    std::optional<double> max_amount;
+    std::string status;
+    Direction direction = Any;
+    bool newest_first = false;
+    int limit = 0;
+    int since_transaction_id = 0;
+
+    bool Matches(const Transaction& row, int user_id) const {
+        if (row.transaction_id <= since_transaction_id) {
+            return false;
+        }
+        if (direction == Sent && (row.sender_id != user_id || row.status == "deposit")) {
+            return false;
+        }
+        if (direction == Received && (row.receiver_id != user_id || row.status == "withdrawal")) {
+            return false;
+        }
+        if (direction == Any && row.sender_id != user_id && row.receiver_id != user_id) {
+            return false;
+        }
+        if (!from_timestamp.empty() && row.timestamp < from_timestamp) {
+            return false;
+        }
+        if (!to_timestamp.empty() && row.timestamp >= to_timestamp) {
+            return false;
+        }
+        if ((min_amount && row.amount < *min_amount) || (max_amount && row.amount > *max_amount)) {
+            return false;
+        }
+        return status.empty() || row.status == status;
+    }
+};
+
+// recent transactions are newest first; totals cover the last window_days
+struct AccountSummary {
+    double balance = 0;
+    std::vector<Transaction> recent;
+    int transaction_count = 0;
+    double total_in = 0;
+    double total_out = 0;
+};
+
+// receives the balance a committed mutation left on an account; version is
+// the id of the transaction row that produced it and only grows per account
+using BalanceObserver = std::function<void(int user_id, double balance, int version)>;
+
 class IDatabase {
 public:
     virtual ~IDatabase() = default;
@@ -21,4 +79,118 @@ public:
     virtual void DepositMoney(int sender_id, double amount) = 0;
     virtual int WithdrawMoney(int sender_id, double amount) = 0;
     virtual std::vector<Transaction> GetTransactions(int user_id) = 0;
+
+    // transactions with id > since_transaction_id, oldest first
+    virtual std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) {
+        std::vector<Transaction> out;
+        for (auto& row : GetTransactions(user_id)) {
+            if (row.transaction_id > since_transaction_id) {
+                out.push_back(std::move(row));
+            }
+        }
+        std::sort(out.begin(), out.end(), [](const Transaction& a, const Transaction& b) {
+            return a.transaction_id < b.transaction_id;
+        });
+        return out;
+    }
+
+    virtual std::vector<Transaction> FindTransactions(int user_id, const HistoryFilter& filter) {
+        std::vector<Transaction> out;
+        for (auto& row : GetTransactionsSince(user_id, filter.since_transaction_id)) {
+            if (filter.Matches(row, user_id)) {
+                out.push_back(std::move(row));
+            }
+        }
+        if (filter.newest_first) {
+            std::reverse(out.begin(), out.end());
+        }
+        if (filter.limit > 0 && (int)out.size() > filter.limit) {
+            out.resize(filter.limit);
+        }
+        return out;
+    }
+
+    // highest transaction id involving user_id, 0 without history
+    virtual int GetLatestTransactionId(int user_id) {
+        std::vector<Transaction> history = GetTransactionsSince(user_id, 0);
+        return history.empty() ? 0 : history.back().transaction_id;
+    }
+
+    // One page of an incremental sync. With a limit the page holds the
+    // oldest matching rows after since_transaction_id, in the filter's
+    // order, so *watermark (its newest row, or latest when the page is not
+    // full) can come back as since_transaction_id without skipping any.
+    std::vector<Transaction> FindTransactionsPage(int user_id, HistoryFilter filter, int latest, int* watermark) {
+        bool newest_first = filter.newest_first;
+        filter.newest_first = false;
+        std::vector<Transaction> out = FindTransactions(user_id, filter);
+        bool truncated = filter.limit > 0 && (int)out.size() == filter.limit;
+        *watermark = truncated ? filter.since_transaction_id : std::max(latest, filter.since_transaction_id);
+        if (!out.empty()) {
+            *watermark = std::max(*watermark, out.back().transaction_id);
+        }
+        if (newest_first) {
+            std::reverse(out.begin(), out.end());
+        }
+        return out;
+    }
+
+    // second = 1 when the user does not exist, like GetBalance
+    virtual std::pair<AccountSummary, bool> GetAccountSummary(int user_id, int recent_limit, int window_days) {
+        AccountSummary summary;
+        std::pair<double, bool> balance = GetBalance(user_id);
+        if (balance.second != 0) {
+            return {summary, 1};
+        }
+        summary.balance = balance.first;
+
+        std::string cutoff;
+        if (window_days > 0) {
+            std::time_t since = std::time(nullptr) - (window_days - 1) * 86400;
+            char day[11];
+            std::strftime(day, sizeof(day), "%Y-%m-%d", std::localtime(&since));
+            cutoff = day;
+        }
+
+        std::vector<Transaction> history = GetTransactionsSince(user_id, 0);
+        for (auto it = history.rbegin(); it != history.rend(); ++it) {
+            if ((int)summary.recent.size() < recent_limit) {
+                summary.recent.push_back(*it);
+            }
+            if (it->timestamp < cutoff) {
+                continue;
+            }
+            if (it->receiver_id == user_id && it->status != "withdrawal") {
+                summary.transaction_count++;
+                summary.total_in += it->amount;
+            }
+            if (it->sender_id == user_id && it->status != "deposit") {
+                summary.transaction_count++;
+                summary.total_out += it->amount;
+            }
+        }
+        return {summary, 0};
+    }
+
+    // GetBalance plus the id of the newest transaction already reflected in
+    // it (0 without history). The default reads the id first, so the
+    // balance is never older than the version it is reported with.
+    virtual std::pair<double, bool> GetVersionedBalance(int user_id, int* version) {
+        *version = GetLatestTransactionId(user_id);
+        return GetBalance(user_id);
+    }
+
+    // set before the engine serves requests; engines without support never call it
+    virtual void SetBalanceObserver(BalanceObserver observer) {
+        balance_observer = std::move(observer);
+    }
+
+protected:
+    void NotifyBalance(int user_id, double balance, int version) {
+        if (balance_observer) {
+            balance_observer(user_id, balance, version);
+        }
+    }
+
+    BalanceObserver balance_observer;
 };
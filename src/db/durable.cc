@@ -0,0 +1,303 @@
+#include "durable.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+// runs work(i) for i in [0, count) on up to thread_count threads
+void ParallelFor(size_t count, int thread_count, const std::function<void(size_t)>& work) {
+    size_t threads = std::max(1, thread_count);
+    size_t chunk = (count + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (size_t begin = 0; begin < count; begin += chunk) {
+        size_t end = std::min(count, begin + chunk);
+        workers.emplace_back([begin, end, &work] {
+            for (size_t i = begin; i < end; ++i) {
+                work(i);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+}
+
+DurableDatabase::DurableDatabase(const std::string& dir, size_t capacity, int group_commit_us, int replay_threads)
+    : dir(dir), ledger(capacity) {
+    std::filesystem::create_directories(dir);
+    uint64_t last_lsn = Recover(replay_threads);
+    wal = std::make_unique<WalWriter>(dir, last_lsn + 1, group_commit_us);
+}
+
+DurableDatabase::~DurableDatabase() {
+    {
+        std::lock_guard<std::mutex> lock(checkpointer_mutex);
+        stopping = true;
+    }
+    checkpointer_cv.notify_all();
+    if (checkpointer.joinable()) {
+        checkpointer.join();
+    }
+}
+
+uint64_t DurableDatabase::Recover(int replay_threads) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t last_lsn = 0;
+
+    auto snapshots = ListSnapshots(dir);
+    if (!snapshots.empty()) {
+        MappedSnapshot snapshot(snapshots.back().second);
+        last_lsn = snapshot.Lsn();
+        for (size_t i = 0; i < snapshot.AccountCount(); ++i) {
+            ledger.CreateAccount(snapshot.Accounts()[i].user_id, snapshot.Accounts()[i].balance);
+        }
+        const LedgerRecord* records = snapshot.Records();
+        ParallelFor(snapshot.RecordCount(), replay_threads, [this, records](size_t i) {
+            ledger.Apply(ToTransaction(records[i]), false);
+        });
+    }
+
+    // accounts first so that parallel replay never sees a missing account
+    std::vector<WalEntry> mutations;
+    uint64_t snapshot_lsn = last_lsn;
+    for (const auto& file : ListWalFiles(dir)) {
+        for (const WalEntry& entry : ReadWalFile(file.second)) {
+            if (entry.lsn <= snapshot_lsn) {
+                continue;
+            }
+            last_lsn = std::max(last_lsn, entry.lsn);
+            if (entry.type == WalEntry::kCreateAccount) {
+                ledger.CreateAccount(entry.record.sender_id, entry.record.amount);
+            }
+            else {
+                mutations.push_back(entry);
+            }
+        }
+    }
+    // balance changes commute, so entries can be applied in any order; the
+    // WAL that survived is an LSN prefix, and LSNs follow dependencies, so
+    // it never holds a mutation without one whose effects it saw
+    ParallelFor(mutations.size(), replay_threads, [this, &mutations](size_t i) {
+        ledger.Apply(ToTransaction(mutations[i].record));
+    });
+    ledger.SortHistories();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Recovered " << ledger.AccountCount() << " accounts and replayed " << mutations.size()
+              << " WAL entries in " << elapsed.count() << " ms" << std::endl;
+    return last_lsn;
+}
+
+bool DurableDatabase::CreateAccount(int user_id, double balance) {
+    uint64_t lsn;
+    {
+        std::shared_lock<std::shared_mutex> cut(cut_mutex);
+        LedgerRecord record = {};
+        record.sender_id = user_id;
+        record.receiver_id = user_id;
+        record.amount = balance;
+        record.time_us = NowMicros();
+        // logged before a mutation of the new account can be
+        bool created = ledger.CreateAccount(user_id, balance, [this, &record, &lsn] {
+            lsn = wal->Append(WalEntry::kCreateAccount, record);
+        });
+        if (!created) {
+            return false;
+        }
+    }
+    wal->WaitDurable(lsn);
+    return true;
+}
+
+std::pair<double, bool> DurableDatabase::GetBalance(int user_id) {
+    return ledger.GetBalance(user_id);
+}
+
+std::pair<double, bool> DurableDatabase::GetVersionedBalance(int user_id, int* version) {
+    return ledger.GetVersionedBalance(user_id, version);
+}
+
+// like GetBalance, the observer sees a mutation before its fdatasync
+void DurableDatabase::SetBalanceObserver(BalanceObserver observer) {
+    ledger.SetBalanceObserver(std::move(observer));
+}
+
+// a mutation is logged while its accounts are locked, so a mutation that
+// saw another's effects always gets the higher LSN
+int DurableDatabase::TransferMoney(int sender_id, int receiver_id, double amount) {
+    LedgerRecord record;
+    uint64_t lsn;
+    {
+        std::shared_lock<std::shared_mutex> cut(cut_mutex);
+        int result = ledger.Transfer(sender_id, receiver_id, amount, nullptr, Logger(&record, &lsn));
+        if (result != 0) {
+            return result;
+        }
+    }
+    Commit(record, lsn);
+    return 0;
+}
+
+void DurableDatabase::DepositMoney(int user_id, double amount) {
+    LedgerRecord record;
+    uint64_t lsn;
+    {
+        std::shared_lock<std::shared_mutex> cut(cut_mutex);
+        ledger.Deposit(user_id, amount, nullptr, Logger(&record, &lsn));
+    }
+    Commit(record, lsn);
+}
+
+int DurableDatabase::WithdrawMoney(int user_id, double amount) {
+    LedgerRecord record;
+    uint64_t lsn;
+    {
+        std::shared_lock<std::shared_mutex> cut(cut_mutex);
+        int result = ledger.Withdraw(user_id, amount, nullptr, Logger(&record, &lsn));
+        if (result != 0) {
+            return result;
+        }
+    }
+    Commit(record, lsn);
+    return 0;
+}
+
+void DurableDatabase::SetCommitObserver(std::function<void(const LedgerRecord&, bool durable)> observer) {
+    commit_observer = std::move(observer);
+}
+
+InMemoryDatabase::RowLog DurableDatabase::Logger(LedgerRecord* record, uint64_t* lsn) {
+    return [this, record, lsn](const Transaction& row) {
+        *record = ToRecord(row);
+        *lsn = Log(*record);
+    };
+}
+
+uint64_t DurableDatabase::Log(const LedgerRecord& record) {
+    try {
+        return wal->Append(WalEntry::kMutation, record);
+    }
+    catch (...) {
+        if (commit_observer) {
+            commit_observer(record, false);
+        }
+        throw;
+    }
+}
+
+void DurableDatabase::Commit(const LedgerRecord& record, uint64_t lsn) {
+    try {
+        wal->WaitDurable(lsn);
+    }
+    catch (...) {
+        if (commit_observer) {
+            commit_observer(record, false);
+        }
+        throw;
+    }
+    if (commit_observer) {
+        commit_observer(record, true);
+    }
+}
+
+void DurableDatabase::Import(const std::vector<std::pair<int, double>>& accounts,
+                             const std::vector<Transaction>& history) {
+    for (const auto& account : accounts) {
+        ledger.CreateAccount(account.first, account.second);
+    }
+    for (const Transaction& row : history) {
+        ledger.Apply(row, false);
+    }
+    ledger.SortHistories();
+    Checkpoint();
+}
+
+// each row once, from its sender's history
+std::vector<LedgerRecord> DurableDatabase::CommittedSince(int since_transaction_id) {
+    std::vector<std::pair<int, size_t>> accounts;
+    ledger.ForEachAccount([&accounts](int user_id, double, size_t history_size) {
+        accounts.emplace_back(user_id, history_size);
+    });
+    std::vector<LedgerRecord> records;
+    for (const auto& account : accounts) {
+        int user_id = account.first;
+        ledger.VisitHistory(user_id, account.second, [&records, user_id, since_transaction_id](const Transaction& row) {
+            if (row.sender_id == user_id && row.transaction_id > since_transaction_id) {
+                records.push_back(ToRecord(row));
+            }
+        });
+    }
+    std::sort(records.begin(), records.end(), [](const LedgerRecord& a, const LedgerRecord& b) {
+        return a.transaction_id < b.transaction_id;
+    });
+    return records;
+}
+
+std::vector<Transaction> DurableDatabase::GetTransactions(int user_id) {
+    return ledger.GetTransactions(user_id);
+}
+
+std::vector<Transaction> DurableDatabase::GetTransactionsSince(int user_id, int since_transaction_id) {
+    return ledger.GetTransactionsSince(user_id, since_transaction_id);
+}
+
+void DurableDatabase::Checkpoint() {
+    std::lock_guard<std::mutex> serial(checkpoint_mutex);
+    std::vector<SnapshotAccount> accounts;
+    std::vector<size_t> history_sizes;
+    uint64_t lsn;
+    {
+        // the pause only covers balances and history lengths
+        std::unique_lock<std::shared_mutex> cut(cut_mutex);
+        lsn = wal->Rotate();
+        ledger.ForEachAccount([&](int user_id, double balance, size_t history_size) {
+            accounts.push_back({user_id, 0, balance});
+            history_sizes.push_back(history_size);
+        });
+    }
+
+    // each row is written once, from its sender's history
+    std::vector<LedgerRecord> records;
+    for (size_t i = 0; i < accounts.size(); ++i) {
+        int user_id = accounts[i].user_id;
+        ledger.VisitHistory(user_id, history_sizes[i], [&records, user_id](const Transaction& row) {
+            if (row.sender_id == user_id) {
+                records.push_back(ToRecord(row));
+            }
+        });
+    }
+    WriteSnapshot(dir, lsn, accounts, records);
+
+    // everything up to lsn is now in the snapshot
+    for (const auto& file : ListWalFiles(dir)) {
+        if (file.first <= lsn) {
+            std::filesystem::remove(file.second);
+        }
+    }
+    for (const auto& snapshot : ListSnapshots(dir)) {
+        if (snapshot.first < lsn) {
+            std::filesystem::remove(snapshot.second);
+        }
+    }
+}
+
+void DurableDatabase::StartCheckpoints(int interval_seconds) {
+    checkpointer = std::thread([this, interval_seconds] {
+        std::unique_lock<std::mutex> lock(checkpointer_mutex);
+        while (!checkpointer_cv.wait_for(lock, std::chrono::seconds(interval_seconds), [this] { return stopping; })) {
+            lock.unlock();
+            try {
+                Checkpoint();
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Checkpoint failed: " << e.what() << std::endl;
+            }
+            lock.lock();
+        }
+    });
+}
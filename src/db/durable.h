@@ -0,0 +1,70 @@
+#pragma once
+#include "inMemory.h"
+#include "wal.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+// InMemoryDatabase made durable with a write-ahead log and snapshots kept
+// in dir. A mutation is appended to the WAL while its accounts are locked,
+// applied in memory and only returns once its entry has been fdatasync'ed. Checkpoint writes the
+// current balances and histories to a snapshot and drops the WAL files it
+// covers. On startup the newest snapshot is mapped and the WAL written
+// after it is replayed with replay_threads threads.
+class DurableDatabase : public IDatabase {
+public:
+    DurableDatabase(const std::string& dir, size_t capacity, int group_commit_us, int replay_threads);
+    ~DurableDatabase() override;
+
+    bool CreateAccount(int user_id, double balance);
+    size_t AccountCount() const { return ledger.AccountCount(); }
+    int LastTransactionId() const { return ledger.NextTransactionId() - 1; }
+    void Checkpoint();
+    void StartCheckpoints(int interval_seconds);
+
+    // Hooks for WriteBehindDatabase. The commit observer is called with
+    // every mutation once it is durable, outside of any lock, and may
+    // block; set it before the engine serves requests. A mutation whose
+    // WAL write failed took its id but never commits: the observer gets it
+    // with durable false and must not block on it. Import loads an
+    // empty engine with (user_id, balance) accounts and the history those
+    // balances already reflect, and checkpoints it. CommittedSince returns
+    // every row with a higher id, oldest first.
+    void SetCommitObserver(std::function<void(const LedgerRecord&, bool durable)> observer);
+    void Import(const std::vector<std::pair<int, double>>& accounts, const std::vector<Transaction>& history);
+    std::vector<LedgerRecord> CommittedSince(int since_transaction_id);
+
+    std::pair<double, bool> GetBalance(int user_id) override;
+    int TransferMoney(int sender_id, int receiver_id, double amount) override;
+    void DepositMoney(int user_id, double amount) override;
+    int WithdrawMoney(int user_id, double amount) override;
+    std::vector<Transaction> GetTransactions(int user_id) override;
+    std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) override;
+    std::pair<double, bool> GetVersionedBalance(int user_id, int* version) override;
+    void SetBalanceObserver(BalanceObserver observer) override;
+
+private:
+    uint64_t Recover(int replay_threads);
+    // Log appends a mutation under the cut and stripe locks, Commit waits
+    // for it; both tell the commit observer when the mutation is lost.
+    // Logger hands Log to the ledger and keeps what it appended.
+    InMemoryDatabase::RowLog Logger(LedgerRecord* record, uint64_t* lsn);
+    uint64_t Log(const LedgerRecord& record);
+    void Commit(const LedgerRecord& record, uint64_t lsn);
+
+    std::string dir;
+    InMemoryDatabase ledger;
+    std::unique_ptr<WalWriter> wal;
+    // mutations hold it shared, a checkpoint takes it exclusively for its cut
+    std::shared_mutex cut_mutex;
+    std::mutex checkpoint_mutex;
+    std::function<void(const LedgerRecord&, bool durable)> commit_observer;
+
+    std::mutex checkpointer_mutex;
+    std::condition_variable checkpointer_cv;
+    bool stopping = false;
+    std::thread checkpointer;
+};
@@ -0,0 +1,258 @@
+#include "faultInjecting.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "src/metrics/metrics.h"
+
+namespace {
+
+using Profile = FaultInjectingDatabase::Profile;
+using Latency = FaultInjectingDatabase::Latency;
+
+const char* const kMethodNames[FaultInjectingDatabase::kMethods] = {
+    "transfer", "balance", "deposit", "withdraw", "history", "summary",
+};
+
+std::vector<std::string> Split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream in(text);
+    std::string part;
+    while (std::getline(in, part, separator)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+// a non-negative number that is all of text
+double Number(const std::string& text, const std::string& item) {
+    size_t used = 0;
+    double value = -1;
+    try {
+        value = std::stod(text, &used);
+    }
+    catch (const std::exception&) {
+    }
+    if (used != text.size() || !(value >= 0)) {
+        throw std::invalid_argument("bad number \"" + text + "\" in \"" + item + "\"");
+    }
+    return value;
+}
+
+Profile ParseProfile(const std::string& text, const std::string& item) {
+    Profile profile;
+    std::string latency = text;
+    size_t at = text.find('@');
+    if (at != std::string::npos) {
+        profile.error_rate = Number(text.substr(at + 1), item);
+        latency = text.substr(0, at);
+    }
+    std::vector<std::string> parts = Split(latency, ':');
+    std::string shape = parts.empty() ? "" : parts[0];
+    if (shape == "none" && parts.size() == 1) {
+        profile.latency = Latency::None;
+    }
+    else if (shape == "fixed" && parts.size() == 2) {
+        profile.latency = Latency::Fixed;
+        profile.latency_ms = Number(parts[1], item);
+    }
+    else if (shape == "lognormal" && parts.size() == 3) {
+        profile.latency = Latency::Lognormal;
+        profile.latency_ms = Number(parts[1], item);
+        profile.sigma = Number(parts[2], item);
+    }
+    else if (shape == "bimodal" && parts.size() == 4) {
+        profile.latency = Latency::Bimodal;
+        profile.latency_ms = Number(parts[1], item);
+        profile.stall_probability = Number(parts[2], item);
+        profile.stall_ms = Number(parts[3], item);
+    }
+    else {
+        throw std::invalid_argument("bad latency \"" + latency + "\" in \"" + item + "\"");
+    }
+    if (profile.error_rate > 1 || profile.stall_probability > 1) {
+        throw std::invalid_argument("probability above 1 in \"" + item + "\"");
+    }
+    return profile;
+}
+
+std::string Format(const Profile& profile) {
+    char text[128];
+    switch (profile.latency) {
+    case Latency::Fixed:
+        std::snprintf(text, sizeof(text), "fixed:%g", profile.latency_ms);
+        break;
+    case Latency::Lognormal:
+        std::snprintf(text, sizeof(text), "lognormal:%g:%g", profile.latency_ms, profile.sigma);
+        break;
+    case Latency::Bimodal:
+        std::snprintf(text, sizeof(text), "bimodal:%g:%g:%g", profile.latency_ms, profile.stall_probability,
+                      profile.stall_ms);
+        break;
+    default:
+        std::snprintf(text, sizeof(text), "none");
+        break;
+    }
+    std::string out = text;
+    if (profile.error_rate > 0) {
+        std::snprintf(text, sizeof(text), "@%g", profile.error_rate);
+        out += text;
+    }
+    return out;
+}
+
+}
+
+FaultInjectingDatabase::FaultInjectingDatabase(IDatabase* database)
+    : db(database), delayed_us(Metrics::Global().Counter("fault_injection.delayed_us")),
+      errors(Metrics::Global().Counter("fault_injection.errors")) {}
+
+void FaultInjectingDatabase::SetProfile(Method method, const Profile& profile) {
+    std::lock_guard<std::mutex> lock(profiles_mutex);
+    profiles[method] = profile;
+}
+
+FaultInjectingDatabase::Profile FaultInjectingDatabase::GetProfile(Method method) const {
+    std::lock_guard<std::mutex> lock(profiles_mutex);
+    return profiles[method];
+}
+
+void FaultInjectingDatabase::Configure(const std::string& spec, bool reset) {
+    Profile parsed[kMethods];
+    bool set[kMethods] = {};
+    for (const std::string& item : Split(spec, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        size_t equal_pos = item.find('=');
+        std::string name = item.substr(0, equal_pos);
+        if (equal_pos == std::string::npos) {
+            throw std::invalid_argument("bad fault \"" + item + "\"");
+        }
+        Profile profile = ParseProfile(item.substr(equal_pos + 1), item);
+        bool known = false;
+        for (int method = 0; method < kMethods; ++method) {
+            if (name == "all" || name == kMethodNames[method]) {
+                parsed[method] = profile;
+                set[method] = true;
+                known = true;
+            }
+        }
+        if (!known) {
+            throw std::invalid_argument("unknown method \"" + name + "\"");
+        }
+    }
+    std::lock_guard<std::mutex> lock(profiles_mutex);
+    for (int method = 0; method < kMethods; ++method) {
+        if (set[method] || reset) {
+            profiles[method] = parsed[method];
+        }
+    }
+}
+
+std::string FaultInjectingDatabase::Describe() const {
+    std::string spec;
+    for (int method = 0; method < kMethods; ++method) {
+        Profile profile = GetProfile(static_cast<Method>(method));
+        if (profile.latency == Latency::None && profile.error_rate <= 0) {
+            continue;
+        }
+        spec += (spec.empty() ? "" : ",") + std::string(kMethodNames[method]) + "=" + Format(profile);
+    }
+    return spec;
+}
+
+int64_t FaultInjectingDatabase::DelayMicros(const Profile& profile, double u, double z) {
+    double ms = 0;
+    switch (profile.latency) {
+    case Latency::Fixed:
+        ms = profile.latency_ms;
+        break;
+    case Latency::Lognormal:
+        ms = profile.latency_ms * std::exp(profile.sigma * z);
+        break;
+    case Latency::Bimodal:
+        ms = u < profile.stall_probability ? profile.stall_ms : profile.latency_ms;
+        break;
+    default:
+        break;
+    }
+    return static_cast<int64_t>(ms * 1000);
+}
+
+void FaultInjectingDatabase::Inject(Method method) {
+    Profile profile = GetProfile(method);
+    if (profile.latency == Latency::None && profile.error_rate <= 0) {
+        return;
+    }
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> normal;
+    int64_t delay = DelayMicros(profile, uniform(rng), normal(rng));
+    if (delay > 0) {
+        delayed_us.fetch_add(delay, std::memory_order_relaxed);
+        std::this_thread::sleep_for(std::chrono::microseconds(delay));
+    }
+    if (uniform(rng) < profile.error_rate) {
+        errors.fetch_add(1, std::memory_order_relaxed);
+        throw FaultInjected(std::string("injected ") + kMethodNames[method] + " failure");
+    }
+}
+
+int FaultInjectingDatabase::TransferMoney(int sender_id, int receiver_id, double amount) {
+    Inject(Transfer);
+    return db->TransferMoney(sender_id, receiver_id, amount);
+}
+
+std::pair<double, bool> FaultInjectingDatabase::GetBalance(int user_id) {
+    Inject(Balance);
+    return db->GetBalance(user_id);
+}
+
+void FaultInjectingDatabase::DepositMoney(int user_id, double amount) {
+    Inject(Deposit);
+    db->DepositMoney(user_id, amount);
+}
+
+int FaultInjectingDatabase::WithdrawMoney(int user_id, double amount) {
+    Inject(Withdraw);
+    return db->WithdrawMoney(user_id, amount);
+}
+
+std::vector<Transaction> FaultInjectingDatabase::GetTransactions(int user_id) {
+    Inject(History);
+    return db->GetTransactions(user_id);
+}
+
+std::vector<Transaction> FaultInjectingDatabase::GetTransactionsSince(int user_id, int since_transaction_id) {
+    Inject(History);
+    return db->GetTransactionsSince(user_id, since_transaction_id);
+}
+
+std::vector<Transaction> FaultInjectingDatabase::FindTransactions(int user_id, const HistoryFilter& filter) {
+    Inject(History);
+    return db->FindTransactions(user_id, filter);
+}
+
+int FaultInjectingDatabase::GetLatestTransactionId(int user_id) {
+    Inject(History);
+    return db->GetLatestTransactionId(user_id);
+}
+
+std::pair<AccountSummary, bool> FaultInjectingDatabase::GetAccountSummary(int user_id, int recent_limit,
+                                                                          int window_days) {
+    Inject(Summary);
+    return db->GetAccountSummary(user_id, recent_limit, window_days);
+}
+
+std::pair<double, bool> FaultInjectingDatabase::GetVersionedBalance(int user_id, int* version) {
+    Inject(Balance);
+    return db->GetVersionedBalance(user_id, version);
+}
+
+void FaultInjectingDatabase::SetBalanceObserver(BalanceObserver observer) {
+    db->SetBalanceObserver(std::move(observer));
+}
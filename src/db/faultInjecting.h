@@ -0,0 +1,75 @@
+#pragma once
+#include "databaseInterface.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+// Slows down and breaks another engine on purpose, to rehearse a database
+// brownout without one: every call first sleeps for a latency drawn from
+// its method's profile, then fails with error_rate probability by
+// throwing FaultInjected, as a failed statement would, without reaching
+// the engine. Profiles can be replaced at any time from any thread; calls
+// already sleeping keep the profile they started with. Everything else is
+// forwarded.
+//
+// A profile spec is a comma separated list of method=latency[@error_rate]:
+//   method   transfer, balance, deposit, withdraw, history, summary or all
+//   latency  none | fixed:MS | lognormal:MEDIAN_MS:SIGMA |
+//            bimodal:MS:STALL_PROBABILITY:STALL_MS
+// e.g. "all=lognormal:2:0.5,transfer=bimodal:2:0.01:500@0.02"
+class FaultInjectingDatabase : public IDatabase {
+public:
+    enum Method { Transfer, Balance, Deposit, Withdraw, History, Summary, kMethods };
+    enum class Latency { None, Fixed, Lognormal, Bimodal };
+
+    struct Profile {
+        Latency latency = Latency::None;
+        // the fixed value, the lognormal median or the fast mode
+        double latency_ms = 0;
+        double sigma = 0;
+        double stall_probability = 0;
+        double stall_ms = 0;
+        double error_rate = 0;
+    };
+
+    struct FaultInjected : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    explicit FaultInjectingDatabase(IDatabase* database);
+
+    void SetProfile(Method method, const Profile& profile);
+    Profile GetProfile(Method method) const;
+    // applies spec on top of the current profiles, or on none at all when
+    // reset; throws invalid_argument without changing anything on a bad spec
+    void Configure(const std::string& spec, bool reset = false);
+    // the current profiles as a spec, methods without faults left out
+    std::string Describe() const;
+
+    int TransferMoney(int sender_id, int receiver_id, double amount) override;
+    std::pair<double, bool> GetBalance(int user_id) override;
+    void DepositMoney(int user_id, double amount) override;
+    int WithdrawMoney(int user_id, double amount) override;
+    std::vector<Transaction> GetTransactions(int user_id) override;
+    std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) override;
+    std::vector<Transaction> FindTransactions(int user_id, const HistoryFilter& filter) override;
+    int GetLatestTransactionId(int user_id) override;
+    std::pair<AccountSummary, bool> GetAccountSummary(int user_id, int recent_limit, int window_days) override;
+    std::pair<double, bool> GetVersionedBalance(int user_id, int* version) override;
+    void SetBalanceObserver(BalanceObserver observer) override;
+
+    // the delay one call of profile gets, in microseconds, for a uniform
+    // draw u in [0, 1) and a standard normal draw z
+    static int64_t DelayMicros(const Profile& profile, double u, double z);
+
+private:
+    void Inject(Method method);
+
+    IDatabase* db;
+    mutable std::mutex profiles_mutex;
+    Profile profiles[kMethods];
+    std::atomic<int64_t>& delayed_us;
+    std::atomic<int64_t>& errors;
+};
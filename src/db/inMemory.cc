@@ -0,0 +1,295 @@
+#include "inMemory.h"
+#include "timestamp.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+uint32_t Mix(int user_id) {
+    uint32_t h = static_cast<uint32_t>(user_id);
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+}
+
+InMemoryDatabase::InMemoryDatabase(size_t capacity, size_t stripe_count) : stripe_count(stripe_count) {
+    // keep the load factor at or below one half
+    size_t size = 16;
+    while (size < capacity * 2) {
+        size <<= 1;
+    }
+    mask = size - 1;
+    slots.reset(new Slot[size]);
+    stripes.reset(new Stripe[stripe_count]);
+}
+
+InMemoryDatabase::Slot* InMemoryDatabase::Find(int user_id) const {
+    if (user_id == kEmpty) {
+        return nullptr;
+    }
+    for (size_t i = Mix(user_id) & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+        int id = slots[i].user_id.load(std::memory_order_acquire);
+        if (id == user_id) {
+            return &slots[i];
+        }
+        if (id == kEmpty) {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+size_t InMemoryDatabase::StripeIndex(int user_id) const {
+    return (Mix(user_id) >> 7) % stripe_count;
+}
+
+bool InMemoryDatabase::CreateAccount(int user_id, double balance, const std::function<void()>& log) {
+    if (user_id == kEmpty) {
+        throw std::invalid_argument("user_id 0 is reserved");
+    }
+    // held while the slot is claimed so readers never see a half built account
+    std::lock_guard<std::mutex> lock(stripes[StripeIndex(user_id)].mtx);
+    for (size_t i = Mix(user_id) & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+        int expected = kEmpty;
+        if (slots[i].user_id.compare_exchange_strong(expected, user_id, std::memory_order_acq_rel)) {
+            slots[i].balance = balance;
+            account_count.fetch_add(1, std::memory_order_relaxed);
+            if (log) {
+                log();
+            }
+            return true;
+        }
+        if (expected == user_id) {
+            return false;
+        }
+    }
+    throw std::runtime_error("Account table is full");
+}
+
+// called with the stripe locks held; timestamps are formatted before locking
+Transaction InMemoryDatabase::MakeRecord(int sender_id, int receiver_id, double amount, const char* status, std::string timestamp) {
+    return {
+        next_transaction_id.fetch_add(1, std::memory_order_relaxed),
+        sender_id,
+        receiver_id,
+        amount,
+        std::move(timestamp),
+        status
+    };
+}
+
+std::pair<double, bool> InMemoryDatabase::GetBalance(int user_id) {
+    Slot* slot = Find(user_id);
+    if (slot == nullptr) {
+        return {-1, 1}; // user not found
+    }
+    std::lock_guard<std::mutex> lock(stripes[StripeIndex(user_id)].mtx);
+    return {slot->balance, 0};
+}
+
+int InMemoryDatabase::TransferMoney(int sender_id, int receiver_id, double amount) {
+    return Transfer(sender_id, receiver_id, amount, nullptr);
+}
+
+void InMemoryDatabase::DepositMoney(int user_id, double amount) {
+    Deposit(user_id, amount, nullptr);
+}
+
+int InMemoryDatabase::WithdrawMoney(int user_id, double amount) {
+    return Withdraw(user_id, amount, nullptr);
+}
+
+std::pair<double, bool> InMemoryDatabase::GetVersionedBalance(int user_id, int* version) {
+    Slot* slot = Find(user_id);
+    if (slot == nullptr) {
+        *version = 0;
+        return {-1, 1}; // user not found
+    }
+    std::lock_guard<std::mutex> lock(stripes[StripeIndex(user_id)].mtx);
+    *version = slot->history.empty() ? 0 : slot->history.back().transaction_id;
+    return {slot->balance, 0};
+}
+
+int InMemoryDatabase::Transfer(int sender_id, int receiver_id, double amount, Transaction* record, const RowLog& log) {
+    Slot* sender = Find(sender_id);
+    Slot* receiver = Find(receiver_id);
+    if (sender == nullptr) {
+        return 1; // sender not found
+    }
+    else if (receiver == nullptr) {
+        return 2; // receiver not found
+    }
+
+    std::string timestamp = FormatTimestamp(NowMicros());
+    size_t first = StripeIndex(sender_id);
+    size_t second = StripeIndex(receiver_id);
+    if (first > second) {
+        std::swap(first, second);
+    }
+    std::unique_lock<std::mutex> first_lock(stripes[first].mtx);
+    std::unique_lock<std::mutex> second_lock;
+    if (second != first) {
+        second_lock = std::unique_lock<std::mutex>(stripes[second].mtx);
+    }
+
+    if (sender->balance < amount) {
+        return 3; //not enough money
+    }
+    Transaction row = MakeRecord(sender_id, receiver_id, amount, "transfer", std::move(timestamp));
+    if (log) {
+        log(row);
+    }
+    sender->balance -= amount;
+    receiver->balance += amount;
+
+    if (record) {
+        *record = row;
+    }
+    // under the stripe locks, so versions reach the observer in order
+    NotifyBalance(sender_id, sender->balance, row.transaction_id);
+    NotifyBalance(receiver_id, receiver->balance, row.transaction_id);
+    if (receiver != sender) {
+        receiver->history.push_back(row);
+    }
+    sender->history.push_back(std::move(row));
+    return 0; //success
+}
+
+void InMemoryDatabase::Deposit(int user_id, double amount, Transaction* record, const RowLog& log) {
+    Slot* slot = Find(user_id);
+    if (slot == nullptr) {
+        // what the transactions -> users foreign key does in Postgres
+        throw std::invalid_argument("User " + std::to_string(user_id) + " not found");
+    }
+    std::string timestamp = FormatTimestamp(NowMicros());
+    std::lock_guard<std::mutex> lock(stripes[StripeIndex(user_id)].mtx);
+    Transaction row = MakeRecord(user_id, user_id, amount, "deposit", std::move(timestamp));
+    if (log) {
+        log(row);
+    }
+    slot->balance += amount;
+    slot->history.push_back(std::move(row));
+    if (record) {
+        *record = slot->history.back();
+    }
+    NotifyBalance(user_id, slot->balance, slot->history.back().transaction_id);
+}
+
+int InMemoryDatabase::Withdraw(int user_id, double amount, Transaction* record, const RowLog& log) {
+    Slot* slot = Find(user_id);
+    if (slot == nullptr) {
+        throw std::out_of_range("User " + std::to_string(user_id) + " not found");
+    }
+    std::string timestamp = FormatTimestamp(NowMicros());
+    std::lock_guard<std::mutex> lock(stripes[StripeIndex(user_id)].mtx);
+    if (slot->balance < amount) {
+        return 1;
+    }
+    else if (amount <= 0) {
+        return 1;
+    }
+    Transaction row = MakeRecord(user_id, user_id, amount, "withdrawal", std::move(timestamp));
+    if (log) {
+        log(row);
+    }
+    slot->balance -= amount;
+    slot->history.push_back(std::move(row));
+    if (record) {
+        *record = slot->history.back();
+    }
+    NotifyBalance(user_id, slot->balance, slot->history.back().transaction_id);
+    return 0;
+}
+
+std::vector<Transaction> InMemoryDatabase::GetTransactions(int user_id) {
+    return GetTransactionsSince(user_id, 0);
+}
+
+std::vector<Transaction> InMemoryDatabase::GetTransactionsSince(int user_id, int since_transaction_id) {
+    Slot* slot = Find(user_id);
+    if (slot == nullptr) {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(stripes[StripeIndex(user_id)].mtx);
+    // ids are handed out under the stripe lock, so each history is sorted
+    auto begin = std::upper_bound(slot->history.begin(), slot->history.end(), since_transaction_id,
+                                  [](int id, const Transaction& row) { return id < row.transaction_id; });
+    return std::vector<Transaction>(begin, slot->history.end());
+}
+
+void InMemoryDatabase::Apply(const Transaction& row, bool move_money) {
+    Slot* sender = Find(row.sender_id);
+    Slot* receiver = Find(row.receiver_id);
+    if (sender == nullptr || receiver == nullptr) {
+        throw std::runtime_error("Transaction " + std::to_string(row.transaction_id) + " refers to an unknown account");
+    }
+
+    size_t first = StripeIndex(row.sender_id);
+    size_t second = StripeIndex(row.receiver_id);
+    if (first > second) {
+        std::swap(first, second);
+    }
+    std::unique_lock<std::mutex> first_lock(stripes[first].mtx);
+    std::unique_lock<std::mutex> second_lock;
+    if (second != first) {
+        second_lock = std::unique_lock<std::mutex>(stripes[second].mtx);
+    }
+
+    if (move_money && row.status == "deposit") {
+        receiver->balance += row.amount;
+    }
+    else if (move_money && row.status == "withdrawal") {
+        sender->balance -= row.amount;
+    }
+    else if (move_money) {
+        sender->balance -= row.amount;
+        receiver->balance += row.amount;
+    }
+    sender->history.push_back(row);
+    if (receiver != sender) {
+        receiver->history.push_back(row);
+    }
+
+    int next = next_transaction_id.load(std::memory_order_relaxed);
+    while (next <= row.transaction_id &&
+           !next_transaction_id.compare_exchange_weak(next, row.transaction_id + 1, std::memory_order_relaxed)) {
+    }
+}
+
+void InMemoryDatabase::SortHistories() {
+    for (size_t i = 0; i <= mask; ++i) {
+        if (slots[i].user_id.load(std::memory_order_acquire) == kEmpty) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(stripes[StripeIndex(slots[i].user_id)].mtx);
+        std::sort(slots[i].history.begin(), slots[i].history.end(), [](const Transaction& a, const Transaction& b) {
+            return a.transaction_id < b.transaction_id;
+        });
+    }
+}
+
+void InMemoryDatabase::ForEachAccount(const std::function<void(int, double, size_t)>& visit) const {
+    for (size_t i = 0; i <= mask; ++i) {
+        int user_id = slots[i].user_id.load(std::memory_order_acquire);
+        if (user_id != kEmpty) {
+            visit(user_id, slots[i].balance, slots[i].history.size());
+        }
+    }
+}
+
+void InMemoryDatabase::VisitHistory(int user_id, size_t count, const std::function<void(const Transaction&)>& visit) {
+    Slot* slot = Find(user_id);
+    if (slot == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(stripes[StripeIndex(user_id)].mtx);
+    count = std::min(count, slot->history.size());
+    for (size_t i = 0; i < count; ++i) {
+        visit(slot->history[i]);
+    }
+}
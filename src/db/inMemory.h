@@ -0,0 +1,76 @@
+#pragma once
+#include "databaseInterface.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Process-local ledger with the same semantics and return codes as
+// PostgresDatabase. Accounts live in a fixed size open addressing table
+// of cache line sized slots. Balances and histories are guarded by a
+// striped set of mutexes keyed by user id. A transfer locks both stripes
+// in index order, so transfers that share a stripe wait for each other
+// but can never deadlock.
+class InMemoryDatabase : public IDatabase {
+public:
+    explicit InMemoryDatabase(size_t capacity, size_t stripe_count = 1024);
+
+    // called with a mutation's row while its stripes are still locked, so
+    // rows reach it in the order they see each other's effects; if it
+    // throws, the mutation is not applied but its id stays taken
+    using RowLog = std::function<void(const Transaction&)>;
+
+    // false when user_id already exists; log runs once the account is
+    // claimed, before any mutation can see it
+    bool CreateAccount(int user_id, double balance, const std::function<void()>& log = nullptr);
+    size_t AccountCount() const { return account_count.load(std::memory_order_relaxed); }
+
+    std::pair<double, bool> GetBalance(int user_id) override;
+    int TransferMoney(int sender_id, int receiver_id, double amount) override;
+    void DepositMoney(int user_id, double amount) override;
+    int WithdrawMoney(int user_id, double amount) override;
+    std::vector<Transaction> GetTransactions(int user_id) override;
+    std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) override;
+    std::pair<double, bool> GetVersionedBalance(int user_id, int* version) override;
+
+    // same as the IDatabase calls, record receives the row that was written
+    int Transfer(int sender_id, int receiver_id, double amount, Transaction* record, const RowLog& log = nullptr);
+    void Deposit(int user_id, double amount, Transaction* record, const RowLog& log = nullptr);
+    int Withdraw(int user_id, double amount, Transaction* record, const RowLog& log = nullptr);
+
+    // Recovery and checkpoint hooks. Apply re-executes a logged row without
+    // any checks (move_money = false only restores history); rows may
+    // arrive in any order from several threads, so SortHistories must run
+    // once recovery is done. ForEachAccount reports balances and history
+    // lengths and is only consistent while the caller keeps mutations out;
+    // the history prefixes it reported can be read later with VisitHistory.
+    void Apply(const Transaction& row, bool move_money = true);
+    void SortHistories();
+    void ForEachAccount(const std::function<void(int, double, size_t)>& visit) const;
+    void VisitHistory(int user_id, size_t count, const std::function<void(const Transaction&)>& visit);
+    int NextTransactionId() const { return next_transaction_id.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int kEmpty = 0;
+
+    struct alignas(64) Slot {
+        std::atomic<int> user_id{kEmpty};
+        double balance = 0;
+        std::vector<Transaction> history;
+    };
+
+    struct alignas(64) Stripe {
+        std::mutex mtx;
+    };
+
+    Slot* Find(int user_id) const;
+    size_t StripeIndex(int user_id) const;
+    Transaction MakeRecord(int sender_id, int receiver_id, double amount, const char* status, std::string timestamp);
+
+    size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    size_t stripe_count;
+    std::unique_ptr<Stripe[]> stripes;
+    std::atomic<size_t> account_count{0};
+    std::atomic<int> next_transaction_id{1};
+};
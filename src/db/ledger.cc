@@ -0,0 +1,115 @@
+#include "ledger.h"
+#include <algorithm>
+#include <stdexcept>
+
+bool Ledger::CreateAccount(int user_id, double balance) {
+    return accounts.emplace(user_id, Account{balance, 0, {}}).second;
+}
+
+std::pair<double, bool> Ledger::GetBalance(int user_id) const {
+    auto it = accounts.find(user_id);
+    if (it == accounts.end()) {
+        return {-1, 1}; // user not found
+    }
+    return {it->second.balance, 0};
+}
+
+std::pair<double, bool> Ledger::GetVersionedBalance(int user_id, int* version) const {
+    auto it = accounts.find(user_id);
+    if (it == accounts.end()) {
+        *version = 0;
+        return {-1, 1}; // user not found
+    }
+    const std::vector<Transaction>& history = it->second.history;
+    *version = history.empty() ? 0 : history.back().transaction_id;
+    return {it->second.balance, 0};
+}
+
+int Ledger::Transfer(int sender_id, int receiver_id, double amount, const std::string& timestamp) {
+    auto sender = accounts.find(sender_id);
+    auto receiver = accounts.find(receiver_id);
+    if (sender == accounts.end()) {
+        return 1; // sender not found
+    }
+    else if (receiver == accounts.end()) {
+        return 2; // receiver not found
+    }
+    if (sender->second.balance - sender->second.reserved < amount) {
+        return 3; //not enough money
+    }
+    sender->second.balance -= amount;
+    receiver->second.balance += amount;
+
+    Transaction row{NextTransactionId(), sender_id, receiver_id, amount, timestamp, "transfer"};
+    if (receiver != sender) {
+        receiver->second.history.push_back(row);
+    }
+    sender->second.history.push_back(std::move(row));
+    return 0; //success
+}
+
+void Ledger::Deposit(int user_id, double amount, const std::string& timestamp) {
+    auto it = accounts.find(user_id);
+    if (it == accounts.end()) {
+        throw std::invalid_argument("User " + std::to_string(user_id) + " not found");
+    }
+    it->second.balance += amount;
+    it->second.history.push_back({NextTransactionId(), user_id, user_id, amount, timestamp, "deposit"});
+}
+
+int Ledger::Withdraw(int user_id, double amount, const std::string& timestamp) {
+    auto it = accounts.find(user_id);
+    if (it == accounts.end()) {
+        throw std::out_of_range("User " + std::to_string(user_id) + " not found");
+    }
+    if (it->second.balance - it->second.reserved < amount) {
+        return 1;
+    }
+    else if (amount <= 0) {
+        return 1;
+    }
+    it->second.balance -= amount;
+    it->second.history.push_back({NextTransactionId(), user_id, user_id, amount, timestamp, "withdrawal"});
+    return 0;
+}
+
+std::vector<Transaction> Ledger::GetTransactionsSince(int user_id, int since_transaction_id) const {
+    auto it = accounts.find(user_id);
+    if (it == accounts.end()) {
+        return {};
+    }
+    const std::vector<Transaction>& history = it->second.history;
+    auto begin = std::upper_bound(history.begin(), history.end(), since_transaction_id,
+                                  [](int id, const Transaction& row) { return id < row.transaction_id; });
+    return std::vector<Transaction>(begin, history.end());
+}
+
+int Ledger::Reserve(int sender_id, double amount) {
+    auto it = accounts.find(sender_id);
+    if (it == accounts.end()) {
+        return 1; // sender not found
+    }
+    if (it->second.balance - it->second.reserved < amount) {
+        return 3; //not enough money
+    }
+    it->second.reserved += amount;
+    return 0;
+}
+
+void Ledger::Release(int sender_id, double amount) {
+    accounts.at(sender_id).reserved -= amount;
+}
+
+Transaction Ledger::Credit(int sender_id, int receiver_id, double amount, const std::string& timestamp) {
+    Account& receiver = accounts.at(receiver_id);
+    receiver.balance += amount;
+    receiver.history.push_back({NextTransactionId(), sender_id, receiver_id, amount, timestamp, "transfer"});
+    return receiver.history.back();
+}
+
+void Ledger::Settle(const Transaction& row) {
+    Account& sender = accounts.at(row.sender_id);
+    sender.reserved -= row.amount;
+    sender.balance -= row.amount;
+    sender.history.push_back(row);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "databaseInterface.h"
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Account state for a single writer thread: no locks, the owner
+// serialises every call. Return codes and exceptions match
+// PostgresDatabase so engines built on it are interchangeable. Ledgers that
+// partition one account space share shared_ids to keep ids unique.
+class Ledger {
+public:
+    explicit Ledger(size_t capacity, std::atomic<int>* shared_ids = nullptr) : shared_ids(shared_ids) {
+        accounts.reserve(capacity);
+    }
+
+    // false when user_id already exists
+    bool CreateAccount(int user_id, double balance);
+    size_t AccountCount() const { return accounts.size(); }
+
+    std::pair<double, bool> GetBalance(int user_id) const;
+    // version is the newest transaction id in the account's history
+    std::pair<double, bool> GetVersionedBalance(int user_id, int* version) const;
+    int Transfer(int sender_id, int receiver_id, double amount, const std::string& timestamp);
+    void Deposit(int user_id, double amount, const std::string& timestamp);
+    int Withdraw(int user_id, double amount, const std::string& timestamp);
+    std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) const;
+
+    // Transfers whose receiver lives in another Ledger. Reserve sets the
+    // amount aside on the sender (1 sender not found, 3 not enough money);
+    // the receiver's side then either Credits it, which writes the row, or
+    // the sender Releases it. Settle books a credited row on the sender
+    // under the same id; the caller keeps the sender from writing rows
+    // while the transfer is open, so that id is still its newest.
+    bool Exists(int user_id) const { return accounts.count(user_id) != 0; }
+    int Reserve(int sender_id, double amount);
+    void Release(int sender_id, double amount);
+    Transaction Credit(int sender_id, int receiver_id, double amount, const std::string& timestamp);
+    void Settle(const Transaction& row);
+
+private:
+    struct Account {
+        double balance = 0;
+        // promised to transfers that are still in flight
+        double reserved = 0;
+        std::vector<Transaction> history;
+    };
+
+    int NextTransactionId() {
+        return shared_ids ? shared_ids->fetch_add(1, std::memory_order_relaxed) : next_transaction_id++;
+    }
+
+    std::unordered_map<int, Account> accounts;
+    std::atomic<int>* shared_ids;
+    int next_transaction_id = 1;
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "databaseInterface.h"
+#include "timestamp.h"
+
+// Fixed size form of Transaction used by the binary on-disk formats, with
+// the status string interned as a one byte code.
+struct LedgerRecord {
+    int32_t transaction_id;
+    int32_t sender_id;
+    int32_t receiver_id;
+    uint8_t status;
+    uint8_t padding[3];
+    double amount;
+    int64_t time_us;
+};
+static_assert(sizeof(LedgerRecord) == 32, "LedgerRecord is part of the file formats");
+static_assert(std::is_trivially_copyable<LedgerRecord>::value, "LedgerRecord is copied with memcpy");
+
+enum LedgerStatus : uint8_t {
+    kStatusUnknown = 0,
+    kStatusTransfer = 1,
+    kStatusDeposit = 2,
+    kStatusWithdrawal = 3,
+};
+
+inline uint8_t StatusCode(const std::string& status) {
+    if (status == "transfer") {
+        return kStatusTransfer;
+    }
+    if (status == "deposit") {
+        return kStatusDeposit;
+    }
+    if (status == "withdrawal") {
+        return kStatusWithdrawal;
+    }
+    return kStatusUnknown;
+}
+
+inline const char* StatusName(uint8_t code) {
+    switch (code) {
+    case kStatusTransfer:
+        return "transfer";
+    case kStatusDeposit:
+        return "deposit";
+    case kStatusWithdrawal:
+        return "withdrawal";
+    default:
+        return "unknown";
+    }
+}
+
+inline LedgerRecord ToRecord(const Transaction& row) {
+    LedgerRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.transaction_id = row.transaction_id;
+    record.sender_id = row.sender_id;
+    record.receiver_id = row.receiver_id;
+    record.status = StatusCode(row.status);
+    record.amount = row.amount;
+    record.time_us = ParseTimestamp(row.timestamp);
+    return record;
+}
+
+inline Transaction ToTransaction(const LedgerRecord& record) {
+    return {
+        record.transaction_id,
+        record.sender_id,
+        record.receiver_id,
+        record.amount,
+        FormatTimestamp(record.time_us),
+        StatusName(record.status)
+    };
+}
@@ -1,40 +1,112 @@
 #include "postgres.h"
+#include <algorithm>
+#include <cstdio>
 
-PostgresDatabase::PostgresDatabase(const std::string& conn_str) : conn(conn_str) {
-    if (!conn.is_open()) {
-        throw std::runtime_error("Failed to connect to database");
+namespace {
+
+// "user_id:balance:transaction_id", see kAccountEventsChannel
+std::string BalanceEvent(int user_id, double balance, int transaction_id) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%d:%.17g:%d", user_id, balance, transaction_id);
+    return buffer;
+}
+
+}
+
+PostgresDatabase::PostgresDatabase(const std::string& conn_str, int pool_size) : conn_str(conn_str) {
+    for (int i = 0; i < std::max(pool_size, 1); ++i) {
+        pool.push_back(std::make_unique<pqxx::connection>(conn_str));
+        if (!pool.back()->is_open()) {
+            throw std::runtime_error("Failed to connect to database");
+        }
+    }
+}
+
+PostgresDatabase::Lease::Lease(PostgresDatabase* db) : db(db) {
+    {
+        std::unique_lock<std::mutex> lock(db->pool_mutex);
+        db->pool_cv.wait(lock, [db] { return !db->pool.empty(); });
+        conn = std::move(db->pool.back());
+        db->pool.pop_back();
+    }
+    if (!conn->is_open()) {
+        try {
+            conn = std::make_unique<pqxx::connection>(db->conn_str);
+        }
+        catch (...) {
+            db->Release(std::move(conn));
+            throw;
+        }
+    }
+}
+
+PostgresDatabase::Lease::~Lease() {
+    db->Release(std::move(conn));
+}
+
+void PostgresDatabase::Release(std::unique_ptr<pqxx::connection> conn) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        pool.push_back(std::move(conn));
     }
+    pool_cv.notify_one();
 }
 
 int PostgresDatabase::TransferMoney(int sender_id, int receiver_id, double amount) {
-    pqxx::work txn(conn);
-    pqxx::result sender_balance_result = txn.exec_params(
-    "SELECT balance FROM users WHERE user_id = $1", sender_id);
-     pqxx::result receiver = txn.exec_params(
-    "SELECT balance FROM users WHERE user_id = $1", receiver_id);
-    if (sender_balance_result.size() == 0) {
+    Lease conn(this);
+    pqxx::work txn(*conn);
+    // both rows stay locked until commit, so concurrent debits see each
+    // other; taking them in user_id order keeps opposite transfers from
+    // deadlocking
+    pqxx::result accounts = txn.exec_params(
+        "SELECT user_id, balance FROM users WHERE user_id IN ($1, $2) ORDER BY user_id FOR UPDATE",
+        sender_id, receiver_id);
+    int sender = -1;
+    int receiver = -1;
+    for (int i = 0; i < int(accounts.size()); ++i) {
+        int user_id = accounts[i][0].as<int>();
+        if (user_id == sender_id) {
+            sender = i;
+        }
+        if (user_id == receiver_id) {
+            receiver = i;
+        }
+    }
+    if (sender < 0) {
         return 1; // sender not found
     }
-    else if (receiver.size() == 0) {
+    else if (receiver < 0) {
         return 2; // receiver not found
     }
-    double sender_balance = sender_balance_result[0][0].as<double>();
+    double sender_balance = accounts[sender][1].as<double>();
     if (sender_balance < amount) {
         return 3; //not enough money
     }
 
-    txn.exec_params("UPDATE users SET balance = balance - $1 WHERE user_id = $2", amount, sender_id);
-    txn.exec_params("UPDATE users SET balance = balance + $1 WHERE user_id = $2", amount, receiver_id);
+    double sender_after = txn.exec_params(
+        "UPDATE users SET balance = balance - $1 WHERE user_id = $2 RETURNING balance", amount, sender_id)[0][0].as<double>();
+    double receiver_after = txn.exec_params(
+        "UPDATE users SET balance = balance + $1 WHERE user_id = $2 RETURNING balance", amount, receiver_id)[0][0].as<double>();
+    if (sender_id == receiver_id) {
+        sender_after = receiver_after;
+    }
 
-    txn.exec_params("INSERT INTO transactions (sender_id, receiver_id, amount, status) VALUES ($1, $2, $3, 'transfer')",
-                                               sender_id, receiver_id, amount);
+    int transaction_id = txn.exec_params(
+        "INSERT INTO transactions (sender_id, receiver_id, amount, status) VALUES ($1, $2, $3, 'transfer') "
+        "RETURNING transaction_id", sender_id, receiver_id, amount)[0][0].as<int>();
+    txn.exec_params("SELECT pg_notify($1, $2)", kAccountEventsChannel,
+                    BalanceEvent(sender_id, sender_after, transaction_id) + "," +
+                    BalanceEvent(receiver_id, receiver_after, transaction_id));
 
     txn.commit();
+    NotifyBalance(sender_id, sender_after, transaction_id);
+    NotifyBalance(receiver_id, receiver_after, transaction_id);
     return 0; //success
 }
 
 std::pair<double, bool> PostgresDatabase::GetBalance(int user_id) {
-    pqxx::work txn(conn);
+    Lease conn(this);
+    pqxx::work txn(*conn);
     pqxx::result sender_balance_result = txn.exec_params(
     "SELECT balance FROM users WHERE user_id = $1", user_id);
     
@@ -47,19 +119,28 @@ std::pair<double, bool> PostgresDatabase::GetBalance(int user_id) {
 }
 
 void PostgresDatabase::DepositMoney(int user_id, double amount) {
-    pqxx::work txn(conn);
-    txn.exec_params("UPDATE users SET balance = balance + $1 WHERE user_id = $2", amount, user_id);
+    Lease conn(this);
+    pqxx::work txn(*conn);
+    pqxx::result updated = txn.exec_params(
+        "UPDATE users SET balance = balance + $1 WHERE user_id = $2 RETURNING balance", amount, user_id);
 
-    txn.exec_params("INSERT INTO transactions (sender_id, receiver_id, amount, status) VALUES ($1, $2, $3, 'deposit')",
-    user_id, user_id, amount);
+    // fails on the users foreign key when user_id does not exist
+    int transaction_id = txn.exec_params(
+        "INSERT INTO transactions (sender_id, receiver_id, amount, status) VALUES ($1, $2, $3, 'deposit') "
+        "RETURNING transaction_id", user_id, user_id, amount)[0][0].as<int>();
+    double balance = updated[0][0].as<double>();
+    txn.exec_params("SELECT pg_notify($1, $2)", kAccountEventsChannel, BalanceEvent(user_id, balance, transaction_id));
     txn.commit();
+    NotifyBalance(user_id, balance, transaction_id);
 }
 
 
 int PostgresDatabase::WithdrawMoney(int user_id, double amount) {
-    pqxx::work txn(conn);
+    Lease conn(this);
+    pqxx::work txn(*conn);
+    // locked until commit, so concurrent withdrawals see each other
     pqxx::result sender_balance_result = txn.exec_params(
-    "SELECT balance FROM users WHERE user_id = $1", user_id);
+    "SELECT balance FROM users WHERE user_id = $1 FOR UPDATE", user_id);
     double sender_balance = sender_balance_result[0][0].as<double>();
     if (sender_balance < amount) {
         return 1;
@@ -68,22 +149,224 @@ int PostgresDatabase::WithdrawMoney(int user_id, double amount) {
         return 1;
     }
     else{
-        txn.exec_params("UPDATE users SET balance = balance - $1 WHERE user_id = $2", amount, user_id);
+        double balance = txn.exec_params(
+            "UPDATE users SET balance = balance - $1 WHERE user_id = $2 RETURNING balance", amount, user_id)[0][0].as<double>();
 
-        txn.exec_params("INSERT INTO transactions (sender_id, receiver_id, amount, status) VALUES ($1, $2, $3, 'withdrawal')",
-        user_id, user_id, amount);
+        int transaction_id = txn.exec_params(
+            "INSERT INTO transactions (sender_id, receiver_id, amount, status) VALUES ($1, $2, $3, 'withdrawal') "
+            "RETURNING transaction_id", user_id, user_id, amount)[0][0].as<int>();
+        txn.exec_params("SELECT pg_notify($1, $2)", kAccountEventsChannel, BalanceEvent(user_id, balance, transaction_id));
         txn.commit();
+        NotifyBalance(user_id, balance, transaction_id);
     }
     return 0;
 }
 
 
 std::vector<Transaction> PostgresDatabase::GetTransactions(int user_id) {
-    pqxx::read_transaction txn(conn);
+    Lease conn(this);
+    pqxx::read_transaction txn(*conn);
     auto r = txn.exec_params(
         "SELECT * FROM transactions WHERE sender_id=$1 OR receiver_id=$1", user_id);
 
-    std::vector<Transaction> out(r.size());
+    std::vector<Transaction> out;
+    out.reserve(r.size());
+
+    for (auto const& row : r) {
+        out.push_back({
+            row["transaction_id"].as<int>(),
+            row["sender_id"].as<int>(),
+            row["receiver_id"].as<int>(),
+            row["amount"].as<double>(),
+            row["timestamp"].as<std::string>(),
+            row["status"].as<std::string>()
+        });
+    }
+    return out;
+}
+
+std::vector<Transaction> PostgresDatabase::GetTransactionsSince(int user_id, int since_transaction_id) {
+    Lease conn(this);
+    pqxx::read_transaction txn(*conn);
+    auto r = txn.exec_params(
+        "SELECT * FROM transactions WHERE (sender_id=$1 OR receiver_id=$1) AND transaction_id > $2 "
+        "ORDER BY transaction_id", user_id, since_transaction_id);
+
+    std::vector<Transaction> out;
+    out.reserve(r.size());
+
+    for (auto const& row : r) {
+        out.push_back({
+            row["transaction_id"].as<int>(),
+            row["sender_id"].as<int>(),
+            row["receiver_id"].as<int>(),
+            row["amount"].as<double>(),
+            row["timestamp"].as<std::string>(),
+            row["status"].as<std::string>()
+        });
+    }
+    return out;
+}
+
+std::vector<Transaction> PostgresDatabase::GetTransactionsAfter(int after_transaction_id, int limit) {
+    Lease conn(this);
+    pqxx::read_transaction txn(*conn);
+    auto r = txn.exec_params(
+        "SELECT * FROM transactions WHERE transaction_id > $1 ORDER BY transaction_id LIMIT $2",
+        after_transaction_id, limit);
+
+    std::vector<Transaction> out;
+    out.reserve(r.size());
+
+    for (auto const& row : r) {
+        out.push_back({
+            row["transaction_id"].as<int>(),
+            row["sender_id"].as<int>(),
+            row["receiver_id"].as<int>(),
+            row["amount"].as<double>(),
+            row["timestamp"].as<std::string>(),
+            row["status"].as<std::string>()
+        });
+    }
+    return out;
+}
+
+// account_daily_stats only has an insert trigger, so the totals of
+// GetAccountSummary keep counting the deleted rows
+int PostgresDatabase::DeleteTransactions(int after_transaction_id, int last_transaction_id) {
+    Lease conn(this);
+    pqxx::work txn(*conn);
+    auto r = txn.exec_params("DELETE FROM transactions WHERE transaction_id > $1 AND transaction_id <= $2",
+                             after_transaction_id, last_transaction_id);
+    txn.commit();
+    return r.affected_rows();
+}
+
+int PostgresDatabase::GetLatestTransactionId(int user_id) {
+    Lease conn(this);
+    pqxx::read_transaction txn(*conn);
+    // two index-only lookups on (sender_id, transaction_id) and (receiver_id, transaction_id)
+    auto r = txn.exec_params(
+        "SELECT COALESCE(GREATEST("
+        "(SELECT max(transaction_id) FROM transactions WHERE sender_id = $1), "
+        "(SELECT max(transaction_id) FROM transactions WHERE receiver_id = $1)), 0)", user_id);
+    return r[0][0].as<int>();
+}
+
+std::pair<double, bool> PostgresDatabase::GetVersionedBalance(int user_id, int* version) {
+    Lease conn(this);
+    pqxx::read_transaction txn(*conn);
+    // one statement, so balance and version come from the same snapshot
+    auto r = txn.exec_params(
+        "SELECT balance, COALESCE(GREATEST("
+        "(SELECT max(transaction_id) FROM transactions WHERE sender_id = $1), "
+        "(SELECT max(transaction_id) FROM transactions WHERE receiver_id = $1)), 0) "
+        "FROM users WHERE user_id = $1", user_id);
+    if (r.empty()) {
+        *version = 0;
+        return {-1, 1}; // user not found
+    }
+    *version = r[0][1].as<int>();
+    return {r[0][0].as<double>(), 0};
+}
+
+std::pair<AccountSummary, bool> PostgresDatabase::GetAccountSummary(int user_id, int recent_limit, int window_days) {
+    Lease conn(this);
+    pqxx::read_transaction txn(*conn);
+    // balance, windowed aggregates from account_daily_stats and the newest
+    // transactions through the sender/receiver indexes, in one statement
+    auto r = txn.exec_params(
+        "SELECT u.balance, s.tx_count, s.total_in, s.total_out, t.* FROM users u "
+        "CROSS JOIN LATERAL ("
+        "  SELECT COALESCE(SUM(tx_count), 0) AS tx_count, COALESCE(SUM(total_in), 0) AS total_in,"
+        "         COALESCE(SUM(total_out), 0) AS total_out"
+        "  FROM account_daily_stats"
+        "  WHERE user_id = u.user_id AND ($3 <= 0 OR day > current_date - $3)"
+        ") s "
+        "LEFT JOIN LATERAL ("
+        "  (SELECT * FROM transactions WHERE sender_id = u.user_id ORDER BY transaction_id DESC LIMIT $2)"
+        "  UNION"
+        "  (SELECT * FROM transactions WHERE receiver_id = u.user_id ORDER BY transaction_id DESC LIMIT $2)"
+        "  ORDER BY transaction_id DESC LIMIT $2"
+        ") t ON true "
+        "WHERE u.user_id = $1 ORDER BY t.transaction_id DESC",
+        user_id, recent_limit, window_days);
+
+    AccountSummary summary;
+    if (r.empty()) {
+        return {summary, 1}; // user not found
+    }
+    summary.balance = r[0]["balance"].as<double>();
+    summary.transaction_count = r[0]["tx_count"].as<int>();
+    summary.total_in = r[0]["total_in"].as<double>();
+    summary.total_out = r[0]["total_out"].as<double>();
+
+    summary.recent.reserve(r.size());
+    for (auto const& row : r) {
+        if (row["transaction_id"].is_null()) {
+            break; // no history at all
+        }
+        summary.recent.push_back({
+            row["transaction_id"].as<int>(),
+            row["sender_id"].as<int>(),
+            row["receiver_id"].as<int>(),
+            row["amount"].as<double>(),
+            row["timestamp"].as<std::string>(),
+            row["status"].as<std::string>()
+        });
+    }
+    return {summary, 0};
+}
+
+std::vector<Transaction> PostgresDatabase::FindTransactions(int user_id, const HistoryFilter& filter) {
+    pqxx::params params;
+    int count = 0;
+    auto bind = [&](auto value) {
+        params.append(value);
+        return "$" + std::to_string(++count);
+    };
+
+    // each direction maps onto its own (id, timestamp) index
+    std::string user = bind(user_id);
+    std::string sql = "SELECT * FROM transactions WHERE ";
+    if (filter.direction == HistoryFilter::Sent) {
+        sql += "sender_id = " + user + " AND status <> 'deposit'";
+    }
+    else if (filter.direction == HistoryFilter::Received) {
+        sql += "receiver_id = " + user + " AND status <> 'withdrawal'";
+    }
+    else {
+        sql += "(sender_id = " + user + " OR receiver_id = " + user + ")";
+    }
+    if (!filter.from_timestamp.empty()) {
+        sql += " AND timestamp >= " + bind(filter.from_timestamp) + "::timestamp";
+    }
+    if (!filter.to_timestamp.empty()) {
+        sql += " AND timestamp < " + bind(filter.to_timestamp) + "::timestamp";
+    }
+    if (filter.min_amount) {
+        sql += " AND amount >= " + bind(*filter.min_amount);
+    }
+    if (filter.max_amount) {
+        sql += " AND amount <= " + bind(*filter.max_amount);
+    }
+    if (!filter.status.empty()) {
+        sql += " AND status = " + bind(filter.status);
+    }
+    if (filter.since_transaction_id > 0) {
+        sql += " AND transaction_id > " + bind(filter.since_transaction_id);
+    }
+    sql += filter.newest_first ? " ORDER BY transaction_id DESC" : " ORDER BY transaction_id";
+    if (filter.limit > 0) {
+        sql += " LIMIT " + bind(filter.limit);
+    }
+
+    Lease conn(this);
+    pqxx::read_transaction txn(*conn);
+    auto r = txn.exec_params(sql, params);
+
+    std::vector<Transaction> out;
+    out.reserve(r.size());
 
     for (auto const& row : r) {
         out.push_back({
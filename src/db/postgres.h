@@ -1,15 +1,56 @@
+#pragma once
 #include "databaseInterface.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <pqxx/pqxx>
 
+// NOTIFY channel carrying "user_id:balance:transaction_id[,...]" for every
+// committed mutation, one entry per account it changed
+constexpr const char* kAccountEventsChannel = "account_events";
+// NOTIFY channel carrying the user_id of every new users row, sent by the
+// users_created trigger
+constexpr const char* kAccountCreatedChannel = "account_created";
+
 class PostgresDatabase : public IDatabase {
 public:
-    PostgresDatabase(const std::string& conn_str);
+    // pool_size connections are opened up front; each call checks one out
+    // for its transaction and waits while all of them are busy
+    PostgresDatabase(const std::string& conn_str, int pool_size = 1);
     std::pair<double, bool> GetBalance(int user_id) override;
     int TransferMoney(int sender_id, int receiver_id, double amount) override;
     void DepositMoney(int user_id, double amount) override;
     int WithdrawMoney(int user_id, double amount) override;
     std::vector<Transaction> GetTransactions(int user_id) override;
+    std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) override;
+    std::vector<Transaction> FindTransactions(int user_id, const HistoryFilter& filter) override;
+    int GetLatestTransactionId(int user_id) override;
+    std::pair<double, bool> GetVersionedBalance(int user_id, int* version) override;
+    std::pair<AccountSummary, bool> GetAccountSummary(int user_id, int recent_limit, int window_days) override;
+
+    // for the archiver: every account's transactions with id >
+    // after_transaction_id, oldest first, and deleting an archived id range
+    std::vector<Transaction> GetTransactionsAfter(int after_transaction_id, int limit);
+    int DeleteTransactions(int after_transaction_id, int last_transaction_id);
 
 private:
-    pqxx::connection conn;
+    // a pooled connection for the duration of one call, reopened first if
+    // the server dropped it
+    class Lease {
+    public:
+        explicit Lease(PostgresDatabase* db);
+        ~Lease();
+        pqxx::connection& operator*() { return *conn; }
+
+    private:
+        PostgresDatabase* db;
+        std::unique_ptr<pqxx::connection> conn;
+    };
+
+    void Release(std::unique_ptr<pqxx::connection> conn);
+
+    std::string conn_str;
+    std::mutex pool_mutex;
+    std::condition_variable pool_cv;
+    std::vector<std::unique_ptr<pqxx::connection>> pool;
 };
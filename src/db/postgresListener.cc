@@ -0,0 +1,123 @@
+#include "postgresListener.h"
+#include "postgres.h"
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+class AccountEventReceiver : public pqxx::notification_receiver {
+public:
+    AccountEventReceiver(pqxx::connection& conn, std::function<void(int)>& on_user_changed, BalanceObserver& on_balance)
+        : pqxx::notification_receiver(conn, kAccountEventsChannel), on_user_changed(on_user_changed), on_balance(on_balance) {}
+
+    // entries are "user_id:balance:transaction_id"; older servers sent bare user ids
+    void operator()(const std::string& payload, int) override {
+        std::stringstream ss(payload);
+        std::string entry;
+        while (std::getline(ss, entry, ',')) {
+            try {
+                size_t balance_at = entry.find(':');
+                int user_id = std::stoi(entry.substr(0, balance_at));
+                if (balance_at != std::string::npos && on_balance) {
+                    size_t version_at = entry.find(':', balance_at + 1);
+                    if (version_at == std::string::npos) {
+                        throw std::invalid_argument("no transaction id");
+                    }
+                    on_balance(user_id, std::stod(entry.substr(balance_at + 1, version_at - balance_at - 1)),
+                               std::stoi(entry.substr(version_at + 1)));
+                }
+                on_user_changed(user_id);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Bad account event payload '" << payload << "': " << e.what() << std::endl;
+            }
+        }
+    }
+
+private:
+    std::function<void(int)>& on_user_changed;
+    BalanceObserver& on_balance;
+};
+
+class AccountCreatedReceiver : public pqxx::notification_receiver {
+public:
+    AccountCreatedReceiver(pqxx::connection& conn, std::function<void(int)>& on_account_created)
+        : pqxx::notification_receiver(conn, kAccountCreatedChannel), on_account_created(on_account_created) {}
+
+    void operator()(const std::string& payload, int) override {
+        try {
+            on_account_created(std::stoi(payload));
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Bad account created payload '" << payload << "': " << e.what() << std::endl;
+        }
+    }
+
+private:
+    std::function<void(int)>& on_account_created;
+};
+
+}
+
+PostgresListener::PostgresListener(const std::string& conn_str, std::function<void(int)> on_user_changed,
+                                   BalanceObserver on_balance, std::function<void(int)> on_account_created,
+                                   std::function<void()> on_accounts_loaded, std::function<void()> on_disconnected,
+                                   std::function<void()> on_connected)
+    : conn_str(conn_str), on_user_changed(std::move(on_user_changed)), on_balance(std::move(on_balance)),
+      on_account_created(std::move(on_account_created)), on_accounts_loaded(std::move(on_accounts_loaded)),
+      on_disconnected(std::move(on_disconnected)), on_connected(std::move(on_connected)) {}
+
+PostgresListener::~PostgresListener() {
+    Stop();
+}
+
+void PostgresListener::Start() {
+    running = true;
+    worker = std::thread(&PostgresListener::Run, this);
+}
+
+void PostgresListener::Stop() {
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void PostgresListener::Run() {
+    while (running) {
+        try {
+            pqxx::connection conn(conn_str);
+            AccountEventReceiver receiver(conn, on_user_changed, on_balance);
+            if (on_connected) {
+                on_connected();
+            }
+            std::unique_ptr<AccountCreatedReceiver> created;
+            if (on_account_created) {
+                // LISTEN is in place before the scan, so every account shows up in one of them
+                created = std::make_unique<AccountCreatedReceiver>(conn, on_account_created);
+                {
+                    pqxx::read_transaction txn(conn);
+                    for (auto const& row : txn.exec("SELECT user_id FROM users")) {
+                        on_account_created(row[0].as<int>());
+                    }
+                }
+                if (on_accounts_loaded) {
+                    on_accounts_loaded();
+                }
+            }
+            while (running) {
+                conn.await_notification(1, 0);
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Account event listener error: " << e.what() << std::endl;
+            if (on_disconnected) {
+                on_disconnected();
+            }
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "databaseInterface.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// LISTENs on kAccountEventsChannel with a dedicated connection and reports
+// every user id touched by a commit on any server instance, together with
+// the balance that commit left behind. With on_account_created it also
+// LISTENs on kAccountCreatedChannel and, after every (re)connect, reports
+// all existing user ids followed by on_accounts_loaded, so no account
+// created while it was not listening is missed. on_disconnected runs when
+// the connection is lost: notifications are missed until the reconnect.
+// on_connected runs on every (re)connect once LISTEN is in place, before
+// any notification is delivered.
+class PostgresListener {
+public:
+    PostgresListener(const std::string& conn_str, std::function<void(int)> on_user_changed,
+                     BalanceObserver on_balance = nullptr, std::function<void(int)> on_account_created = nullptr,
+                     std::function<void()> on_accounts_loaded = nullptr, std::function<void()> on_disconnected = nullptr,
+                     std::function<void()> on_connected = nullptr);
+    ~PostgresListener();
+
+    void Start();
+    void Stop();
+
+private:
+    void Run();
+
+    std::string conn_str;
+    std::function<void(int)> on_user_changed;
+    BalanceObserver on_balance;
+    std::function<void(int)> on_account_created;
+    std::function<void()> on_accounts_loaded;
+    std::function<void()> on_disconnected;
+    std::function<void()> on_connected;
+    std::atomic<bool> running{false};
+    std::thread worker;
+};
@@ -0,0 +1,135 @@
+#include "postgresWriteBehind.h"
+#include <cstdio>
+#include <unordered_map>
+
+namespace {
+
+// array literals, so a whole batch binds as two parameters
+std::string IntArray(const std::vector<int>& values) {
+    std::string out = "{";
+    for (size_t i = 0; i < values.size(); ++i) {
+        out += (i ? "," : "") + std::to_string(values[i]);
+    }
+    return out + "}";
+}
+
+std::string DoubleArray(const std::vector<double>& values) {
+    std::string out = "{";
+    char buffer[32];
+    for (size_t i = 0; i < values.size(); ++i) {
+        std::snprintf(buffer, sizeof(buffer), "%s%.17g", i ? "," : "", values[i]);
+        out += buffer;
+    }
+    return out + "}";
+}
+
+void StoreCheckpoint(pqxx::work& txn, int transaction_id) {
+    txn.exec_params(
+        "INSERT INTO write_behind_checkpoint (id, last_transaction_id) VALUES (1, $1) "
+        "ON CONFLICT (id) DO UPDATE SET last_transaction_id = EXCLUDED.last_transaction_id", transaction_id);
+    // ids were assigned here, keep the sequence ahead of them for the Postgres engine
+    txn.exec_params("SELECT setval(pg_get_serial_sequence('transactions', 'transaction_id'), GREATEST($1, 1), $1 > 0)",
+                    transaction_id);
+}
+
+}
+
+PostgresWriteBehindSink::PostgresWriteBehindSink(const std::string& conn_str) : conn(conn_str) {
+    if (!conn.is_open()) {
+        throw std::runtime_error("Failed to connect to database");
+    }
+}
+
+int PostgresWriteBehindSink::Checkpoint() {
+    pqxx::read_transaction txn(conn);
+    auto r = txn.exec("SELECT last_transaction_id FROM write_behind_checkpoint WHERE id = 1");
+    return r.empty() ? 0 : r[0][0].as<int>();
+}
+
+void PostgresWriteBehindSink::Write(const std::vector<LedgerRecord>& batch) {
+    pqxx::work txn(conn);
+    // a retry of a batch whose commit went through but was not confirmed
+    auto checkpoint = txn.exec("SELECT last_transaction_id FROM write_behind_checkpoint WHERE id = 1 FOR UPDATE");
+    int written_through = checkpoint.empty() ? 0 : checkpoint[0][0].as<int>();
+    std::vector<LedgerRecord> rows;
+    for (const LedgerRecord& row : batch) {
+        if (row.transaction_id > written_through) {
+            rows.push_back(row);
+        }
+    }
+    if (rows.empty()) {
+        return;
+    }
+
+    std::vector<int> user_ids;
+    std::unordered_map<int, double> balances;
+    for (const LedgerRecord& row : rows) {
+        for (int user_id : {row.sender_id, row.receiver_id}) {
+            if (balances.emplace(user_id, 0).second) {
+                user_ids.push_back(user_id);
+            }
+        }
+    }
+
+    auto r = txn.exec_params("SELECT user_id, balance FROM users WHERE user_id = ANY($1::int[]) FOR UPDATE",
+                             IntArray(user_ids));
+    for (auto const& row : r) {
+        balances[row[0].as<int>()] = row[1].as<double>();
+    }
+    // the same steps the ledger took, in the same order
+    for (const LedgerRecord& row : rows) {
+        if (row.status != kStatusDeposit) {
+            balances[row.sender_id] -= row.amount;
+        }
+        if (row.status != kStatusWithdrawal) {
+            balances[row.receiver_id] += row.amount;
+        }
+    }
+    std::vector<double> values;
+    values.reserve(user_ids.size());
+    for (int user_id : user_ids) {
+        values.push_back(balances[user_id]);
+    }
+    txn.exec_params(
+        "UPDATE users u SET balance = d.balance FROM unnest($1::int[], $2::float8[]) AS d(user_id, balance) "
+        "WHERE u.user_id = d.user_id", IntArray(user_ids), DoubleArray(values));
+
+    auto stream = pqxx::stream_to::table(txn, {"transactions"},
+        {"transaction_id", "sender_id", "receiver_id", "amount", "timestamp", "status"});
+    for (const LedgerRecord& row : rows) {
+        stream.write_values(row.transaction_id, row.sender_id, row.receiver_id, row.amount,
+                            FormatTimestamp(row.time_us), std::string(StatusName(row.status)));
+    }
+    stream.complete();
+
+    StoreCheckpoint(txn, rows.back().transaction_id);
+    txn.commit();
+}
+
+void PostgresWriteBehindSink::Seed(DurableDatabase* local) {
+    std::vector<std::pair<int, double>> accounts;
+    std::vector<Transaction> history;
+    // the checkpoint commits before the local engine has the rows: a crash
+    // in between leaves it empty and the next start seeds it again, whereas
+    // the other way round it would resend rows Postgres already has
+    pqxx::work txn(conn);
+    for (auto const& row : txn.exec("SELECT user_id, balance FROM users")) {
+        accounts.emplace_back(row[0].as<int>(), row[1].as<double>());
+    }
+    auto r = txn.exec("SELECT * FROM transactions ORDER BY transaction_id");
+    history.reserve(r.size());
+    for (auto const& row : r) {
+        history.push_back({
+            row["transaction_id"].as<int>(),
+            row["sender_id"].as<int>(),
+            row["receiver_id"].as<int>(),
+            row["amount"].as<double>(),
+            row["timestamp"].as<std::string>(),
+            row["status"].as<std::string>()
+        });
+    }
+    StoreCheckpoint(txn, history.empty() ? 0 : history.back().transaction_id);
+    txn.commit();
+
+    local->Import(accounts, history);
+}
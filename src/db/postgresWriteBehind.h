@@ -0,0 +1,26 @@
+#pragma once
+#include "writeBehind.h"
+#include <pqxx/pqxx>
+
+// Postgres end of WriteBehindDatabase. One batch is one transaction: the
+// rows go into transactions through COPY, the balances of the accounts
+// they touched into users with one unnest update, and write_behind_checkpoint
+// moves to the batch's last id. New balances are recomputed from the
+// stored ones in the ledger's order, so they match the local engine to
+// the bit. Rows at or below the stored checkpoint are dropped from a
+// batch, so retrying one that did commit is harmless. The server has to be
+// the only writer while this runs.
+class PostgresWriteBehindSink : public WriteBehindSink {
+public:
+    explicit PostgresWriteBehindSink(const std::string& conn_str);
+
+    int Checkpoint() override;
+    void Write(const std::vector<LedgerRecord>& rows) override;
+
+    // moves the checkpoint to the newest row, then loads users and
+    // transactions into an empty local engine
+    void Seed(DurableDatabase* local);
+
+private:
+    pqxx::connection conn;
+};
@@ -0,0 +1,92 @@
+CREATE TABLE IF NOT EXISTS users (
+    user_id SERIAL PRIMARY KEY,
+    balance DOUBLE PRECISION NOT NULL DEFAULT 0
+);
+
+-- announces new accounts to the servers' existence filters
+CREATE OR REPLACE FUNCTION users_created_notify() RETURNS trigger AS $$
+BEGIN
+    PERFORM pg_notify('account_created', NEW.user_id::text);
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE TRIGGER users_created
+    AFTER INSERT ON users
+    FOR EACH ROW EXECUTE FUNCTION users_created_notify();
+
+CREATE TABLE IF NOT EXISTS transactions (
+    transaction_id SERIAL PRIMARY KEY,
+    sender_id INTEGER NOT NULL REFERENCES users (user_id),
+    receiver_id INTEGER NOT NULL REFERENCES users (user_id),
+    amount DOUBLE PRECISION NOT NULL,
+    timestamp TIMESTAMP NOT NULL DEFAULT now(),
+    status VARCHAR(16) NOT NULL
+);
+
+CREATE INDEX IF NOT EXISTS transactions_sender_idx ON transactions (sender_id, transaction_id);
+CREATE INDEX IF NOT EXISTS transactions_receiver_idx ON transactions (receiver_id, transaction_id);
+-- time range filters of GetTransactionHistory
+CREATE INDEX IF NOT EXISTS transactions_sender_time_idx ON transactions (sender_id, timestamp);
+CREATE INDEX IF NOT EXISTS transactions_receiver_time_idx ON transactions (receiver_id, timestamp);
+
+-- last transaction id the write-behind engine has copied in, written in
+-- the same transaction as the rows themselves
+CREATE TABLE IF NOT EXISTS write_behind_checkpoint (
+    id INTEGER PRIMARY KEY CHECK (id = 1),
+    last_transaction_id INTEGER NOT NULL
+);
+
+-- per user and day aggregates, maintained by the trigger below so that
+-- GetAccountSummary never scans history
+CREATE TABLE IF NOT EXISTS account_daily_stats (
+    user_id INTEGER NOT NULL,
+    day DATE NOT NULL,
+    tx_count INTEGER NOT NULL DEFAULT 0,
+    total_in DOUBLE PRECISION NOT NULL DEFAULT 0,
+    total_out DOUBLE PRECISION NOT NULL DEFAULT 0,
+    PRIMARY KEY (user_id, day)
+);
+
+CREATE OR REPLACE FUNCTION account_daily_stats_apply() RETURNS trigger AS $$
+BEGIN
+    IF NEW.status = 'deposit' THEN
+        INSERT INTO account_daily_stats AS s (user_id, day, tx_count, total_in)
+        VALUES (NEW.receiver_id, NEW.timestamp::date, 1, NEW.amount)
+        ON CONFLICT (user_id, day) DO UPDATE
+        SET tx_count = s.tx_count + 1, total_in = s.total_in + EXCLUDED.total_in;
+    ELSIF NEW.status = 'withdrawal' THEN
+        INSERT INTO account_daily_stats AS s (user_id, day, tx_count, total_out)
+        VALUES (NEW.sender_id, NEW.timestamp::date, 1, NEW.amount)
+        ON CONFLICT (user_id, day) DO UPDATE
+        SET tx_count = s.tx_count + 1, total_out = s.total_out + EXCLUDED.total_out;
+    ELSE
+        INSERT INTO account_daily_stats AS s (user_id, day, tx_count, total_out)
+        VALUES (NEW.sender_id, NEW.timestamp::date, 1, NEW.amount)
+        ON CONFLICT (user_id, day) DO UPDATE
+        SET tx_count = s.tx_count + 1, total_out = s.total_out + EXCLUDED.total_out;
+        INSERT INTO account_daily_stats AS s (user_id, day, tx_count, total_in)
+        VALUES (NEW.receiver_id, NEW.timestamp::date, 1, NEW.amount)
+        ON CONFLICT (user_id, day) DO UPDATE
+        SET tx_count = s.tx_count + 1, total_in = s.total_in + EXCLUDED.total_in;
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE TRIGGER transactions_daily_stats
+    AFTER INSERT ON transactions
+    FOR EACH ROW EXECUTE FUNCTION account_daily_stats_apply();
+
+-- one-off backfill for databases that had history before the stats table
+INSERT INTO account_daily_stats (user_id, day, tx_count, total_in, total_out)
+SELECT user_id, day, COUNT(*), SUM(amount_in), SUM(amount_out)
+FROM (
+    SELECT receiver_id AS user_id, timestamp::date AS day, amount AS amount_in, 0 AS amount_out
+    FROM transactions WHERE status IN ('deposit', 'transfer')
+    UNION ALL
+    SELECT sender_id, timestamp::date, 0, amount
+    FROM transactions WHERE status IN ('withdrawal', 'transfer')
+) moves
+WHERE NOT EXISTS (SELECT 1 FROM account_daily_stats)
+GROUP BY user_id, day;
@@ -0,0 +1,187 @@
+#include "segment.h"
+#include "crc32c.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'B', 'A', 'N', 'K', 'S', 'E', 'G', '1'};
+
+void WriteAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Segment write failed: ") + std::strerror(errno));
+        }
+        p += written;
+        size -= written;
+    }
+}
+
+// closes fd in any case
+void SyncAndClose(int fd, const std::string& path) {
+    if (::fsync(fd) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot sync " + path + ": " + std::strerror(error));
+    }
+    if (::close(fd) != 0) {
+        throw std::runtime_error("Cannot close " + path + ": " + std::strerror(errno));
+    }
+}
+
+}
+
+std::string WriteSegment(const std::string& dir, int after_transaction_id, int last_transaction_id,
+                         const std::vector<LedgerRecord>& rows) {
+    // (account, record) pairs; deposits and withdrawals name the account twice
+    std::vector<std::pair<int32_t, const LedgerRecord*>> entries;
+    entries.reserve(rows.size() * 2);
+    for (const LedgerRecord& row : rows) {
+        if (row.transaction_id <= after_transaction_id || row.transaction_id > last_transaction_id) {
+            throw std::invalid_argument("Segment row outside of its id range");
+        }
+        entries.emplace_back(row.sender_id, &row);
+        if (row.receiver_id != row.sender_id) {
+            entries.emplace_back(row.receiver_id, &row);
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first < b.first : a.second->transaction_id < b.second->transaction_id;
+    });
+
+    std::vector<LedgerRecord> records;
+    std::vector<SegmentAccount> accounts;
+    records.reserve(entries.size());
+    for (const auto& entry : entries) {
+        if (accounts.empty() || accounts.back().user_id != entry.first) {
+            accounts.push_back({entry.first, 0, records.size()});
+        }
+        accounts.back().count++;
+        records.push_back(*entry.second);
+    }
+
+    SegmentFooter footer;
+    std::memset(&footer, 0, sizeof(footer));
+    std::memcpy(footer.magic, kMagic, sizeof(kMagic));
+    footer.record_count = records.size();
+    footer.account_count = accounts.size();
+    footer.after_transaction_id = after_transaction_id;
+    footer.last_transaction_id = last_transaction_id;
+    footer.crc = Crc32c(records.data(), records.size() * sizeof(LedgerRecord));
+    footer.crc = Crc32c(accounts.data(), accounts.size() * sizeof(SegmentAccount), footer.crc);
+
+    char name[48];
+    std::snprintf(name, sizeof(name), "segment-%010d-%010d.seg", after_transaction_id, last_transaction_id);
+    std::string path = dir + "/" + name;
+    std::string tmp = path + ".tmp";
+
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create " + tmp + ": " + std::strerror(errno));
+    }
+    // a segment that may not be on disk is never renamed into place, the
+    // archiver deletes rows on the strength of it
+    try {
+        WriteAll(fd, records.data(), records.size() * sizeof(LedgerRecord));
+        WriteAll(fd, accounts.data(), accounts.size() * sizeof(SegmentAccount));
+        WriteAll(fd, &footer, sizeof(footer));
+    }
+    catch (...) {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        throw;
+    }
+    try {
+        SyncAndClose(fd, tmp);
+    }
+    catch (...) {
+        ::unlink(tmp.c_str());
+        throw;
+    }
+
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename " + tmp + ": " + std::strerror(errno));
+    }
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        throw std::runtime_error("Cannot open " + dir + ": " + std::strerror(errno));
+    }
+    SyncAndClose(dir_fd, dir);
+    return path;
+}
+
+std::vector<std::string> ListSegments(const std::string& dir) {
+    // the ids are zero padded, so name order is id order
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        std::string name = entry.path().filename().string();
+        int after, last;
+        if (name.size() == 33 && std::sscanf(name.c_str(), "segment-%10d-%10d.seg", &after, &last) == 2) {
+            files.push_back(entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+MappedSegment::MappedSegment(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SegmentFooter)) {
+        ::close(fd);
+        throw std::runtime_error("Segment " + path + " is truncated");
+    }
+    size = st.st_size;
+    data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        throw std::runtime_error("Cannot mmap " + path + ": " + std::strerror(errno));
+    }
+
+    size_t body = size - sizeof(SegmentFooter);
+    footer = reinterpret_cast<const SegmentFooter*>(static_cast<const char*>(data) + body);
+    if (std::memcmp(footer->magic, kMagic, sizeof(kMagic)) != 0 ||
+        body != footer->record_count * sizeof(LedgerRecord) + footer->account_count * sizeof(SegmentAccount) ||
+        Crc32c(data, body) != footer->crc) {
+        ::munmap(data, size);
+        data = nullptr;
+        throw std::runtime_error("Segment " + path + " is corrupt");
+    }
+    // lookups touch one account's pages, not the file in order
+    ::madvise(data, size, MADV_RANDOM);
+}
+
+MappedSegment::~MappedSegment() {
+    if (data) {
+        ::munmap(data, size);
+    }
+}
+
+std::pair<const LedgerRecord*, size_t> MappedSegment::Find(int user_id) const {
+    const LedgerRecord* records = static_cast<const LedgerRecord*>(data);
+    const SegmentAccount* accounts = reinterpret_cast<const SegmentAccount*>(records + footer->record_count);
+    const SegmentAccount* end = accounts + footer->account_count;
+    const SegmentAccount* account = std::lower_bound(accounts, end, user_id,
+        [](const SegmentAccount& entry, int id) { return entry.user_id < id; });
+    if (account == end || account->user_id != user_id) {
+        return {nullptr, 0};
+    }
+    return {records + account->first, account->count};
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ledgerRecord.h"
+
+// A segment file holds the archived transactions with ids in
+// (after_transaction_id, last_transaction_id] and never changes once
+// written. It is record_count LedgerRecords sorted by (account,
+// transaction id), a transfer being filed under both of its accounts,
+// then account_count SegmentAccounts sorted by user_id, then a
+// SegmentFooter, so an account's history is one binary search and one
+// contiguous range of the mmap'd file. The crc covers everything before
+// the footer. Files are named segment-<after>-<last>.seg.
+struct SegmentAccount {
+    int32_t user_id;
+    uint32_t count;
+    uint64_t first;
+};
+
+struct SegmentFooter {
+    char magic[8];
+    uint64_t record_count;
+    uint64_t account_count;
+    int32_t after_transaction_id;
+    int32_t last_transaction_id;
+    uint32_t crc;
+    uint32_t padding;
+};
+
+// rows must lie in (after, last]; written to a temporary file, synced and
+// renamed into place like a snapshot. Returns the path.
+std::string WriteSegment(const std::string& dir, int after_transaction_id, int last_transaction_id,
+                         const std::vector<LedgerRecord>& rows);
+
+// paths of every segment in dir, oldest first
+std::vector<std::string> ListSegments(const std::string& dir);
+
+class MappedSegment {
+public:
+    explicit MappedSegment(const std::string& path);
+    ~MappedSegment();
+    MappedSegment(const MappedSegment&) = delete;
+    MappedSegment& operator=(const MappedSegment&) = delete;
+
+    int AfterTransactionId() const { return footer->after_transaction_id; }
+    int LastTransactionId() const { return footer->last_transaction_id; }
+    size_t RecordCount() const { return footer->record_count; }
+    size_t AccountCount() const { return footer->account_count; }
+    // the account's records, oldest first; empty when it has none here
+    std::pair<const LedgerRecord*, size_t> Find(int user_id) const;
+
+private:
+    void* data = nullptr;
+    size_t size = 0;
+    const SegmentFooter* footer = nullptr;
+};
@@ -0,0 +1,163 @@
+#include "sequenced.h"
+#include "timestamp.h"
+#include "src/metrics/metrics.h"
+#include <iostream>
+#include <vector>
+
+SequencedDatabase::SequencedDatabase(size_t capacity, const SequencerOptions& options)
+    : options(options),
+      ledger(capacity),
+      ring(options.ring_size),
+      doorbell(options.wait),
+      batches(Metrics::Global().Counter("sequencer.batches")),
+      commands(Metrics::Global().Counter("sequencer.commands")) {
+    if (this->options.batch_size == 0) {
+        this->options.batch_size = 1;
+    }
+    applier = std::thread(&SequencedDatabase::Run, this);
+    if (options.cpu >= 0 && !PinToCpu(applier, options.cpu)) {
+        std::cerr << "Could not pin the sequencer to cpu " << options.cpu << std::endl;
+    }
+}
+
+SequencedDatabase::~SequencedDatabase() {
+    stopping.store(true);
+    doorbell.Ring();
+    applier.join();
+}
+
+void SequencedDatabase::Submit(const Command& command) {
+    while (!ring.TryPush(command)) {
+        // full ring, the applier is behind
+        if (options.wait == WaitStrategy::Spin) {
+            CpuRelax();
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    doorbell.Ring();
+    command.done->Wait(options.wait);
+}
+
+void SequencedDatabase::Run() {
+    std::vector<Command> batch(options.batch_size);
+    while (true) {
+        size_t count = 0;
+        while (count < batch.size() && ring.TryPop(batch[count])) {
+            ++count;
+        }
+        if (count == 0) {
+            if (stopping.load()) {
+                return;
+            }
+            doorbell.Sleep([this] { return !ring.Empty() || stopping.load(); });
+            continue;
+        }
+
+        // one clock read per batch
+        std::string timestamp = FormatTimestamp(NowMicros());
+        for (size_t i = 0; i < count; ++i) {
+            Execute(batch[i], timestamp);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            batch[i].done->Signal(options.wait);
+        }
+        batches.fetch_add(1, std::memory_order_relaxed);
+        commands.fetch_add(count, std::memory_order_relaxed);
+    }
+}
+
+void SequencedDatabase::Execute(const Command& command, const std::string& timestamp) {
+    Completion* done = command.done;
+    try {
+        switch (command.op) {
+        case Op::Create:
+            done->result = ledger.CreateAccount(command.user_id, command.amount);
+            break;
+        case Op::Balance: {
+            std::pair<double, bool> balance = ledger.GetVersionedBalance(command.user_id, &done->version);
+            done->balance = balance.first;
+            done->result = balance.second;
+            break;
+        }
+        case Op::Transfer:
+            done->result = ledger.Transfer(command.user_id, command.other_id, command.amount, timestamp);
+            if (done->result == 0 && balance_observer) {
+                Report(command.user_id);
+                Report(command.other_id);
+            }
+            break;
+        case Op::Deposit:
+            ledger.Deposit(command.user_id, command.amount, timestamp);
+            if (balance_observer) {
+                Report(command.user_id);
+            }
+            break;
+        case Op::Withdraw:
+            done->result = ledger.Withdraw(command.user_id, command.amount, timestamp);
+            if (done->result == 0 && balance_observer) {
+                Report(command.user_id);
+            }
+            break;
+        case Op::History:
+            done->rows = ledger.GetTransactionsSince(command.user_id, command.other_id);
+            break;
+        }
+    }
+    catch (...) {
+        done->error = std::current_exception();
+    }
+}
+
+void SequencedDatabase::Report(int user_id) {
+    int version;
+    double balance = ledger.GetVersionedBalance(user_id, &version).first;
+    NotifyBalance(user_id, balance, version);
+}
+
+bool SequencedDatabase::CreateAccount(int user_id, double balance) {
+    Completion done;
+    Submit({Op::Create, user_id, 0, balance, &done});
+    return done.result != 0;
+}
+
+std::pair<double, bool> SequencedDatabase::GetBalance(int user_id) {
+    Completion done;
+    Submit({Op::Balance, user_id, 0, 0, &done});
+    return {done.balance, done.result != 0};
+}
+
+int SequencedDatabase::TransferMoney(int sender_id, int receiver_id, double amount) {
+    Completion done;
+    Submit({Op::Transfer, sender_id, receiver_id, amount, &done});
+    return done.result;
+}
+
+void SequencedDatabase::DepositMoney(int user_id, double amount) {
+    Completion done;
+    Submit({Op::Deposit, user_id, 0, amount, &done});
+}
+
+int SequencedDatabase::WithdrawMoney(int user_id, double amount) {
+    Completion done;
+    Submit({Op::Withdraw, user_id, 0, amount, &done});
+    return done.result;
+}
+
+std::pair<double, bool> SequencedDatabase::GetVersionedBalance(int user_id, int* version) {
+    Completion done;
+    Submit({Op::Balance, user_id, 0, 0, &done});
+    *version = done.version;
+    return {done.balance, done.result != 0};
+}
+
+std::vector<Transaction> SequencedDatabase::GetTransactions(int user_id) {
+    return GetTransactionsSince(user_id, 0);
+}
+
+std::vector<Transaction> SequencedDatabase::GetTransactionsSince(int user_id, int since_transaction_id) {
+    Completion done;
+    Submit({Op::History, user_id, since_transaction_id, 0, &done});
+    return std::move(done.rows);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "completion.h"
+#include "ledger.h"
+#include "mpscRing.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+struct SequencerOptions {
+    size_t ring_size = 65536;
+    WaitStrategy wait = WaitStrategy::Block;
+    // commands applied before their callers are woken up
+    size_t batch_size = 256;
+    // core the applier is pinned to, -1 leaves it unpinned
+    int cpu = -1;
+};
+
+// Single writer engine in the style of the LMAX disruptor. Callers publish
+// commands into a lock-free MPSC ring and wait for their completion; one
+// applier thread drains the ring in batches and runs every command against
+// a Ledger it owns exclusively. Reads go through the ring as well, so all
+// calls are totally ordered and transaction ids follow that order.
+class SequencedDatabase : public IDatabase {
+public:
+    SequencedDatabase(size_t capacity, const SequencerOptions& options);
+    ~SequencedDatabase() override;
+
+    // false when user_id already exists
+    bool CreateAccount(int user_id, double balance);
+
+    std::pair<double, bool> GetBalance(int user_id) override;
+    int TransferMoney(int sender_id, int receiver_id, double amount) override;
+    void DepositMoney(int user_id, double amount) override;
+    int WithdrawMoney(int user_id, double amount) override;
+    std::vector<Transaction> GetTransactions(int user_id) override;
+    std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) override;
+    std::pair<double, bool> GetVersionedBalance(int user_id, int* version) override;
+
+private:
+    enum class Op { Create, Balance, Transfer, Deposit, Withdraw, History };
+
+    struct Command {
+        Op op;
+        int user_id;
+        int other_id;
+        double amount;
+        Completion* done;
+    };
+
+    void Submit(const Command& command);
+    void Run();
+    void Execute(const Command& command, const std::string& timestamp);
+    // hands the account's balance to the observer, on the applier thread
+    void Report(int user_id);
+
+    SequencerOptions options;
+    Ledger ledger;
+    MpscRing<Command> ring;
+    Doorbell doorbell;
+    std::atomic<bool> stopping{false};
+
+    std::atomic<int64_t>& batches;
+    std::atomic<int64_t>& commands;
+    std::thread applier;
+};
@@ -0,0 +1,399 @@
+#include "sharded.h"
+#include "timestamp.h"
+#include "src/metrics/metrics.h"
+#include <iostream>
+
+ShardedDatabase::Shard::Shard(size_t capacity, std::atomic<int>* transaction_ids, const ShardOptions& options)
+    : ledger(capacity / options.shards + 1, transaction_ids),
+      inbox(options.ring_size),
+      outbound(options.shards),
+      unannounced(options.shards, false),
+      doorbell(options.wait) {
+    for (size_t i = 0; i < options.shards; ++i) {
+        inbound.push_back(std::make_unique<SpscRing<Message>>(options.channel_size));
+    }
+}
+
+ShardedDatabase::ShardedDatabase(size_t capacity, const ShardOptions& options)
+    : options(options),
+      cross_shard_transfers(Metrics::Global().Counter("sharded.cross_shard_transfers")) {
+    if (this->options.shards == 0) {
+        this->options.shards = 1;
+    }
+    if (this->options.batch_size == 0) {
+        this->options.batch_size = 1;
+    }
+    for (size_t i = 0; i < this->options.shards; ++i) {
+        shards.push_back(std::make_unique<Shard>(capacity, &transaction_ids, this->options));
+    }
+    // every channel exists before the first worker can send on it
+    for (size_t i = 0; i < shards.size(); ++i) {
+        shards[i]->worker = std::thread(&ShardedDatabase::Run, this, i);
+        if (options.first_cpu >= 0 && !PinToCpu(shards[i]->worker, options.first_cpu + i)) {
+            std::cerr << "Could not pin shard " << i << " to cpu " << options.first_cpu + i << std::endl;
+        }
+    }
+}
+
+ShardedDatabase::~ShardedDatabase() {
+    stopping.store(true);
+    for (auto& shard : shards) {
+        shard->doorbell.Ring();
+    }
+    for (auto& shard : shards) {
+        shard->worker.join();
+    }
+}
+
+void ShardedDatabase::Submit(const Command& command) {
+    Shard& shard = *shards[ShardOf(command.user_id)];
+    while (!shard.inbox.TryPush(command)) {
+        // full inbox, the shard is behind
+        if (options.wait == WaitStrategy::Spin) {
+            CpuRelax();
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    shard.doorbell.Ring();
+    command.done->Wait(options.wait);
+}
+
+void ShardedDatabase::Run(size_t index) {
+    Shard& shard = *shards[index];
+    std::vector<Command> batch(options.batch_size);
+    std::vector<std::pair<size_t, Message>> messages;
+    auto has_work = [this, &shard] {
+        if (!shard.inbox.Empty() || stopping.load()) {
+            return true;
+        }
+        for (auto& channel : shard.inbound) {
+            if (!channel->Empty()) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    while (true) {
+        messages.clear();
+        for (size_t from = 0; from < shards.size(); ++from) {
+            Message message;
+            for (size_t n = 0; n < options.batch_size && shard.inbound[from]->TryPop(message); ++n) {
+                messages.emplace_back(from, std::move(message));
+            }
+        }
+        size_t count = 0;
+        while (count < batch.size() && shard.inbox.TryPop(batch[count])) {
+            ++count;
+        }
+
+        if (messages.empty() && count == 0) {
+            if (Flush(index)) {
+                continue; // a peer's channel is full, keep offering
+            }
+            if (stopping.load()) {
+                return;
+            }
+            shard.doorbell.Sleep(has_work);
+            continue;
+        }
+
+        // one clock read per batch
+        std::string timestamp = FormatTimestamp(NowMicros());
+        for (auto& message : messages) {
+            Handle(index, message.first, message.second, timestamp);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (Execute(index, batch[i], timestamp)) {
+                batch[i].done->Signal(options.wait);
+            }
+        }
+        Flush(index);
+    }
+}
+
+// false when the command waits for another shard and completes later
+bool ShardedDatabase::Execute(size_t index, const Command& command, const std::string& timestamp) {
+    Shard& shard = *shards[index];
+    Completion* done = command.done;
+    if (Defer(shard, command)) {
+        return false;
+    }
+    try {
+        switch (command.op) {
+        case Op::Create:
+            done->result = shard.ledger.CreateAccount(command.user_id, command.amount);
+            break;
+        case Op::Balance: {
+            std::pair<double, bool> balance = shard.ledger.GetVersionedBalance(command.user_id, &done->version);
+            done->balance = balance.first;
+            done->result = balance.second;
+            break;
+        }
+        case Op::Transfer: {
+            size_t to = ShardOf(command.other_id);
+            if (to == index) {
+                done->result = shard.ledger.Transfer(command.user_id, command.other_id, command.amount, timestamp);
+                if (done->result == 0 && balance_observer) {
+                    Report(shard, command.user_id);
+                    Report(shard, command.other_id);
+                }
+                break;
+            }
+            if (!shard.ledger.Exists(command.user_id)) {
+                done->result = 1; // sender not found
+                break;
+            }
+            Message message;
+            if (command.other_id < command.user_id) {
+                // the lower id is held first, the reservation follows Locked
+                message.kind = Message::Lock;
+            }
+            else if (shard.ledger.Reserve(command.user_id, command.amount) == 0) {
+                shard.held[command.user_id];
+                message.kind = Message::Credit;
+            }
+            else {
+                // a missing receiver outranks not enough money, so that
+                // case still asks the receiver's shard
+                message.kind = Message::Probe;
+            }
+            message.transfer = shard.next_transfer++;
+            message.sender_id = command.user_id;
+            message.receiver_id = command.other_id;
+            message.amount = command.amount;
+            shard.in_flight.emplace(message.transfer, command);
+            Send(index, to, std::move(message));
+            cross_shard_transfers.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        case Op::Deposit:
+            shard.ledger.Deposit(command.user_id, command.amount, timestamp);
+            if (balance_observer) {
+                Report(shard, command.user_id);
+            }
+            break;
+        case Op::Withdraw:
+            done->result = shard.ledger.Withdraw(command.user_id, command.amount, timestamp);
+            if (done->result == 0 && balance_observer) {
+                Report(shard, command.user_id);
+            }
+            break;
+        case Op::History:
+            done->rows = shard.ledger.GetTransactionsSince(command.user_id, command.other_id);
+            break;
+        }
+    }
+    catch (...) {
+        done->error = std::current_exception();
+    }
+    return true;
+}
+
+void ShardedDatabase::Handle(size_t index, size_t from, Message& message, const std::string& timestamp) {
+    Shard& shard = *shards[index];
+    int receiver_id = message.receiver_id;
+    switch (message.kind) {
+    case Message::Credit: {
+        bool locked = message.locked;
+        if (!locked && shard.held.count(receiver_id) != 0) {
+            shard.held[receiver_id].push_back({true, from, {}, std::move(message)});
+            return;
+        }
+        if (shard.ledger.Exists(receiver_id)) {
+            message.row = shard.ledger.Credit(message.sender_id, receiver_id, message.amount, timestamp);
+            message.kind = Message::Credited;
+            if (balance_observer) {
+                Report(shard, receiver_id);
+            }
+        }
+        else {
+            message.kind = Message::Refused;
+        }
+        Send(index, from, std::move(message));
+        if (locked) {
+            Unhold(index, receiver_id, timestamp);
+        }
+        return;
+    }
+    case Message::Probe:
+        message.kind = Message::Probed;
+        message.found = shard.ledger.Exists(receiver_id);
+        Send(index, from, std::move(message));
+        return;
+    case Message::Lock:
+        message.found = shard.ledger.Exists(receiver_id);
+        if (message.found && shard.held.count(receiver_id) != 0) {
+            shard.held[receiver_id].push_back({true, from, {}, std::move(message)});
+            return;
+        }
+        if (message.found) {
+            shard.held[receiver_id];
+        }
+        message.kind = Message::Locked;
+        Send(index, from, std::move(message));
+        return;
+    case Message::Unlock:
+        Unhold(index, receiver_id, timestamp);
+        return;
+    default:
+        break;
+    }
+
+    int sender_id = message.sender_id;
+    if (message.kind == Message::Locked && message.found) {
+        // the receiver is held for this transfer, now the sender
+        if (shard.held.count(sender_id) != 0) {
+            shard.held[sender_id].push_back({true, from, {}, std::move(message)});
+            return;
+        }
+        if (shard.ledger.Reserve(sender_id, message.amount) == 0) {
+            shard.held[sender_id];
+            message.kind = Message::Credit;
+            message.locked = true;
+            Send(index, from, std::move(message));
+            return;
+        }
+        Message unlock = message;
+        unlock.kind = Message::Unlock;
+        Send(index, from, std::move(unlock));
+        message.kind = Message::Probed; // found, not enough money
+    }
+
+    auto it = shard.in_flight.find(message.transfer);
+    Completion* done = it->second.done;
+    shard.in_flight.erase(it);
+    if (message.kind == Message::Credited) {
+        shard.ledger.Settle(message.row);
+        done->result = 0; //success
+        if (balance_observer) {
+            Report(shard, sender_id);
+        }
+        Unhold(index, sender_id, timestamp);
+    }
+    else if (message.kind == Message::Refused) {
+        shard.ledger.Release(sender_id, message.amount);
+        done->result = 2; // receiver not found
+        Unhold(index, sender_id, timestamp);
+    }
+    else {
+        done->result = message.found ? 3 : 2;
+    }
+    done->Signal(options.wait);
+}
+
+bool ShardedDatabase::Defer(Shard& shard, const Command& command) {
+    if (command.op != Op::Transfer && command.op != Op::Deposit && command.op != Op::Withdraw) {
+        return false;
+    }
+    auto it = shard.held.find(command.user_id);
+    if (it == shard.held.end() && command.op == Op::Transfer && ShardOf(command.other_id) == ShardOf(command.user_id)) {
+        it = shard.held.find(command.other_id);
+    }
+    if (it == shard.held.end()) {
+        return false;
+    }
+    it->second.push_back({false, 0, command, {}});
+    return true;
+}
+
+void ShardedDatabase::Unhold(size_t index, int user_id, const std::string& timestamp) {
+    Shard& shard = *shards[index];
+    auto it = shard.held.find(user_id);
+    std::deque<Waiting> waiting = std::move(it->second);
+    shard.held.erase(it);
+    // whatever takes the hold again queues the rest behind it, in order
+    for (Waiting& work : waiting) {
+        if (work.is_message) {
+            Handle(index, work.from, work.message, timestamp);
+        }
+        else if (Execute(index, work.command, timestamp)) {
+            work.command.done->Signal(options.wait);
+        }
+    }
+}
+
+void ShardedDatabase::Send(size_t index, size_t to, Message&& message) {
+    Shard& shard = *shards[index];
+    // keep the channel in order behind anything already waiting
+    if (!shard.outbound[to].empty() || !shards[to]->inbound[index]->TryPush(std::move(message))) {
+        shard.outbound[to].push_back(std::move(message));
+        return;
+    }
+    shard.unannounced[to] = true;
+}
+
+// pushes waiting messages and rings the peers that got some; true while
+// messages are still waiting
+bool ShardedDatabase::Flush(size_t index) {
+    Shard& shard = *shards[index];
+    bool waiting = false;
+    for (size_t to = 0; to < shards.size(); ++to) {
+        std::deque<Message>& pending = shard.outbound[to];
+        while (!pending.empty() && shards[to]->inbound[index]->TryPush(std::move(pending.front()))) {
+            pending.pop_front();
+            shard.unannounced[to] = true;
+        }
+        waiting = waiting || !pending.empty();
+        if (shard.unannounced[to]) {
+            shard.unannounced[to] = false;
+            shards[to]->doorbell.Ring();
+        }
+    }
+    return waiting;
+}
+
+// the version is the account's newest row
+void ShardedDatabase::Report(Shard& shard, int user_id) {
+    int version;
+    double balance = shard.ledger.GetVersionedBalance(user_id, &version).first;
+    NotifyBalance(user_id, balance, version);
+}
+
+bool ShardedDatabase::CreateAccount(int user_id, double balance) {
+    Completion done;
+    Submit({Op::Create, user_id, 0, balance, &done});
+    return done.result != 0;
+}
+
+std::pair<double, bool> ShardedDatabase::GetBalance(int user_id) {
+    Completion done;
+    Submit({Op::Balance, user_id, 0, 0, &done});
+    return {done.balance, done.result != 0};
+}
+
+int ShardedDatabase::TransferMoney(int sender_id, int receiver_id, double amount) {
+    Completion done;
+    Submit({Op::Transfer, sender_id, receiver_id, amount, &done});
+    return done.result;
+}
+
+void ShardedDatabase::DepositMoney(int user_id, double amount) {
+    Completion done;
+    Submit({Op::Deposit, user_id, 0, amount, &done});
+}
+
+int ShardedDatabase::WithdrawMoney(int user_id, double amount) {
+    Completion done;
+    Submit({Op::Withdraw, user_id, 0, amount, &done});
+    return done.result;
+}
+
+std::pair<double, bool> ShardedDatabase::GetVersionedBalance(int user_id, int* version) {
+    Completion done;
+    Submit({Op::Balance, user_id, 0, 0, &done});
+    *version = done.version;
+    return {done.balance, done.result != 0};
+}
+
+std::vector<Transaction> ShardedDatabase::GetTransactions(int user_id) {
+    return GetTransactionsSince(user_id, 0);
+}
+
+std::vector<Transaction> ShardedDatabase::GetTransactionsSince(int user_id, int since_transaction_id) {
+    Completion done;
+    Submit({Op::History, user_id, since_transaction_id, 0, &done});
+    return std::move(done.rows);
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include "completion.h"
+#include "ledger.h"
+#include "mpscRing.h"
+#include "spscRing.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct ShardOptions {
+    size_t shards = 4;
+    // commands from callers waiting for one shard
+    size_t ring_size = 16384;
+    // messages in flight from one shard to another
+    size_t channel_size = 4096;
+    WaitStrategy wait = WaitStrategy::Block;
+    size_t batch_size = 256;
+    // shard i is pinned to first_cpu + i, -1 leaves them unpinned
+    int first_cpu = -1;
+};
+
+// Shard-per-core engine. The user_id space is split across worker threads
+// and each one owns the Ledger of its accounts outright; callers hand a
+// command to the shard that owns the account it is about and wait for it.
+// A transfer between two shards is a message exchange over SPSC channels:
+// the sender's shard reserves the amount, the receiver's shard credits it
+// and writes the row, and the sender's shard then settles the debit under
+// the same id, or releases the reservation when the receiver does not
+// exist. Both accounts are held while the transfer is open, so no other
+// row lands on either and every history stays append-only in id order:
+// writes to a held account wait on its shard until the hold ends. Holds
+// are taken in user id order, a receiver with the lower id is locked
+// before the sender reserves, so transfers never wait on each other in a
+// cycle. Return codes are the same as for PostgresDatabase.
+class ShardedDatabase : public IDatabase {
+public:
+    ShardedDatabase(size_t capacity, const ShardOptions& options);
+    ~ShardedDatabase() override;
+
+    // false when user_id already exists
+    bool CreateAccount(int user_id, double balance);
+    size_t ShardOf(int user_id) const { return static_cast<uint32_t>(user_id) % shards.size(); }
+
+    std::pair<double, bool> GetBalance(int user_id) override;
+    int TransferMoney(int sender_id, int receiver_id, double amount) override;
+    void DepositMoney(int user_id, double amount) override;
+    int WithdrawMoney(int user_id, double amount) override;
+    std::vector<Transaction> GetTransactions(int user_id) override;
+    std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) override;
+    std::pair<double, bool> GetVersionedBalance(int user_id, int* version) override;
+
+private:
+    enum class Op { Create, Balance, Transfer, Deposit, Withdraw, History };
+
+    struct Command {
+        Op op;
+        int user_id;
+        int other_id;
+        double amount;
+        Completion* done;
+    };
+
+    // Credit, Probe, Lock and Unlock go to the receiver's shard, the other
+    // kinds answer them; transfer is the id the sender's shard filed the
+    // command under, locked marks a Credit for a receiver it holds already
+    struct Message {
+        enum Kind { Credit, Probe, Lock, Unlock, Credited, Refused, Probed, Locked };
+
+        Kind kind = Credit;
+        uint64_t transfer = 0;
+        int sender_id = 0;
+        int receiver_id = 0;
+        double amount = 0;
+        bool found = false;
+        bool locked = false;
+        Transaction row;
+    };
+
+    // a command or message put off until an account's hold ends
+    struct Waiting {
+        bool is_message = false;
+        size_t from = 0;
+        Command command;
+        Message message;
+    };
+
+    struct alignas(64) Shard {
+        Shard(size_t capacity, std::atomic<int>* transaction_ids, const ShardOptions& options);
+
+        Ledger ledger;
+        MpscRing<Command> inbox;
+        // inbound[i] carries the messages of shard i
+        std::vector<std::unique_ptr<SpscRing<Message>>> inbound;
+        // messages for shard i that did not fit into its channel yet
+        std::vector<std::deque<Message>> outbound;
+        std::vector<bool> unannounced;
+        // cross shard transfers waiting for the receiver's shard
+        std::unordered_map<uint64_t, Command> in_flight;
+        // accounts an open cross shard transfer holds, with the work
+        // waiting for them in arrival order
+        std::unordered_map<int, std::deque<Waiting>> held;
+        uint64_t next_transfer = 0;
+        Doorbell doorbell;
+        std::thread worker;
+    };
+
+    void Submit(const Command& command);
+    void Run(size_t index);
+    bool Execute(size_t index, const Command& command, const std::string& timestamp);
+    void Handle(size_t index, size_t from, Message& message, const std::string& timestamp);
+    void Send(size_t index, size_t to, Message&& message);
+    bool Flush(size_t index);
+    // queues a write to a held account, true when the command has to wait
+    bool Defer(Shard& shard, const Command& command);
+    // ends the hold on user_id and runs what waited for it
+    void Unhold(size_t index, int user_id, const std::string& timestamp);
+    // hands the account's balance to the observer, on its shard's thread
+    void Report(Shard& shard, int user_id);
+
+    ShardOptions options;
+    std::atomic<int> transaction_ids{1};
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> stopping{false};
+    std::atomic<int64_t>& cross_shard_transfers;
+};
@@ -0,0 +1,152 @@
+#include "snapshot.h"
+#include "crc32c.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'B', 'A', 'N', 'K', 'S', 'N', 'P', '1'};
+
+void WriteAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Snapshot write failed: ") + std::strerror(errno));
+        }
+        p += written;
+        size -= written;
+    }
+}
+
+// closes fd in any case
+void SyncAndClose(int fd, const std::string& path) {
+    if (::fsync(fd) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot sync " + path + ": " + std::strerror(error));
+    }
+    if (::close(fd) != 0) {
+        throw std::runtime_error("Cannot close " + path + ": " + std::strerror(errno));
+    }
+}
+
+}
+
+void WriteSnapshot(const std::string& dir, uint64_t lsn,
+                   const std::vector<SnapshotAccount>& accounts,
+                   const std::vector<LedgerRecord>& records) {
+    char name[40];
+    std::snprintf(name, sizeof(name), "snapshot-%016llx.bin", static_cast<unsigned long long>(lsn));
+    std::string path = dir + "/" + name;
+    std::string tmp = path + ".tmp";
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.lsn = lsn;
+    header.account_count = accounts.size();
+    header.record_count = records.size();
+    header.crc = Crc32c(accounts.data(), accounts.size() * sizeof(SnapshotAccount));
+    header.crc = Crc32c(records.data(), records.size() * sizeof(LedgerRecord), header.crc);
+
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create " + tmp + ": " + std::strerror(errno));
+    }
+    // the WAL it replaces is deleted next, so it must be on disk before it
+    // takes the place of the previous snapshot
+    try {
+        WriteAll(fd, &header, sizeof(header));
+        WriteAll(fd, accounts.data(), accounts.size() * sizeof(SnapshotAccount));
+        WriteAll(fd, records.data(), records.size() * sizeof(LedgerRecord));
+    }
+    catch (...) {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        throw;
+    }
+    try {
+        SyncAndClose(fd, tmp);
+    }
+    catch (...) {
+        ::unlink(tmp.c_str());
+        throw;
+    }
+
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename " + tmp + ": " + std::strerror(errno));
+    }
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        throw std::runtime_error("Cannot open " + dir + ": " + std::strerror(errno));
+    }
+    SyncAndClose(dir_fd, dir);
+}
+
+std::vector<std::pair<uint64_t, std::string>> ListSnapshots(const std::string& dir) {
+    std::vector<std::pair<uint64_t, std::string>> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        std::string name = entry.path().filename().string();
+        unsigned long long lsn;
+        if (name.size() == 29 && std::sscanf(name.c_str(), "snapshot-%16llx.bin", &lsn) == 1) {
+            files.emplace_back(lsn, entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+MappedSnapshot::MappedSnapshot(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Snapshot " + path + " is truncated");
+    }
+    size = st.st_size;
+    data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        throw std::runtime_error("Cannot mmap " + path + ": " + std::strerror(errno));
+    }
+    ::madvise(data, size, MADV_SEQUENTIAL);
+
+    header = static_cast<const SnapshotHeader*>(data);
+    size_t body = header->account_count * sizeof(SnapshotAccount) + header->record_count * sizeof(LedgerRecord);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || size != sizeof(SnapshotHeader) + body ||
+        Crc32c(static_cast<const char*>(data) + sizeof(SnapshotHeader), body) != header->crc) {
+        ::munmap(data, size);
+        data = nullptr;
+        throw std::runtime_error("Snapshot " + path + " is corrupt");
+    }
+}
+
+MappedSnapshot::~MappedSnapshot() {
+    if (data) {
+        ::munmap(data, size);
+    }
+}
+
+const SnapshotAccount* MappedSnapshot::Accounts() const {
+    return reinterpret_cast<const SnapshotAccount*>(static_cast<const char*>(data) + sizeof(SnapshotHeader));
+}
+
+const LedgerRecord* MappedSnapshot::Records() const {
+    return reinterpret_cast<const LedgerRecord*>(Accounts() + header->account_count);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ledgerRecord.h"
+
+// A snapshot file is a SnapshotHeader followed by account_count
+// SnapshotAccounts and record_count LedgerRecords, all fixed size so the
+// file is used in place through mmap. The crc covers everything after the
+// header. Files are named snapshot-<lsn>.bin, lsn being the last WAL entry
+// the snapshot includes.
+struct SnapshotAccount {
+    int32_t user_id;
+    int32_t padding;
+    double balance;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t lsn;
+    uint64_t account_count;
+    uint64_t record_count;
+    uint32_t crc;
+    uint32_t padding;
+};
+
+// written to a temporary file, synced and renamed into place
+void WriteSnapshot(const std::string& dir, uint64_t lsn,
+                   const std::vector<SnapshotAccount>& accounts,
+                   const std::vector<LedgerRecord>& records);
+
+// (lsn, path) of every snapshot in dir, oldest first
+std::vector<std::pair<uint64_t, std::string>> ListSnapshots(const std::string& dir);
+
+class MappedSnapshot {
+public:
+    explicit MappedSnapshot(const std::string& path);
+    ~MappedSnapshot();
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    uint64_t Lsn() const { return header->lsn; }
+    const SnapshotAccount* Accounts() const;
+    size_t AccountCount() const { return header->account_count; }
+    const LedgerRecord* Records() const;
+    size_t RecordCount() const { return header->record_count; }
+
+private:
+    void* data = nullptr;
+    size_t size = 0;
+    const SnapshotHeader* header = nullptr;
+};
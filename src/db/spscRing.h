@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free ring for exactly one producer and one consumer thread.
+// Each side owns one index and keeps a cached copy of the other one, so
+// the shared cache lines are only read when the cached view runs out.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        slots.reset(new T[size]);
+    }
+
+    // producer only, false when the ring is full
+    bool TryPush(T&& value) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        if (pos - cached_tail > mask) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (pos - cached_tail > mask) {
+                return false;
+            }
+        }
+        slots[pos & mask] = std::move(value);
+        head.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    bool TryPop(T& value) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        if (pos == cached_head) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (pos == cached_head) {
+                return false;
+            }
+        }
+        value = std::move(slots[pos & mask]);
+        tail.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    bool Empty() const {
+        return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+    }
+
+private:
+    size_t mask;
+    std::unique_ptr<T[]> slots;
+    alignas(64) std::atomic<size_t> head{0};
+    size_t cached_tail = 0;
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t cached_head = 0;
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+// Postgres style "YYYY-MM-DD HH:MM:SS[.ffffff]" in local time, so rows from
+// the in-process engines look like rows read from the transactions table
+
+inline int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+inline std::string FormatTimestamp(int64_t micros) {
+    std::time_t seconds = micros / 1000000;
+    int fraction = micros % 1000000;
+    // localtime_r takes a process wide lock, so the date part is only
+    // rebuilt once per second and thread
+    thread_local std::time_t cached_seconds = -1;
+    thread_local char cached[20];
+    if (seconds != cached_seconds) {
+        std::tm local;
+        localtime_r(&seconds, &local);
+        std::strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &local);
+        cached_seconds = seconds;
+    }
+    char buffer[32];
+    std::memcpy(buffer, cached, 19);
+    size_t length = 19;
+    if (fraction != 0) {
+        buffer[length++] = '.';
+        for (int divisor = 100000; divisor > 0; divisor /= 10) {
+            buffer[length++] = '0' + fraction / divisor % 10;
+        }
+        while (buffer[length - 1] == '0') {
+            --length;
+        }
+    }
+    return std::string(buffer, length);
+}
+
+// inverse of FormatTimestamp, -1 when the text is not a timestamp
+inline int64_t ParseTimestamp(const std::string& text) {
+    if (text.size() < 19) {
+        return -1;
+    }
+    thread_local std::string cached_prefix;
+    thread_local int64_t cached_seconds = -1;
+    if (text.compare(0, 19, cached_prefix) != 0) {
+        std::tm local = {};
+        if (std::sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &local.tm_year, &local.tm_mon, &local.tm_mday,
+                        &local.tm_hour, &local.tm_min, &local.tm_sec) != 6) {
+            return -1;
+        }
+        local.tm_year -= 1900;
+        local.tm_mon -= 1;
+        local.tm_isdst = -1;
+        cached_seconds = std::mktime(&local);
+        cached_prefix = text.substr(0, 19);
+    }
+    int64_t fraction = 0;
+    if (text.size() > 20 && text[19] == '.') {
+        int digits = 0;
+        for (size_t i = 20; i < text.size() && digits < 6 && std::isdigit(static_cast<unsigned char>(text[i])); ++i, ++digits) {
+            fraction = fraction * 10 + (text[i] - '0');
+        }
+        for (; digits < 6; ++digits) {
+            fraction *= 10;
+        }
+    }
+    return cached_seconds * 1000000 + fraction;
+}
@@ -0,0 +1,213 @@
+#include "wal.h"
+#include "crc32c.h"
+#include "src/metrics/metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+std::string WalFileName(const std::string& dir, uint64_t first_lsn) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "wal-%016llx.log", static_cast<unsigned long long>(first_lsn));
+    return dir + "/" + name;
+}
+
+void WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("WAL write failed: ") + std::strerror(errno));
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+}
+
+WalWriter::WalWriter(const std::string& dir, uint64_t next_lsn, int group_commit_us)
+    : dir(dir), group_commit_us(group_commit_us), next_lsn(next_lsn), durable_lsn(next_lsn - 1) {
+    Open();
+    flusher = std::thread(&WalWriter::FlushLoop, this);
+}
+
+WalWriter::~WalWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    flusher.join();
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void WalWriter::Open() {
+    std::string path = WalFileName(dir, next_lsn);
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+    // make the new file itself survive a crash
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0 || ::fsync(dir_fd) != 0) {
+        std::string error = std::strerror(errno);
+        if (dir_fd >= 0) {
+            ::close(dir_fd);
+        }
+        throw std::runtime_error("Cannot sync " + dir + ": " + error);
+    }
+    ::close(dir_fd);
+}
+
+uint64_t WalWriter::Append(WalEntry::Type type, const LedgerRecord& record) {
+    WalEntry entry;
+    std::memset(&entry, 0, sizeof(entry));
+    entry.type = type;
+    entry.record = record;
+
+    char frame[8 + sizeof(WalEntry)];
+    uint32_t size = sizeof(WalEntry);
+    uint64_t lsn;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!failure.empty()) {
+            throw std::runtime_error(failure);
+        }
+        lsn = next_lsn++;
+        entry.lsn = lsn;
+        uint32_t crc = Crc32c(&entry, sizeof(entry));
+        std::memcpy(frame, &size, 4);
+        std::memcpy(frame + 4, &crc, 4);
+        std::memcpy(frame + 8, &entry, sizeof(entry));
+        buffer.append(frame, sizeof(frame));
+    }
+    work_cv.notify_one();
+    return lsn;
+}
+
+void WalWriter::WaitDurable(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mtx);
+    durable_cv.wait(lock, [this, lsn] { return durable_lsn >= lsn || !failure.empty(); });
+    if (durable_lsn < lsn) {
+        throw std::runtime_error(failure);
+    }
+}
+
+uint64_t WalWriter::Rotate() {
+    std::unique_lock<std::mutex> lock(mtx);
+    durable_cv.wait(lock, [this] { return (buffer.empty() && !writing) || !failure.empty(); });
+    if (!failure.empty()) {
+        throw std::runtime_error(failure);
+    }
+    int closed = ::close(fd);
+    fd = -1;
+    try {
+        if (closed != 0) {
+            throw std::runtime_error(std::string("WAL close failed: ") + std::strerror(errno));
+        }
+        uint64_t last = next_lsn - 1;
+        Open();
+        return last;
+    }
+    catch (const std::exception& e) {
+        failure = e.what();
+        durable_cv.notify_all();
+        throw;
+    }
+}
+
+void WalWriter::FlushLoop() {
+    static auto& syncs = Metrics::Global().Counter("wal.fsyncs");
+    static auto& bytes = Metrics::Global().Counter("wal.bytes");
+    static auto& failures = Metrics::Global().Counter("wal.failures");
+    std::string batch;
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        work_cv.wait(lock, [this] { return !buffer.empty() || stopping; });
+        if (buffer.empty() && stopping) {
+            return;
+        }
+        if (group_commit_us > 0) {
+            // let more committers join this sync
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::microseconds(group_commit_us));
+            lock.lock();
+        }
+        batch.swap(buffer);
+        uint64_t batch_lsn = next_lsn - 1;
+        writing = true;
+        lock.unlock();
+
+        try {
+            WriteAll(fd, batch.data(), batch.size());
+            if (::fdatasync(fd) != 0) {
+                throw std::runtime_error(std::string("WAL fdatasync failed: ") + std::strerror(errno));
+            }
+        }
+        catch (const std::exception& e) {
+            // how much of the batch reached the disk is unknown, and a
+            // failed fdatasync may have dropped earlier pages too
+            failures.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+            writing = false;
+            failure = e.what();
+            durable_cv.notify_all();
+            return;
+        }
+        syncs.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(batch.size(), std::memory_order_relaxed);
+        batch.clear();
+
+        lock.lock();
+        writing = false;
+        durable_lsn = batch_lsn;
+        durable_cv.notify_all();
+    }
+}
+
+std::vector<std::pair<uint64_t, std::string>> ListWalFiles(const std::string& dir) {
+    std::vector<std::pair<uint64_t, std::string>> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        std::string name = entry.path().filename().string();
+        unsigned long long first_lsn;
+        if (name.size() == 24 && std::sscanf(name.c_str(), "wal-%16llx.log", &first_lsn) == 1) {
+            files.emplace_back(first_lsn, entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::vector<WalEntry> ReadWalFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<WalEntry> entries;
+    char header[8];
+    WalEntry entry;
+    while (file.read(header, sizeof(header))) {
+        uint32_t size;
+        uint32_t crc;
+        std::memcpy(&size, header, 4);
+        std::memcpy(&crc, header + 4, 4);
+        if (size != sizeof(WalEntry) || !file.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+            break;
+        }
+        if (Crc32c(&entry, sizeof(entry)) != crc) {
+            break;
+        }
+        entries.push_back(entry);
+    }
+    return entries;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ledgerRecord.h"
+
+// On disk every entry is [u32 body size][u32 crc32c(body)][body], the body
+// being a WalEntry. Files are named wal-<first lsn>.log; a writer always
+// starts a fresh file, so a torn tail is never appended to.
+struct WalEntry {
+    enum Type : uint8_t {
+        kCreateAccount = 1, // record.sender_id with record.amount as balance
+        kMutation = 2,
+    };
+
+    uint64_t lsn;
+    uint8_t type;
+    uint8_t padding[7];
+    LedgerRecord record;
+};
+static_assert(sizeof(WalEntry) == 48, "WalEntry is part of the file format");
+
+// Appends are buffered; one flusher thread writes and fdatasyncs whatever
+// accumulated since its last flush, so concurrent committers share a sync.
+// It is fail-stop: once a write or sync fails nothing more is acknowledged,
+// waiters not yet durable and every later Append or Rotate throw
+// runtime_error with the cause.
+class WalWriter {
+public:
+    WalWriter(const std::string& dir, uint64_t next_lsn, int group_commit_us);
+    ~WalWriter();
+
+    uint64_t Append(WalEntry::Type type, const LedgerRecord& record);
+    void WaitDurable(uint64_t lsn);
+
+    // Closes the current file once everything appended is on disk and opens
+    // a new one; returns the last lsn of the closed file. Callers keep
+    // appends out while rotating.
+    uint64_t Rotate();
+
+private:
+    void Open();
+    void FlushLoop();
+
+    std::string dir;
+    int group_commit_us;
+    int fd = -1;
+
+    std::mutex mtx;
+    std::condition_variable work_cv;
+    std::condition_variable durable_cv;
+    std::string buffer;
+    uint64_t next_lsn;
+    uint64_t durable_lsn;
+    bool writing = false;
+    bool stopping = false;
+    // why the log stopped, empty while it works
+    std::string failure;
+    std::thread flusher;
+};
+
+// (first lsn, path) of every WAL file in dir, oldest first
+std::vector<std::pair<uint64_t, std::string>> ListWalFiles(const std::string& dir);
+
+// entries of one file up to the first torn or corrupt one
+std::vector<WalEntry> ReadWalFile(const std::string& path);
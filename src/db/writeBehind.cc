@@ -0,0 +1,174 @@
+#include "writeBehind.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include "src/metrics/metrics.h"
+
+WriteBehindDatabase::WriteBehindDatabase(DurableDatabase* local, WriteBehindSink* sink, size_t max_lag,
+                                         size_t batch_rows, int flush_ms)
+    : local(local), sink(sink), max_lag(std::max<size_t>(max_lag, 1)), batch_rows(std::max<size_t>(batch_rows, 1)),
+      flush_ms(flush_ms),
+      lag_rows(Metrics::Global().Counter("write_behind.lag_rows")),
+      rows_written(Metrics::Global().Counter("write_behind.rows_written")),
+      batches_written(Metrics::Global().Counter("write_behind.batches_written")),
+      write_failures(Metrics::Global().Counter("write_behind.write_failures")),
+      backpressure_waits(Metrics::Global().Counter("write_behind.backpressure_waits")),
+      skipped_ids(Metrics::Global().Counter("write_behind.skipped_ids")) {
+    written_through = sink->Checkpoint();
+    if (local->LastTransactionId() < written_through) {
+        throw std::runtime_error("Local ledger ends at transaction " + std::to_string(local->LastTransactionId()) +
+                                 " but " + std::to_string(written_through) + " were already written");
+    }
+    // whatever the last run committed but did not get to write
+    for (const LedgerRecord& record : local->CommittedSince(written_through)) {
+        pending.emplace(record.transaction_id, record);
+    }
+    ready_through = pending.empty() ? written_through : pending.rbegin()->first;
+    flush_through = ready_through;
+    lag_rows.store(pending.size(), std::memory_order_relaxed);
+
+    local->SetCommitObserver([this](const LedgerRecord& record, bool durable) { Enqueue(record, durable); });
+    flusher = std::thread([this] { FlushLoop(); });
+}
+
+WriteBehindDatabase::~WriteBehindDatabase() {
+    local->SetCommitObserver(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    written_cv.notify_all();
+    flusher.join();
+}
+
+void WriteBehindDatabase::Enqueue(const LedgerRecord& record, bool durable) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!durable) {
+        skipped_ids.fetch_add(1, std::memory_order_relaxed);
+        skipped.insert(record.transaction_id);
+        Advance();
+        return;
+    }
+    if (record.transaction_id > written_through + (int)max_lag) {
+        backpressure_waits.fetch_add(1, std::memory_order_relaxed);
+        work_cv.notify_one();
+        written_cv.wait(lock, [this, &record] {
+            return stopping || record.transaction_id <= written_through + (int)max_lag;
+        });
+    }
+    pending.emplace(record.transaction_id, record);
+    Advance();
+    lag_rows.store(pending.size(), std::memory_order_relaxed);
+    if (ready_through - written_through >= (int)batch_rows) {
+        work_cv.notify_one();
+    }
+}
+
+void WriteBehindDatabase::Advance() {
+    while (pending.count(ready_through + 1) != 0 || skipped.count(ready_through + 1) != 0) {
+        ready_through++;
+    }
+    bool moved = false;
+    while (!skipped.empty() && *skipped.begin() <= written_through + 1) {
+        written_through = std::max(written_through, *skipped.begin());
+        skipped.erase(skipped.begin());
+        moved = true;
+    }
+    if (moved) {
+        written_cv.notify_all();
+    }
+}
+
+std::vector<LedgerRecord> WriteBehindDatabase::NextBatch() const {
+    std::vector<LedgerRecord> batch;
+    for (auto it = pending.begin(); it != pending.end() && it->first <= ready_through && batch.size() < batch_rows; ++it) {
+        batch.push_back(it->second);
+    }
+    return batch;
+}
+
+// a wakeup writes everything that is ready, a full batch at a time
+void WriteBehindDatabase::FlushLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        work_cv.wait_for(lock, std::chrono::milliseconds(flush_ms), [this] {
+            return stopping || flush_through > written_through || ready_through - written_through >= (int)batch_rows;
+        });
+        bool failed = false;
+        for (std::vector<LedgerRecord> batch = NextBatch(); !batch.empty(); batch = NextBatch()) {
+            lock.unlock();
+            try {
+                sink->Write(batch);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Write-behind batch failed: " << e.what() << std::endl;
+                failed = true;
+            }
+            lock.lock();
+            if (failed) {
+                write_failures.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            pending.erase(pending.begin(), pending.upper_bound(batch.back().transaction_id));
+            written_through = batch.back().transaction_id;
+            Advance();
+            rows_written.fetch_add(batch.size(), std::memory_order_relaxed);
+            batches_written.fetch_add(1, std::memory_order_relaxed);
+            lag_rows.store(pending.size(), std::memory_order_relaxed);
+            written_cv.notify_all();
+        }
+        if (stopping) {
+            return;
+        }
+        if (failed) {
+            work_cv.wait_for(lock, std::chrono::milliseconds(flush_ms), [this] { return stopping; });
+        }
+    }
+}
+
+void WriteBehindDatabase::Flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    int target = pending.empty() ? written_through : pending.rbegin()->first;
+    flush_through = std::max(flush_through, target);
+    work_cv.notify_one();
+    written_cv.wait(lock, [this, target] { return written_through >= target; });
+}
+
+size_t WriteBehindDatabase::Lag() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return pending.size();
+}
+
+int WriteBehindDatabase::TransferMoney(int sender_id, int receiver_id, double amount) {
+    return local->TransferMoney(sender_id, receiver_id, amount);
+}
+
+std::pair<double, bool> WriteBehindDatabase::GetBalance(int user_id) {
+    return local->GetBalance(user_id);
+}
+
+void WriteBehindDatabase::DepositMoney(int user_id, double amount) {
+    local->DepositMoney(user_id, amount);
+}
+
+int WriteBehindDatabase::WithdrawMoney(int user_id, double amount) {
+    return local->WithdrawMoney(user_id, amount);
+}
+
+std::vector<Transaction> WriteBehindDatabase::GetTransactions(int user_id) {
+    return local->GetTransactions(user_id);
+}
+
+std::vector<Transaction> WriteBehindDatabase::GetTransactionsSince(int user_id, int since_transaction_id) {
+    return local->GetTransactionsSince(user_id, since_transaction_id);
+}
+
+std::pair<double, bool> WriteBehindDatabase::GetVersionedBalance(int user_id, int* version) {
+    return local->GetVersionedBalance(user_id, version);
+}
+
+void WriteBehindDatabase::SetBalanceObserver(BalanceObserver observer) {
+    local->SetBalanceObserver(std::move(observer));
+}
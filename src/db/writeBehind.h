@@ -0,0 +1,90 @@
+#pragma once
+#include "durable.h"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// Where WriteBehindDatabase persists to; PostgresWriteBehindSink in
+// production.
+class WriteBehindSink {
+public:
+    virtual ~WriteBehindSink() = default;
+
+    // highest transaction id written, 0 before the first batch
+    virtual int Checkpoint() = 0;
+    // rows are every transaction after Checkpoint() up to the last one
+    // that the local engine committed, oldest first; written atomically together with moving the
+    // checkpoint to rows.back(). Throws when nothing was written.
+    virtual void Write(const std::vector<LedgerRecord>& rows) = 0;
+};
+
+// Serves everything out of a DurableDatabase and streams its committed
+// mutations to a sink in batches of up to batch_rows, in id order. A batch
+// goes out once batch_rows rows are ready or flush_ms after the previous
+// one; a failed batch is retried after flush_ms. At most max_lag rows are
+// committed but not yet written: a mutation whose id lies further ahead
+// waits for the flusher, which only ever blocks the newest commits, so
+// the rows the next batch needs are never held up behind it. On startup
+// the rows after the sink's checkpoint are read back from the local
+// engine, so a crash on either side resumes without gaps or duplicates.
+// An id whose WAL write failed is skipped rather than waited for.
+class WriteBehindDatabase : public IDatabase {
+public:
+    WriteBehindDatabase(DurableDatabase* local, WriteBehindSink* sink, size_t max_lag, size_t batch_rows,
+                        int flush_ms);
+    // writes what is ready, once
+    ~WriteBehindDatabase() override;
+
+    // blocks until everything committed before the call is written
+    void Flush();
+    // rows committed locally but not written yet
+    size_t Lag() const;
+
+    int TransferMoney(int sender_id, int receiver_id, double amount) override;
+    std::pair<double, bool> GetBalance(int user_id) override;
+    void DepositMoney(int user_id, double amount) override;
+    int WithdrawMoney(int user_id, double amount) override;
+    std::vector<Transaction> GetTransactions(int user_id) override;
+    std::vector<Transaction> GetTransactionsSince(int user_id, int since_transaction_id) override;
+    std::pair<double, bool> GetVersionedBalance(int user_id, int* version) override;
+    void SetBalanceObserver(BalanceObserver observer) override;
+
+private:
+    void Enqueue(const LedgerRecord& record, bool durable);
+    // moves ready_through over pending and skipped ids, and written_through
+    // over the skipped ids right after it
+    void Advance();
+    // rows following written_through without a gap, batch_rows at most
+    std::vector<LedgerRecord> NextBatch() const;
+    void FlushLoop();
+
+    DurableDatabase* local;
+    WriteBehindSink* sink;
+    size_t max_lag;
+    size_t batch_rows;
+    int flush_ms;
+
+    std::atomic<int64_t>& lag_rows;
+    std::atomic<int64_t>& rows_written;
+    std::atomic<int64_t>& batches_written;
+    std::atomic<int64_t>& write_failures;
+    std::atomic<int64_t>& backpressure_waits;
+    std::atomic<int64_t>& skipped_ids;
+
+    mutable std::mutex mtx;
+    std::condition_variable work_cv;
+    std::condition_variable written_cv;
+    std::map<int, LedgerRecord> pending;
+    // ids the local engine lost, never written
+    std::set<int> skipped;
+    int written_through;
+    // every id up to it is pending or written
+    int ready_through;
+    // highest id a Flush waits for
+    int flush_through = 0;
+    bool stopping = false;
+    std::thread flusher;
+};
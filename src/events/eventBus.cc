@@ -0,0 +1,112 @@
+#include "eventBus.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <vector>
+
+Subscription::Subscription(int user_id, size_t capacity, int last_transaction_id)
+    : user_id(user_id), capacity(capacity), last_transaction_id(last_transaction_id) {}
+
+bool Subscription::Push(const AccountEvent& event) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (closed) {
+            return false;
+        }
+        int id = event.transaction.transaction_id;
+        if (id != 0 && id <= last_transaction_id) {
+            return true; // already queued, e.g. by the NOTIFY path
+        }
+        if (queue.size() >= capacity) {
+            overflowed = true;
+            closed = true;
+        }
+        else {
+            queue.push_back(event);
+            last_transaction_id = std::max(last_transaction_id, id);
+        }
+    }
+    cv.notify_one();
+    return !overflowed;
+}
+
+bool Subscription::Pop(AccountEvent& event, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] {
+        return !queue.empty() || closed;
+    });
+    if (queue.empty() || overflowed) {
+        return false;
+    }
+    event = std::move(queue.front());
+    queue.pop_front();
+    return true;
+}
+
+void Subscription::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+    }
+    cv.notify_all();
+}
+
+int Subscription::LastTransactionId() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return last_transaction_id;
+}
+
+bool Subscription::Overflowed() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return overflowed;
+}
+
+EventBus::EventBus(size_t queue_capacity) : queue_capacity(queue_capacity) {}
+
+std::shared_ptr<Subscription> EventBus::Subscribe(int user_id, int last_transaction_id) {
+    auto subscription = std::make_shared<Subscription>(user_id, queue_capacity, last_transaction_id);
+    std::lock_guard<std::mutex> lock(mtx);
+    subscribers.emplace(user_id, subscription);
+    return subscription;
+}
+
+void EventBus::Unsubscribe(const std::shared_ptr<Subscription>& subscription) {
+    subscription->Close();
+    std::lock_guard<std::mutex> lock(mtx);
+    auto range = subscribers.equal_range(subscription->UserId());
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == subscription) {
+            subscribers.erase(it);
+            break;
+        }
+    }
+}
+
+bool EventBus::HasSubscribers(int user_id) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return subscribers.count(user_id) != 0;
+}
+
+int EventBus::Watermark(int user_id) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    int watermark = INT_MAX;
+    auto range = subscribers.equal_range(user_id);
+    for (auto it = range.first; it != range.second; ++it) {
+        watermark = std::min(watermark, it->second->LastTransactionId());
+    }
+    return watermark;
+}
+
+void EventBus::Publish(const AccountEvent& event) {
+    std::vector<std::shared_ptr<Subscription>> targets;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto range = subscribers.equal_range(event.user_id);
+        for (auto it = range.first; it != range.second; ++it) {
+            targets.push_back(it->second);
+        }
+    }
+    for (const auto& subscription : targets) {
+        subscription->Push(event);
+    }
+}
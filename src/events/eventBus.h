@@ -0,0 +1,55 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "src/db/databaseInterface.h"
+
+struct AccountEvent {
+    int user_id;
+    double balance;
+    Transaction transaction;
+};
+
+// bounded per-subscriber queue, a subscriber that falls behind is cut off
+// and expected to reconnect with its last seen transaction id
+class Subscription {
+public:
+    Subscription(int user_id, size_t capacity, int last_transaction_id);
+
+    bool Push(const AccountEvent& event);
+    bool Pop(AccountEvent& event, int timeout_ms);
+    void Close();
+
+    int UserId() const { return user_id; }
+    int LastTransactionId() const;
+    bool Overflowed() const;
+
+private:
+    int user_id;
+    size_t capacity;
+    int last_transaction_id;
+    bool overflowed = false;
+    bool closed = false;
+    std::deque<AccountEvent> queue;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+};
+
+class EventBus {
+public:
+    explicit EventBus(size_t queue_capacity);
+
+    std::shared_ptr<Subscription> Subscribe(int user_id, int last_transaction_id);
+    void Unsubscribe(const std::shared_ptr<Subscription>& subscription);
+    bool HasSubscribers(int user_id) const;
+    // lowest transaction id every subscriber of user_id has already queued
+    int Watermark(int user_id) const;
+    void Publish(const AccountEvent& event);
+
+private:
+    size_t queue_capacity;
+    mutable std::mutex mtx;
+    std::unordered_multimap<int, std::shared_ptr<Subscription>> subscribers;
+};
@@ -0,0 +1,174 @@
+#include "latencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+LatencyHistogram::LatencyHistogram(int64_t highest, int significant_digits) : highest(std::max<int64_t>(highest, 2)) {
+    // enough sub buckets to tell apart two values 10^-digits apart at the
+    // top of each power of two
+    int64_t largest_single_unit = 2 * static_cast<int64_t>(std::pow(10, significant_digits));
+    int sub_bucket_magnitude = static_cast<int>(std::ceil(std::log2(static_cast<double>(largest_single_unit))));
+    sub_bucket_half_magnitude = sub_bucket_magnitude - 1;
+    sub_bucket_count = int64_t(1) << sub_bucket_magnitude;
+    sub_bucket_mask = sub_bucket_count - 1;
+
+    bucket_count = 1;
+    for (int64_t untrackable = sub_bucket_count; untrackable <= this->highest; untrackable <<= 1) {
+        bucket_count++;
+    }
+    counts.assign((bucket_count + 1) * (sub_bucket_count / 2), 0);
+}
+
+size_t LatencyHistogram::Index(int64_t value) const {
+    int bucket = 64 - __builtin_clzll(static_cast<uint64_t>(value | sub_bucket_mask)) - (sub_bucket_half_magnitude + 1);
+    int64_t sub_bucket = value >> bucket;
+    return (static_cast<size_t>(bucket + 1) << sub_bucket_half_magnitude) + (sub_bucket - sub_bucket_count / 2);
+}
+
+int64_t LatencyHistogram::LowestEquivalent(size_t index) const {
+    int bucket = static_cast<int>(index >> sub_bucket_half_magnitude) - 1;
+    int64_t sub_bucket = (index & (sub_bucket_count / 2 - 1)) + sub_bucket_count / 2;
+    if (bucket < 0) {
+        sub_bucket -= sub_bucket_count / 2;
+        bucket = 0;
+    }
+    return sub_bucket << bucket;
+}
+
+int64_t LatencyHistogram::HighestEquivalent(size_t index) const {
+    int bucket = std::max(static_cast<int>(index >> sub_bucket_half_magnitude) - 1, 0);
+    return LowestEquivalent(index) + (int64_t(1) << bucket) - 1;
+}
+
+void LatencyHistogram::Record(int64_t value, int64_t count) {
+    value = std::clamp<int64_t>(value, 0, highest);
+    counts[Index(value)] += count;
+    total += count;
+}
+
+void LatencyHistogram::RecordCorrected(int64_t value, int64_t expected_interval) {
+    Record(value);
+    if (expected_interval <= 0) {
+        return;
+    }
+    for (int64_t missing = value - expected_interval; missing >= expected_interval; missing -= expected_interval) {
+        Record(missing);
+    }
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < other.counts.size(); ++i) {
+        if (other.counts[i] != 0) {
+            Record(other.LowestEquivalent(i), other.counts[i]);
+        }
+    }
+}
+
+LatencyHistogram LatencyHistogram::Corrected(int64_t expected_interval) const {
+    LatencyHistogram out = *this;
+    std::fill(out.counts.begin(), out.counts.end(), 0);
+    out.total = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        int64_t value = LowestEquivalent(i);
+        out.Record(value, counts[i]);
+        if (expected_interval <= 0) {
+            continue;
+        }
+        for (int64_t missing = value - expected_interval; missing >= expected_interval; missing -= expected_interval) {
+            out.Record(missing, counts[i]);
+        }
+    }
+    return out;
+}
+
+int64_t LatencyHistogram::Max() const {
+    for (size_t i = counts.size(); i-- > 0;) {
+        if (counts[i] != 0) {
+            return HighestEquivalent(i);
+        }
+    }
+    return 0;
+}
+
+double LatencyHistogram::Mean() const {
+    if (total == 0) {
+        return 0;
+    }
+    double sum = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] != 0) {
+            int64_t lowest = LowestEquivalent(i);
+            sum += counts[i] * (lowest + (HighestEquivalent(i) - lowest + 1) / 2.0);
+        }
+    }
+    return sum / total;
+}
+
+double LatencyHistogram::StdDeviation() const {
+    if (total == 0) {
+        return 0;
+    }
+    double mean = Mean();
+    double sum = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] != 0) {
+            int64_t lowest = LowestEquivalent(i);
+            double deviation = lowest + (HighestEquivalent(i) - lowest + 1) / 2.0 - mean;
+            sum += counts[i] * deviation * deviation;
+        }
+    }
+    return std::sqrt(sum / total);
+}
+
+int64_t LatencyHistogram::ValueAtPercentile(double percentile) const {
+    if (total == 0) {
+        return 0;
+    }
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    int64_t count_at = std::max<int64_t>(static_cast<int64_t>(percentile / 100 * total + 0.5), 1);
+    int64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= count_at) {
+            return HighestEquivalent(i);
+        }
+    }
+    return Max();
+}
+
+void LatencyHistogram::Print(std::ostream& out, double scale) const {
+    char line[128];
+    std::snprintf(line, sizeof(line), "%12s %12s %12s %12s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+    out << line;
+    // five rows per halving of the distance to 100%, like HdrHistogram's
+    // percentile iterator
+    double percentile = 0;
+    while (total > 0) {
+        int64_t value = ValueAtPercentile(percentile);
+        int64_t seen = 0;
+        for (size_t i = 0; i <= Index(value); ++i) {
+            seen += counts[i];
+        }
+        if (seen >= total) {
+            std::snprintf(line, sizeof(line), "%12.3f %12f %12lld\n", value / scale, 1.0, static_cast<long long>(seen));
+            out << line;
+            break;
+        }
+        std::snprintf(line, sizeof(line), "%12.3f %12f %12lld %12.2f\n", value / scale, percentile / 100,
+                      static_cast<long long>(seen), 1 / (1 - percentile / 100));
+        out << line;
+        int half_distance = static_cast<int>(std::floor(std::log2(100 / (100 - percentile)))) + 1;
+        percentile += 100.0 / (5 * std::pow(2.0, half_distance));
+    }
+    std::snprintf(line, sizeof(line), "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", Mean() / scale, StdDeviation() / scale);
+    out << line;
+    std::snprintf(line, sizeof(line), "#[Max     = %12.3f, Total count    = %12lld]\n", Max() / scale,
+                  static_cast<long long>(total));
+    out << line;
+    std::snprintf(line, sizeof(line), "#[Buckets = %12d, SubBuckets     = %12lld]\n", bucket_count,
+                  static_cast<long long>(sub_bucket_count));
+    out << line;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// HdrHistogram layout: values from 1 up to highest, each counted in a
+// bucket no wider than 10^-significant_digits of the value, so any
+// percentile comes back to that precision in a fixed, small array.
+// Not thread safe; keep one per thread and Merge them.
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(int64_t highest = 3600LL * 1000 * 1000, int significant_digits = 3);
+
+    // values above highest are counted as highest
+    void Record(int64_t value, int64_t count = 1);
+    // Record plus the samples a caller that waited expected_interval between
+    // requests would have seen while this one was stuck (coordinated omission)
+    void RecordCorrected(int64_t value, int64_t expected_interval);
+    void Merge(const LatencyHistogram& other);
+    // the same correction applied after the fact to every recorded value
+    LatencyHistogram Corrected(int64_t expected_interval) const;
+
+    int64_t Count() const { return total; }
+    int64_t Max() const;
+    double Mean() const;
+    double StdDeviation() const;
+    // highest value equivalent to the one at percentile (0..100)
+    int64_t ValueAtPercentile(double percentile) const;
+
+    // the percentile distribution in HdrHistogram's .hgrm text format, values
+    // divided by scale (e.g. 1000 to print microseconds as milliseconds)
+    void Print(std::ostream& out, double scale) const;
+
+private:
+    size_t Index(int64_t value) const;
+    int64_t LowestEquivalent(size_t index) const;
+    int64_t HighestEquivalent(size_t index) const;
+
+    int64_t highest;
+    int sub_bucket_half_magnitude;
+    int64_t sub_bucket_count;
+    int64_t sub_bucket_mask;
+    int bucket_count;
+    std::vector<int64_t> counts;
+    int64_t total = 0;
+};
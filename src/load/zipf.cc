@@ -0,0 +1,34 @@
+#include "zipf.h"
+#include <algorithm>
+#include <cmath>
+
+static double Zeta(int n, double theta) {
+    double sum = 0;
+    for (int k = 1; k <= n; ++k) {
+        sum += 1 / std::pow(k, theta);
+    }
+    return sum;
+}
+
+// theta = 1 would make alpha infinite, it is nudged just below like YCSB does
+ZipfGenerator::ZipfGenerator(int n, double theta)
+    : n(std::max(n, 1)), theta(std::abs(theta - 1.0) < 1e-9 ? 1.0 - 1e-9 : theta) {
+    zeta_n = Zeta(this->n, this->theta);
+    alpha = 1 / (1 - this->theta);
+    eta = (1 - std::pow(2.0 / this->n, 1 - this->theta)) / (1 - Zeta(2, this->theta) / zeta_n);
+}
+
+int ZipfGenerator::Draw(double u) const {
+    if (theta <= 0) {
+        return 1 + std::min(static_cast<int>(u * n), n - 1);
+    }
+    double uz = u * zeta_n;
+    if (uz < 1) {
+        return 1;
+    }
+    if (uz < 1 + std::pow(0.5, theta)) {
+        return 2;
+    }
+    int id = 1 + static_cast<int>(n * std::pow(eta * u - eta + 1, alpha));
+    return std::clamp(id, 1, n);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <random>
+
+// Account ids 1..n drawn with P(id = k) proportional to 1 / k^theta, so
+// id 1 is the hottest; theta = 0 is uniform. Gray et al.'s rejection free
+// method as used by YCSB: the zeta constants are computed once, in O(n),
+// after which a draw is one uniform variate and a pow.
+class ZipfGenerator {
+public:
+    ZipfGenerator(int n, double theta);
+
+    template <typename Rng>
+    int operator()(Rng& rng) {
+        return Draw(std::uniform_real_distribution<double>(0.0, 1.0)(rng));
+    }
+
+    // the id for a uniform u in [0, 1)
+    int Draw(double u) const;
+
+private:
+    int n;
+    double theta;
+    double alpha;
+    double zeta_n;
+    double eta;
+};
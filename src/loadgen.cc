@@ -0,0 +1,399 @@
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "proto/payment_service.grpc.pb.h"
+#include "src/config/environment.h"
+#include "src/load/latencyHistogram.h"
+#include "src/load/zipf.h"
+
+// Drives LOADGEN_TARGET (localhost:50051) with asynchronous unary calls over
+// LOADGEN_CHANNELS separate connections, completed by LOADGEN_THREADS
+// threads. LOADGEN_MODE=closed keeps LOADGEN_CONCURRENCY calls in flight;
+// LOADGEN_MODE=open starts LOADGEN_RATE calls per second on a fixed
+// schedule whatever the server does, at most LOADGEN_MAX_INFLIGHT at a
+// time. The operations are drawn by the weights of LOADGEN_MIX, accounts
+// 1..LOADGEN_ACCOUNTS with Zipf exponent LOADGEN_ZIPF (0 is uniform).
+// Runs LOADGEN_WARMUP + LOADGEN_DURATION seconds and reports only the
+// calls scheduled after the warmup.
+//
+// Latencies are corrected for coordinated omission: open loop measures
+// each call from when it was due rather than when it went out, closed
+// loop adds the calls a client waiting the mean latency would have made
+// while a slow one held its slot. LOADGEN_HGRM names a prefix to write
+// the corrected histograms to, in HdrHistogram's .hgrm format.
+
+using Clock = std::chrono::steady_clock;
+using Stub = payment::PaymentService::Stub;
+
+enum Operation { kTransfer, kBalance, kHistory, kDeposit, kWithdraw, kOperations };
+static const char* kOperationNames[kOperations] = {"transfer", "balance", "history", "deposit", "withdraw"};
+
+struct Options {
+    std::string target;
+    int channels;
+    int threads;
+    bool open_loop;
+    int concurrency;
+    double rate;
+    int max_inflight;
+    int warmup;
+    int duration;
+    int timeout_ms;
+    std::vector<double> mix;
+    int accounts;
+    double zipf;
+    int history_limit;
+};
+
+// "transfer=40,balance=40,..." into one weight per Operation
+static std::vector<double> ParseMix(const std::string& text) {
+    std::vector<double> weights(kOperations, 0);
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        size_t equal_pos = item.find('=');
+        std::string name = item.substr(0, equal_pos);
+        auto found = std::find(std::begin(kOperationNames), std::end(kOperationNames), name);
+        if (equal_pos == std::string::npos || found == std::end(kOperationNames)) {
+            throw std::invalid_argument("bad LOADGEN_MIX entry \"" + item + "\"");
+        }
+        weights[found - std::begin(kOperationNames)] = std::stod(item.substr(equal_pos + 1));
+    }
+    return weights;
+}
+
+struct Call {
+    virtual ~Call() = default;
+
+    Operation operation;
+    Clock::time_point intended;
+    Clock::time_point sent;
+    grpc::ClientContext context;
+    grpc::Status status;
+};
+
+template <typename Request, typename Response>
+struct UnaryCall : Call {
+    void Start(std::unique_ptr<grpc::ClientAsyncResponseReader<Response>> started) {
+        reader = std::move(started);
+        reader->StartCall();
+        reader->Finish(&response, &status, this);
+    }
+
+    Request request;
+    Response response;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<Response>> reader;
+};
+
+// one completion queue and its share of the channels; only its own thread
+// touches it until Run returns
+class Worker {
+public:
+    Worker(const Options& options, int index)
+        : latency(kOperations), service(kOperations), options(options), rng(index + 1),
+          accounts(options.accounts, options.zipf), mix(options.mix.begin(), options.mix.end()) {}
+
+    void AddChannel(const std::shared_ptr<grpc::Channel>& channel) {
+        stubs.push_back(payment::PaymentService::NewStub(channel));
+    }
+
+    // slots calls in flight for closed loop, or one call every interval
+    // from first on for open loop
+    void Run(int slots, Clock::duration interval, Clock::time_point first,
+             Clock::time_point measure_from, Clock::time_point end) {
+        Clock::time_point next = first;
+        int inflight = 0;
+        if (!options.open_loop) {
+            for (; inflight < slots; ++inflight) {
+                Issue(Clock::now());
+            }
+        }
+        for (;;) {
+            Clock::time_point now = Clock::now();
+            bool sending = now < end;
+            if (options.open_loop && sending) {
+                for (; next <= now && inflight < options.max_inflight; next += interval) {
+                    Issue(next);
+                    inflight++;
+                }
+            }
+            if (!sending && inflight == 0) {
+                break;
+            }
+            Clock::time_point deadline = now + std::chrono::seconds(1);
+            if (sending) {
+                deadline = options.open_loop && inflight < options.max_inflight ? std::min(next, end) : end;
+            }
+
+            void* tag;
+            bool ok;
+            // gRPC only takes system_clock deadlines
+            auto wait = std::chrono::system_clock::now() + std::max(deadline - now, Clock::duration::zero());
+            if (queue.AsyncNext(&tag, &ok, wait) != grpc::CompletionQueue::GOT_EVENT) {
+                continue;
+            }
+            std::unique_ptr<Call> call(static_cast<Call*>(tag));
+            inflight--;
+            Clock::time_point done = Clock::now();
+            if (call->intended >= measure_from && call->intended < end) {
+                if (call->status.ok()) {
+                    latency[call->operation].Record(Micros(done - call->intended));
+                    service[call->operation].Record(Micros(done - call->sent));
+                }
+                else {
+                    errors[call->operation]++;
+                }
+            }
+            if (!options.open_loop && done < end) {
+                Issue(done);
+                inflight++;
+            }
+        }
+        if (options.open_loop && next < end) {
+            unsent = (end - next) / interval;
+        }
+        queue.Shutdown();
+        void* tag;
+        bool ok;
+        while (queue.Next(&tag, &ok)) {
+        }
+    }
+
+    // from the intended start: identical to service for closed loop
+    std::vector<LatencyHistogram> latency;
+    // from the moment the call went out
+    std::vector<LatencyHistogram> service;
+    int64_t errors[kOperations] = {};
+    int64_t unsent = 0;
+
+private:
+    static int64_t Micros(Clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+
+    void Issue(Clock::time_point intended) {
+        Stub* stub = stubs[next_stub++ % stubs.size()].get();
+        Operation operation = static_cast<Operation>(mix(rng));
+        int user_id = accounts(rng);
+        switch (operation) {
+        case kTransfer: {
+            auto* transfer = new UnaryCall<payment::TransferRequest, payment::TransferResponse>();
+            int receiver_id = accounts(rng);
+            transfer->request.set_sender_id(user_id);
+            transfer->request.set_receiver_id(receiver_id == user_id ? user_id % options.accounts + 1 : receiver_id);
+            transfer->request.set_amount(1.0);
+            Prepare(transfer, operation, intended);
+            transfer->Start(stub->PrepareAsyncTransferMoney(&transfer->context, transfer->request, &queue));
+            break;
+        }
+        case kBalance: {
+            auto* balance = new UnaryCall<payment::BalanceRequest, payment::BalanceResponse>();
+            balance->request.set_user_id(user_id);
+            Prepare(balance, operation, intended);
+            balance->Start(stub->PrepareAsyncCheckBalance(&balance->context, balance->request, &queue));
+            break;
+        }
+        case kHistory: {
+            auto* history = new UnaryCall<payment::HistoryRequest, payment::HistoryResponse>();
+            history->request.set_user_id(user_id);
+            history->request.set_order(payment::NEWEST_FIRST);
+            history->request.set_limit(options.history_limit);
+            Prepare(history, operation, intended);
+            history->Start(stub->PrepareAsyncGetTransactionHistory(&history->context, history->request, &queue));
+            break;
+        }
+        case kDeposit: {
+            auto* deposit = new UnaryCall<payment::DepositRequest, payment::DepositResponse>();
+            deposit->request.set_user_id(user_id);
+            deposit->request.set_amount(1.0);
+            Prepare(deposit, operation, intended);
+            deposit->Start(stub->PrepareAsyncDepositMoney(&deposit->context, deposit->request, &queue));
+            break;
+        }
+        default: {
+            auto* withdraw = new UnaryCall<payment::WithdrawRequest, payment::WithdrawResponse>();
+            withdraw->request.set_user_id(user_id);
+            withdraw->request.set_amount(1.0);
+            Prepare(withdraw, operation, intended);
+            withdraw->Start(stub->PrepareAsyncWithdrawMoney(&withdraw->context, withdraw->request, &queue));
+            break;
+        }
+        }
+    }
+
+    void Prepare(Call* call, Operation operation, Clock::time_point intended) {
+        call->operation = operation;
+        call->intended = intended;
+        call->sent = Clock::now();
+        call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(options.timeout_ms));
+    }
+
+    const Options& options;
+    grpc::CompletionQueue queue;
+    std::vector<std::unique_ptr<Stub>> stubs;
+    size_t next_stub = 0;
+    std::mt19937_64 rng;
+    ZipfGenerator accounts;
+    std::discrete_distribution<int> mix;
+};
+
+static void PrintRow(const char* name, const LatencyHistogram& histogram, int64_t errors) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-12s %10lld %8lld %10.3f %10.3f %10.3f %10.3f %10.3f\n", name,
+                  static_cast<long long>(histogram.Count()), static_cast<long long>(errors),
+                  histogram.ValueAtPercentile(50) / 1000.0, histogram.ValueAtPercentile(90) / 1000.0,
+                  histogram.ValueAtPercentile(99) / 1000.0, histogram.ValueAtPercentile(99.9) / 1000.0,
+                  histogram.Max() / 1000.0);
+    std::cout << line;
+}
+
+static void WriteHgrm(const std::string& path, const LatencyHistogram& histogram) {
+    std::ofstream out(path);
+    histogram.Print(out, 1000.0);
+    if (!out) {
+        std::cerr << "Cannot write " << path << std::endl;
+    }
+}
+
+int main() {
+    load_env();
+    const char* target = getenv("LOADGEN_TARGET");
+    const char* mode = getenv("LOADGEN_MODE");
+    const char* mix = getenv("LOADGEN_MIX");
+    Options options;
+    options.target = target ? target : "localhost:50051";
+    options.channels = std::max(env_int("LOADGEN_CHANNELS", 4), 1);
+    options.threads = std::max(env_int("LOADGEN_THREADS", 2), 1);
+    options.open_loop = mode && std::string(mode) == "open";
+    options.concurrency = std::max(env_int("LOADGEN_CONCURRENCY", 64), 1);
+    options.rate = env_double("LOADGEN_RATE", 1000);
+    options.max_inflight = std::max(env_int("LOADGEN_MAX_INFLIGHT", 10000), 1);
+    options.warmup = env_int("LOADGEN_WARMUP", 5);
+    options.duration = env_int("LOADGEN_DURATION", 30);
+    options.timeout_ms = env_int("LOADGEN_TIMEOUT_MS", 10000);
+    options.accounts = std::max(env_int("LOADGEN_ACCOUNTS", 1000), 2);
+    options.zipf = env_double("LOADGEN_ZIPF", 0.99);
+    options.history_limit = env_int("LOADGEN_HISTORY_LIMIT", 20);
+    try {
+        options.mix = ParseMix(mix ? mix : "transfer=40,balance=40,history=10,deposit=5,withdraw=5");
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (std::all_of(options.mix.begin(), options.mix.end(), [](double weight) { return weight <= 0; })) {
+        std::cerr << "LOADGEN_MIX has no positive weight" << std::endl;
+        return 1;
+    }
+    if (options.open_loop && options.rate <= 0) {
+        std::cerr << "LOADGEN_RATE has to be positive" << std::endl;
+        return 1;
+    }
+
+    // separate channel arguments keep gRPC from sharing one connection
+    std::vector<std::shared_ptr<grpc::Channel>> channels;
+    for (int i = 0; i < options.channels; ++i) {
+        grpc::ChannelArguments args;
+        args.SetInt("loadgen.channel", i);
+        channels.push_back(grpc::CreateCustomChannel(options.target, grpc::InsecureChannelCredentials(), args));
+    }
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.push_back(std::make_unique<Worker>(options, t));
+        for (int i = t; i < options.channels; i += options.threads) {
+            workers.back()->AddChannel(channels[i]);
+        }
+        if (t >= options.channels) {
+            workers.back()->AddChannel(channels[t % options.channels]);
+        }
+    }
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point measure_from = start + std::chrono::seconds(options.warmup);
+    Clock::time_point end = measure_from + std::chrono::seconds(options.duration);
+    // each thread takes every threads-th arrival of the open loop schedule
+    auto arrival = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1 / options.rate));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < options.threads; ++t) {
+        int slots = options.concurrency / options.threads + (t < options.concurrency % options.threads ? 1 : 0);
+        threads.emplace_back([&, t, slots] {
+            workers[t]->Run(slots, arrival * options.threads, start + arrival * t, measure_from, end);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<LatencyHistogram> latency(kOperations);
+    LatencyHistogram total;
+    LatencyHistogram service_total;
+    int64_t errors[kOperations] = {};
+    int64_t unsent = 0;
+    for (auto& worker : workers) {
+        for (int op = 0; op < kOperations; ++op) {
+            latency[op].Merge(worker->latency[op]);
+            total.Merge(worker->latency[op]);
+            service_total.Merge(worker->service[op]);
+            errors[op] += worker->errors[op];
+        }
+        unsent += worker->unsent;
+    }
+    if (!options.open_loop) {
+        // a closed loop slot issues its next call one latency after the last
+        int64_t expected = static_cast<int64_t>(total.Mean());
+        for (int op = 0; op < kOperations; ++op) {
+            latency[op] = latency[op].Corrected(expected);
+        }
+        total = total.Corrected(expected);
+    }
+
+    int64_t all_errors = 0;
+    for (int op = 0; op < kOperations; ++op) {
+        all_errors += errors[op];
+    }
+    if (options.open_loop) {
+        std::cout << "Open loop at " << options.rate << " calls/s";
+    }
+    else {
+        std::cout << "Closed loop with " << options.concurrency << " calls in flight";
+    }
+    std::cout << ", " << options.channels << " channels, " << options.duration << " s measured: "
+              << service_total.Count() / double(options.duration) << " calls/s completed, "
+              << all_errors << " failed";
+    if (unsent > 0) {
+        std::cout << ", " << unsent << " never sent (LOADGEN_MAX_INFLIGHT reached)";
+    }
+    std::cout << std::endl << std::endl;
+
+    char header[160];
+    std::snprintf(header, sizeof(header), "%-12s %10s %8s %10s %10s %10s %10s %10s\n", "operation", "calls", "errors",
+                  "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+    std::cout << header;
+    for (int op = 0; op < kOperations; ++op) {
+        if (latency[op].Count() > 0 || errors[op] > 0) {
+            PrintRow(kOperationNames[op], latency[op], errors[op]);
+        }
+    }
+    PrintRow("all", total, all_errors);
+    PrintRow("uncorrected", service_total, all_errors);
+    std::cout << std::endl;
+    total.Print(std::cout, 1000.0);
+
+    const char* hgrm = getenv("LOADGEN_HGRM");
+    if (hgrm) {
+        for (int op = 0; op < kOperations; ++op) {
+            WriteHgrm(std::string(hgrm) + "-" + kOperationNames[op] + ".hgrm", latency[op]);
+        }
+        WriteHgrm(std::string(hgrm) + "-all.hgrm", total);
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "metrics.h"
+
+Metrics& Metrics::Global() {
+    static Metrics metrics;
+    return metrics;
+}
+
+std::atomic<int64_t>& Metrics::Counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto& counter = counters[name];
+    if (!counter) {
+        counter = std::make_unique<std::atomic<int64_t>>(0);
+    }
+    return *counter;
+}
+
+std::map<std::string, int64_t> Metrics::Snapshot() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::map<std::string, int64_t> out;
+    for (const auto& entry : counters) {
+        out[entry.first] = entry.second->load(std::memory_order_relaxed);
+    }
+    return out;
+}
+
+void Metrics::Dump(std::ostream& out) const {
+    for (const auto& entry : Snapshot()) {
+        out << entry.first << " " << entry.second << "\n";
+    }
+    out.flush();
+}
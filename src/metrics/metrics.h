@@ -0,0 +1,23 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// process wide named counters; hot paths keep the returned reference
+// instead of looking the name up on every call
+class Metrics {
+public:
+    static Metrics& Global();
+
+    std::atomic<int64_t>& Counter(const std::string& name);
+    std::map<std::string, int64_t> Snapshot() const;
+    void Dump(std::ostream& out) const;
+
+private:
+    mutable std::mutex mtx;
+    std::map<std::string, std::unique_ptr<std::atomic<int64_t>>> counters;
+};
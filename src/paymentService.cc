@@ -0,0 +1,349 @@
+#include "paymentService.h"
+#include <algorithm>
+#include <iostream>
+
+using std::pair;
+
+static void FillTransaction(payment::Transaction* transaction, const Transaction& row) {
+    transaction->set_transaction_id(row.transaction_id);
+    transaction->set_sender_id(row.sender_id);
+    transaction->set_receiver_id(row.receiver_id);
+    transaction->set_amount(row.amount);
+    transaction->set_timestamp(row.timestamp);
+    transaction->set_status(row.status);
+}
+
+static void FillEvent(payment::AccountEvent* event, const AccountEvent& source) {
+    event->set_user_id(source.user_id);
+    event->set_balance(source.balance);
+    if (source.transaction.transaction_id != 0) {
+        FillTransaction(event->mutable_transaction(), source.transaction);
+    }
+}
+
+// A filter hit needs no round trip, and neither does a miss, except for an
+// id just past the highest one the filter knows: that may be an account
+// whose creation the listener has not delivered yet, so it is looked up
+// before the request is rejected, and added to the filter when it turns up.
+bool PaymentServiceImpl::MayExist(int user_id) {
+    if (accounts == nullptr || !accounts->Loaded() || accounts->Contains(user_id)) {
+        return true;
+    }
+    if (!accounts->MayBeUnannounced(user_id)) {
+        return false;
+    }
+    try {
+        if (db->GetBalance(user_id).second != 0) {
+            return false;
+        }
+        accounts->Add(user_id);
+    }
+    catch (const std::exception&) {
+        // the request itself will report the database error
+    }
+    return true;
+}
+
+// Each row goes out with the balance it left behind, found by undoing the
+// newer rows from a balance that reflects exactly the rows up to version.
+// Rows past version were committed after it was read and are published
+// by the PublishChanges call of their own commit.
+static void RowBalances(std::vector<Transaction>& rows, int user_id, double balance, int version,
+                        std::vector<double>* balances) {
+    while (!rows.empty() && rows.back().transaction_id > version) {
+        rows.pop_back();
+    }
+    balances->resize(rows.size());
+    for (size_t i = rows.size(); i-- > 0;) {
+        (*balances)[i] = balance;
+        if (rows[i].sender_id == user_id && rows[i].status != "deposit") {
+            balance += rows[i].amount;
+        }
+        if (rows[i].receiver_id == user_id && rows[i].status != "withdrawal") {
+            balance -= rows[i].amount;
+        }
+    }
+}
+
+void PaymentServiceImpl::PublishChanges(int user_id) {
+    if (!bus->HasSubscribers(user_id)) {
+        return;
+    }
+    try {
+        int version;
+        double balance = db->GetVersionedBalance(user_id, &version).first;
+        std::vector<Transaction> rows = db->GetTransactionsSince(user_id, bus->Watermark(user_id));
+        std::vector<double> row_balances;
+        RowBalances(rows, user_id, balance, version, &row_balances);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            bus->Publish({user_id, row_balances[i], std::move(rows[i])});
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << ("Database error: " + std::string(e.what()));
+    }
+}
+
+void PaymentServiceImpl::Committed(int user_id) {
+    if (!commits_notified) {
+        PublishChanges(user_id);
+    }
+}
+
+grpc::Status PaymentServiceImpl::TransferMoney(grpc::ServerContext* context, const payment::TransferRequest* request, payment::TransferResponse* response) {
+    int sender_id = request->sender_id();
+    int receiver_id = request->receiver_id();
+    double amount = request->amount();
+
+    // unknown ids are answered without a round trip
+    if (!MayExist(sender_id)) {
+        response->set_success(false);
+        response->set_message("Sender not found.");
+        return grpc::Status::OK;
+    }
+    if (!MayExist(receiver_id)) {
+        response->set_success(false);
+        response->set_message("Receiver not found.");
+        return grpc::Status::OK;
+    }
+
+    try {
+        int result = db->TransferMoney(sender_id, receiver_id, amount);
+        if (result != 0) {
+            if (result == 1) {
+                response->set_success(false);
+                response->set_message("Sender not found.");
+                return grpc::Status::OK;
+            }
+            else if (result == 2) {
+                response->set_success(false);
+                response->set_message("Receiver not found.");
+                return grpc::Status::OK;
+            }
+            else if (result == 3) {
+                response->set_success(false);
+                response->set_message("Not enough money.");
+                return grpc::Status::OK;
+            }
+        }
+        response->set_success(true);
+        response->set_message("Transfer successful.");
+        Committed(sender_id);
+        Committed(receiver_id);
+    }
+    catch (const std::exception& e) {
+        response->set_success(false);
+        response->set_message("Database error: " + std::string(e.what()));
+    }
+
+    return grpc::Status::OK;
+}
+
+grpc::Status PaymentServiceImpl::CheckBalance(grpc::ServerContext* context, const payment::BalanceRequest* request, payment::BalanceResponse* response) {
+    int sender_id = request->user_id();
+    try {
+        double cached;
+        if (balances->Read(sender_id, &cached)) {
+            response->set_balance(cached);
+            return grpc::Status::OK;
+        }
+        if (!MayExist(sender_id)) {
+            response->set_message("User not found.");
+            return grpc::Status::OK;
+        }
+        int version;
+        pair<double, bool> balance = db->GetVersionedBalance(sender_id, &version);
+        if (balance.second != 0) {
+            response->set_message("User not found.");
+            return grpc::Status::OK;
+        }
+        balances->Publish(sender_id, balance.first, version);
+        response->set_balance(balance.first);
+        compression->Apply(context, "CheckBalance", *response);
+    }
+    catch (const std::exception& e) {
+        std::cerr << ("Database error: " + std::string(e.what()));
+    }
+
+    return grpc::Status::OK;
+}
+
+grpc::Status PaymentServiceImpl::GetTransactionHistory(grpc::ServerContext* context, const payment::HistoryRequest* request, payment::HistoryResponse* response) {
+    int sender_id = request->user_id();
+    HistoryFilter filter;
+    filter.from_timestamp = request->from_timestamp();
+    filter.to_timestamp = request->to_timestamp();
+    if (request->has_min_amount()) {
+        filter.min_amount = request->min_amount();
+    }
+    if (request->has_max_amount()) {
+        filter.max_amount = request->max_amount();
+    }
+    if (request->type() == payment::TRANSFER) {
+        filter.status = "transfer";
+    }
+    else if (request->type() == payment::DEPOSIT) {
+        filter.status = "deposit";
+    }
+    else if (request->type() == payment::WITHDRAWAL) {
+        filter.status = "withdrawal";
+    }
+    if (request->direction() == payment::SENT) {
+        filter.direction = HistoryFilter::Sent;
+    }
+    else if (request->direction() == payment::RECEIVED) {
+        filter.direction = HistoryFilter::Received;
+    }
+    filter.newest_first = request->order() == payment::NEWEST_FIRST;
+    filter.limit = request->limit();
+    filter.since_transaction_id = request->since_transaction_id();
+    try {
+        int latest = 0;
+        if (filter.since_transaction_id > 0) {
+            latest = db->GetLatestTransactionId(sender_id);
+            if (latest <= filter.since_transaction_id) {
+                response->set_not_modified(true);
+                response->set_latest_transaction_id(filter.since_transaction_id);
+                return grpc::Status::OK;
+            }
+        }
+        int watermark;
+        for (const auto& row : db->FindTransactionsPage(sender_id, filter, latest, &watermark)) {
+            FillTransaction(response->add_transactions(), row);
+        }
+        response->set_latest_transaction_id(watermark);
+        compression->Apply(context, "GetTransactionHistory", *response);
+    }
+    catch (const std::exception& e) {
+        std::cerr << ("Database error: " + std::string(e.what()));
+    }
+
+    return grpc::Status::OK;
+}
+
+grpc::Status PaymentServiceImpl::GetAccountSummary(grpc::ServerContext* context, const payment::SummaryRequest* request, payment::SummaryResponse* response) {
+    int sender_id = request->user_id();
+    int recent_limit = request->recent_limit() > 0 ? request->recent_limit() : 10;
+    try {
+        pair<AccountSummary, bool> summary = db->GetAccountSummary(sender_id, recent_limit, request->window_days());
+        if (summary.second != 0) {
+            response->set_message("User not found.");
+            return grpc::Status::OK;
+        }
+        response->set_balance(summary.first.balance);
+        response->set_transaction_count(summary.first.transaction_count);
+        response->set_total_in(summary.first.total_in);
+        response->set_total_out(summary.first.total_out);
+        for (const auto& row : summary.first.recent) {
+            FillTransaction(response->add_recent_transactions(), row);
+        }
+        compression->Apply(context, "GetAccountSummary", *response);
+    }
+    catch (const std::exception& e) {
+        std::cerr << ("Database error: " + std::string(e.what()));
+    }
+
+    return grpc::Status::OK;
+}
+
+grpc::Status PaymentServiceImpl::DepositMoney(grpc::ServerContext* context, const payment::DepositRequest* request, payment::DepositResponse* response) {
+    int sender_id = request->user_id();
+    double amount = request->amount();
+    try {
+        db->DepositMoney(sender_id, amount);
+        Committed(sender_id);
+    }
+    catch (const std::exception& e) {
+        std::cerr << ("Database error: " + std::string(e.what()));
+    }
+
+    return grpc::Status::OK;
+}
+
+grpc::Status PaymentServiceImpl::WithdrawMoney(grpc::ServerContext* context, const payment::WithdrawRequest* request, payment::WithdrawResponse* response) {
+    int sender_id = request->user_id();
+    double amount = request->amount();
+    try {
+        int result = db->WithdrawMoney(sender_id, amount);
+        if (result != 0) {
+            if (result == 1) {
+                return grpc::Status::CANCELLED;
+            }
+        }
+        Committed(sender_id);
+    }
+    catch (const std::exception& e) {
+        std::cerr << ("Database error: " + std::string(e.what()));
+    }
+
+    return grpc::Status::OK;
+}
+
+grpc::Status PaymentServiceImpl::WatchAccount(grpc::ServerContext* context, const payment::WatchRequest* request, grpc::ServerWriter<payment::AccountEvent>* writer) {
+    int user_id = request->user_id();
+    int last_sent = request->resume_from_transaction_id();
+    std::shared_ptr<Subscription> subscription;
+    payment::AccountEvent message;
+    try {
+        // a new watcher starts at the present rather than replaying the whole history
+        if (last_sent == 0) {
+            last_sent = db->GetLatestTransactionId(user_id);
+        }
+        // subscribe before reading the backlog so nothing committed in between is missed
+        subscription = bus->Subscribe(user_id, last_sent);
+        int version;
+        pair<double, bool> balance = db->GetVersionedBalance(user_id, &version);
+        if (balance.second != 0) {
+            bus->Unsubscribe(subscription);
+            return grpc::Status(grpc::StatusCode::NOT_FOUND, "User not found.");
+        }
+        FillEvent(&message, {user_id, balance.first, {}});
+        writer->Write(message);
+
+        std::vector<Transaction> rows = db->GetTransactionsSince(user_id, last_sent);
+        std::vector<double> row_balances;
+        RowBalances(rows, user_id, balance.first, version, &row_balances);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            message.Clear();
+            FillEvent(&message, {user_id, row_balances[i], rows[i]});
+            if (!writer->Write(message)) {
+                break;
+            }
+            last_sent = rows[i].transaction_id;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << ("Database error: " + std::string(e.what()));
+        if (subscription) {
+            bus->Unsubscribe(subscription);
+        }
+        return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Database error.");
+    }
+
+    AccountEvent event;
+    while (!context->IsCancelled()) {
+        if (!subscription->Pop(event, 500)) {
+            if (subscription->Overflowed()) {
+                break;
+            }
+            continue;
+        }
+        if (event.transaction.transaction_id <= last_sent) {
+            continue;
+        }
+        message.Clear();
+        FillEvent(&message, event);
+        if (!writer->Write(message)) {
+            break;
+        }
+        last_sent = event.transaction.transaction_id;
+    }
+
+    bool overflowed = subscription->Overflowed();
+    bus->Unsubscribe(subscription);
+    if (overflowed) {
+        return grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                            "Watcher fell behind, resume from transaction " + std::to_string(last_sent) + ".");
+    }
+    return grpc::Status::OK;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <grpcpp/grpcpp.h>
+#include "proto/payment_service.grpc.pb.h"
+#include "src/db/databaseInterface.h"
+#include "src/events/eventBus.h"
+#include "src/cache/accountFilter.h"
+#include "src/cache/balanceTable.h"
+#include "src/compression/compressionPolicy.h"
+
+class PaymentServiceImpl final : public payment::PaymentService::Service {
+private:
+    IDatabase* db;
+    EventBus* bus;
+    CompressionPolicy* compression;
+    BalanceTable* balances;
+    AccountFilter* accounts;
+    // a PostgresListener calls PublishChanges for every commit, this server's own included
+    bool commits_notified;
+
+    // false only when the account surely does not exist
+    bool MayExist(int user_id);
+    // PublishChanges for a commit of this server, unless the listener does it
+    void Committed(int user_id);
+public:
+    PaymentServiceImpl(IDatabase* database, EventBus* event_bus, CompressionPolicy* compression_policy, BalanceTable* balance_table,
+                       AccountFilter* account_filter = nullptr, bool commits_notified = false)
+        : db(database), bus(event_bus), compression(compression_policy), balances(balance_table), accounts(account_filter),
+          commits_notified(commits_notified) {}
+
+    // pushes transactions of user_id newer than what its watchers have seen
+    void PublishChanges(int user_id);
+
+    grpc::Status TransferMoney(grpc::ServerContext* context, const payment::TransferRequest* request, payment::TransferResponse* response) override;
+    grpc::Status CheckBalance(grpc::ServerContext* context, const payment::BalanceRequest* request, payment::BalanceResponse* response) override;
+    grpc::Status GetTransactionHistory(grpc::ServerContext* context, const payment::HistoryRequest* request, payment::HistoryResponse* response) override;
+    grpc::Status GetAccountSummary(grpc::ServerContext* context, const payment::SummaryRequest* request, payment::SummaryResponse* response) override;
+    grpc::Status DepositMoney(grpc::ServerContext* context, const payment::DepositRequest* request, payment::DepositResponse* response) override;
+    grpc::Status WithdrawMoney(grpc::ServerContext* context, const payment::WithdrawRequest* request, payment::WithdrawResponse* response) override;
+    grpc::Status WatchAccount(grpc::ServerContext* context, const payment::WatchRequest* request, grpc::ServerWriter<payment::AccountEvent>* writer) override;
+};
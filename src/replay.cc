@@ -0,0 +1,262 @@
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "src/config/environment.h"
+#include "src/load/latencyHistogram.h"
+#include "src/trace/traceFile.h"
+
+// Re-issues the calls of a trace written by the server (TRACE_FILE) against
+// REPLAY_TARGET (localhost:50051), byte for byte through a generic stub,
+// over REPLAY_CHANNELS connections completed by REPLAY_THREADS threads.
+// REPLAY_SPEED=1 keeps the recorded arrival times, 2 replays twice as
+// fast and so on; 0 ignores them and keeps REPLAY_CONCURRENCY calls in
+// flight. Timed replays measure each call from when it was due, so a
+// server that falls behind shows it in the latency rather than in a
+// stretched schedule.
+//
+// Per method it then sets the recorded latencies beside the replayed ones
+// and counts the calls that ended with another status than recorded. The
+// recorded latency is taken inside the server and the replayed one at the
+// client, so the difference includes the network and gRPC's transport.
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string target;
+    int channels;
+    int threads;
+    double speed;
+    int concurrency;
+    int max_inflight;
+    int timeout_ms;
+};
+
+struct Call {
+    const TraceEntry* entry;
+    Clock::time_point intended;
+    grpc::ClientContext context;
+    grpc::Status status;
+    grpc::ByteBuffer response;
+    std::unique_ptr<grpc::GenericClientAsyncResponseReader> reader;
+};
+
+// one completion queue, its share of the channels and every threads-th
+// entry of the trace; only its own thread touches it until Run returns
+class Worker {
+public:
+    Worker(const Options& options) : latency(kTraceMethodCount), options(options) {}
+
+    void AddChannel(const std::shared_ptr<grpc::Channel>& channel) {
+        stubs.push_back(std::make_unique<grpc::GenericStub>(channel));
+    }
+
+    void AddEntry(const TraceEntry* entry) {
+        entries.push_back(entry);
+    }
+
+    // entry i is due at start + (arrival_i - first_arrival) / speed, or as
+    // soon as one of slots frees up when speed is 0
+    void Run(Clock::time_point start, int64_t first_arrival, int slots) {
+        bool timed = options.speed > 0;
+        size_t next = 0;
+        int inflight = 0;
+        for (;;) {
+            Clock::time_point now = Clock::now();
+            Clock::time_point due = Clock::time_point::max();
+            for (; next < entries.size(); ++next) {
+                if (!timed) {
+                    if (inflight >= slots) {
+                        break;
+                    }
+                    Issue(entries[next], now);
+                    inflight++;
+                    continue;
+                }
+                due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(
+                                  (entries[next]->arrival_us - first_arrival) / options.speed));
+                if (due > now || inflight >= options.max_inflight) {
+                    break;
+                }
+                Issue(entries[next], due);
+                inflight++;
+            }
+            if (next == entries.size() && inflight == 0) {
+                break;
+            }
+            Clock::time_point deadline = now + std::chrono::seconds(1);
+            if (timed && next < entries.size() && inflight < options.max_inflight) {
+                deadline = due;
+            }
+
+            void* tag;
+            bool ok;
+            // gRPC only takes system_clock deadlines
+            auto wait = std::chrono::system_clock::now() + std::max(deadline - now, Clock::duration::zero());
+            if (queue.AsyncNext(&tag, &ok, wait) != grpc::CompletionQueue::GOT_EVENT) {
+                continue;
+            }
+            std::unique_ptr<Call> call(static_cast<Call*>(tag));
+            inflight--;
+            latency[call->entry->method].Record(Micros(Clock::now() - call->intended));
+            if (call->status.error_code() != call->entry->status) {
+                mismatches++;
+            }
+            if (!call->status.ok()) {
+                errors++;
+            }
+        }
+        queue.Shutdown();
+        void* tag;
+        bool ok;
+        while (queue.Next(&tag, &ok)) {
+        }
+    }
+
+    std::vector<LatencyHistogram> latency;
+    int64_t mismatches = 0;
+    int64_t errors = 0;
+
+private:
+    static int64_t Micros(Clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+
+    void Issue(const TraceEntry* entry, Clock::time_point intended) {
+        auto* call = new Call();
+        call->entry = entry;
+        call->intended = intended;
+        call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(options.timeout_ms));
+        grpc::Slice slice(entry->request);
+        grpc::ByteBuffer request(&slice, 1);
+        grpc::GenericStub* stub = stubs[next_stub++ % stubs.size()].get();
+        call->reader = stub->PrepareUnaryCall(&call->context, kTraceMethods[entry->method], request, &queue);
+        call->reader->StartCall();
+        call->reader->Finish(&call->response, &call->status, call);
+    }
+
+    const Options& options;
+    grpc::CompletionQueue queue;
+    std::vector<std::unique_ptr<grpc::GenericStub>> stubs;
+    size_t next_stub = 0;
+    std::vector<const TraceEntry*> entries;
+};
+
+static void PrintRow(const char* name, const char* side, const LatencyHistogram& histogram) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-22s %-9s %10lld %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, side,
+                  static_cast<long long>(histogram.Count()), histogram.ValueAtPercentile(50) / 1000.0,
+                  histogram.ValueAtPercentile(90) / 1000.0, histogram.ValueAtPercentile(99) / 1000.0,
+                  histogram.ValueAtPercentile(99.9) / 1000.0, histogram.Max() / 1000.0);
+    std::cout << line;
+}
+
+int main() {
+    load_env();
+    const char* trace = getenv("REPLAY_TRACE");
+    const char* target = getenv("REPLAY_TARGET");
+    if (!trace) {
+        std::cerr << "REPLAY_TRACE names the trace to replay" << std::endl;
+        return 1;
+    }
+    Options options;
+    options.target = target ? target : "localhost:50051";
+    options.channels = std::max(env_int("REPLAY_CHANNELS", 4), 1);
+    options.threads = std::max(env_int("REPLAY_THREADS", 2), 1);
+    options.speed = std::max(env_double("REPLAY_SPEED", 1), 0.0);
+    options.concurrency = std::max(env_int("REPLAY_CONCURRENCY", 64), 1);
+    options.max_inflight = std::max(env_int("REPLAY_MAX_INFLIGHT", 10000), 1);
+    options.timeout_ms = env_int("REPLAY_TIMEOUT_MS", 10000);
+
+    std::vector<TraceEntry> entries;
+    try {
+        entries = ReadTrace(trace);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (entries.empty()) {
+        std::cerr << trace << " holds no calls" << std::endl;
+        return 1;
+    }
+
+    // separate channel arguments keep gRPC from sharing one connection
+    std::vector<std::shared_ptr<grpc::Channel>> channels;
+    for (int i = 0; i < options.channels; ++i) {
+        grpc::ChannelArguments args;
+        args.SetInt("replay.channel", i);
+        channels.push_back(grpc::CreateCustomChannel(options.target, grpc::InsecureChannelCredentials(), args));
+    }
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.push_back(std::make_unique<Worker>(options));
+        for (int i = t; i < options.channels; i += options.threads) {
+            workers.back()->AddChannel(channels[i]);
+        }
+        if (t >= options.channels) {
+            workers.back()->AddChannel(channels[t % options.channels]);
+        }
+    }
+    std::vector<LatencyHistogram> recorded(kTraceMethodCount);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        workers[i % options.threads]->AddEntry(&entries[i]);
+        recorded[entries[i].method].Record(entries[i].latency_us);
+    }
+
+    Clock::time_point start = Clock::now();
+    int64_t first_arrival = entries.front().arrival_us;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < options.threads; ++t) {
+        int slots = options.concurrency / options.threads + (t < options.concurrency % options.threads ? 1 : 0);
+        threads.emplace_back([&, t, slots] { workers[t]->Run(start, first_arrival, std::max(slots, 1)); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<LatencyHistogram> replayed(kTraceMethodCount);
+    int64_t mismatches = 0;
+    int64_t errors = 0;
+    for (auto& worker : workers) {
+        for (int method = 0; method < kTraceMethodCount; ++method) {
+            replayed[method].Merge(worker->latency[method]);
+        }
+        mismatches += worker->mismatches;
+        errors += worker->errors;
+    }
+
+    double recorded_span = (entries.back().arrival_us - first_arrival) / 1e6;
+    std::cout << entries.size() << " calls recorded over " << recorded_span << " s, replayed ";
+    if (options.speed > 0) {
+        std::cout << "at " << options.speed << "x";
+    }
+    else {
+        std::cout << "with " << options.concurrency << " calls in flight";
+    }
+    std::cout << " in " << elapsed << " s (" << entries.size() / std::max(elapsed, 1e-9) << " calls/s): " << errors
+              << " failed, " << mismatches << " with another status than recorded" << std::endl << std::endl;
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-22s %-9s %10s %10s %10s %10s %10s %10s\n", "method", "", "calls", "p50 ms",
+                  "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+    std::cout << line;
+    for (int method = 0; method < kTraceMethodCount; ++method) {
+        if (recorded[method].Count() == 0) {
+            continue;
+        }
+        // the short name after "/payment.PaymentService/"
+        const char* name = std::strrchr(kTraceMethods[method], '/') + 1;
+        PrintRow(name, "recorded", recorded[method]);
+        PrintRow("", "replayed", replayed[method]);
+    }
+    return 0;
+}
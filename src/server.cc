@@ -1,176 +1,260 @@
 #include <grpcpp/grpcpp.h>
+#include <algorithm>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <cstdlib>
 #include <memory>
 #include <string>
-#include "proto/payment_service.grpc.pb.h"
+#include <thread>
+#include "src/paymentService.h"
+#include "src/adminService.h"
+#include "src/config/environment.h"
 #include "src/db/postgres.h"
+#include "src/db/inMemory.h"
+#include "src/db/durable.h"
+#include "src/db/sequenced.h"
+#include "src/db/sharded.h"
+#include "src/db/postgresListener.h"
+#include "src/db/postgresWriteBehind.h"
+#include "src/db/archived.h"
+#include "src/db/faultInjecting.h"
+#include "src/cache/indexedDatabase.h"
+#include "src/metrics/metrics.h"
+#include "src/trace/traceInterceptor.h"
 
 using grpc::Server;
 using grpc::ServerBuilder;
-using std::pair;
-
-void load_env(const std::string& filename = ".env") {
-    std::ifstream file(filename);
-    if (!file.is_open()) return;
-
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line.empty() || line[0] == '#') continue;
-        size_t equal_pos = line.find('=');
-        if (equal_pos != std::string::npos) {
-            std::string key = line.substr(0, equal_pos);
-            std::string value = line.substr(equal_pos + 1);
-            setenv(key.c_str(), value.c_str(), true);
-        }
-    }
-}
 
+// conn is empty when the server does not run on Postgres
+void RunServer(IDatabase* db, const std::string& conn) {
+    std::string server_address("0.0.0.0:50051");
+    EventBus bus(env_int("WATCH_QUEUE_CAPACITY", 256));
+    const char* algorithm = getenv("COMPRESSION_ALGORITHM");
+    CompressionPolicy compression(ParseCompressionAlgorithm(algorithm ? algorithm : "gzip"),
+                                  env_int("COMPRESSION_MIN_BYTES", 1024),
+                                  env_int("COMPRESSION_SAMPLE_EVERY", 64));
+    compression.Disable("CheckBalance");
+    // kept current by every commit of this engine and, on Postgres, of the other instances
+    BalanceTable balances(env_int("BALANCE_TABLE_CAPACITY", 1 << 20));
+    // recent history of the accounts that were read, HISTORY_INDEX_MB 0 turns it off
+    int history_mb = env_int("HISTORY_INDEX_MB", 64);
+    HistoryIndex history(static_cast<size_t>(std::max(history_mb, 1)) << 20);
+    auto publish_balance = [&balances, &history](int user_id, double balance, int version) {
+        balances.Publish(user_id, balance, version);
+        history.Observe(user_id, version);
+    };
+    // DB_FAULTS slows down and breaks the engine on purpose (see
+    // faultInjecting.h), adjustable at runtime through AdminService
+    const char* fault_spec = getenv("DB_FAULTS");
+    std::unique_ptr<FaultInjectingDatabase> faults;
+    std::unique_ptr<AdminServiceImpl> admin;
+    if (fault_spec) {
+        faults = std::make_unique<FaultInjectingDatabase>(db);
+        faults->Configure(fault_spec);
+        admin = std::make_unique<AdminServiceImpl>(faults.get());
+        db = faults.get();
+    }
+    db->SetBalanceObserver(publish_balance);
+    // history the archiver moved to segment files in ARCHIVE_DIR, picked up every ARCHIVE_REFRESH seconds
+    const char* archive_dir = getenv("ARCHIVE_DIR");
+    std::unique_ptr<ArchivedDatabase> archived;
+    if (archive_dir) {
+        archived = std::make_unique<ArchivedDatabase>(db, archive_dir);
+        archived->StartRefresh(env_int("ARCHIVE_REFRESH", 60));
+        db = archived.get();
+    }
+    IndexedDatabase indexed(db, &history);
+    // every account in Postgres, kept current by the users_created trigger; ACCOUNT_FILTER=0 turns it off
+    AccountFilter accounts;
+    bool filter_accounts = !conn.empty() && env_int("ACCOUNT_FILTER", 1) != 0;
+    PaymentServiceImpl service(history_mb > 0 ? &indexed : db, &bus, &compression, &balances,
+                               filter_accounts ? &accounts : nullptr, !conn.empty());
 
+    // fan-in of the commits of every server instance, this one included
+    PostgresListener listener(conn, [&service](int user_id) { service.PublishChanges(user_id); }, publish_balance,
+                              filter_accounts ? [&accounts](int user_id) { accounts.Add(user_id); } : std::function<void(int)>(),
+                              [&accounts] { accounts.MarkLoaded(); },
+                              // other instances' commits go unheard until the listener is back
+                              [&accounts, &balances] {
+                                  accounts.MarkUnloaded();
+                                  balances.Bypass();
+                              },
+                              // balances changed while nobody listened are not in the table
+                              [&balances] { balances.Clear(); });
+    if (!conn.empty()) {
+        balances.Bypass();
+        listener.Start();
+    }
 
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+    builder.RegisterService(&service);
+    if (admin) {
+        builder.RegisterService(admin.get());
+    }
 
+    // one in TRACE_SAMPLE unary calls recorded to TRACE_FILE for the replay tool
+    const char* trace_file = getenv("TRACE_FILE");
+    std::unique_ptr<TraceRecorder> recorder;
+    if (trace_file) {
+        recorder = std::make_unique<TraceRecorder>(trace_file, env_int("TRACE_SAMPLE", 100),
+                                                   env_int("TRACE_BUFFER", 65536));
+        std::vector<std::unique_ptr<grpc::experimental::ServerInterceptorFactoryInterface>> interceptors;
+        interceptors.push_back(std::make_unique<TraceInterceptorFactory>(recorder.get()));
+        builder.experimental().SetInterceptorCreators(std::move(interceptors));
+    }
 
+    std::unique_ptr<Server> server(builder.BuildAndStart());
+    std::cout << "Server listening on " << server_address << std::endl;
 
-class PaymentServiceImpl final : public payment::PaymentService::Service {
-private:
-    PostgresDatabase* db;
-public:
-    PaymentServiceImpl(PostgresDatabase* database) : db(database) {}
-    grpc::Status TransferMoney(grpc::ServerContext* context, const payment::TransferRequest* request, payment::TransferResponse* response) override {
-        int sender_id = request->sender_id();
-        int receiver_id = request->receiver_id();
-        double amount = request->amount();
-
-        try {
-            bool result = db->TransferMoney(sender_id, receiver_id, amount);
-            if (result != 0) {
-                if (result == 1) {
-                    response->set_success(false);
-                    response->set_message("Sender not found.");
-                    return grpc::Status::OK;
-                }
-                else if (result == 2) {
-                    response->set_success(false);
-                    response->set_message("Receiver not found.");
-                    return grpc::Status::OK;
-                }
-                else if (result == 3) {
-                    response->set_success(false);
-                    response->set_message("Not enough money.");
-                    return grpc::Status::OK;
-                }
+    int metrics_interval = env_int("METRICS_INTERVAL", 0);
+    if (metrics_interval > 0) {
+        std::thread([metrics_interval] {
+            while (true) {
+                std::this_thread::sleep_for(std::chrono::seconds(metrics_interval));
+                Metrics::Global().Dump(std::cout);
             }
-            response->set_success(true);
-            response->set_message("Transfer successful.");
-        }
-        catch (const std::exception& e) {
-            response->set_success(false);
-            response->set_message("Database error: " + std::string(e.what()));
-        }
-
-        return grpc::Status::OK;
+        }).detach();
     }
+    server->Wait();
+}
 
-    grpc::Status CheckBalance(grpc::ServerContext* context, const payment::BalanceRequest* request, payment::BalanceResponse* response) override {
-        int sender_id = request->user_id();
-        try {
-            pair<double, bool> balance = db->GetBalance(sender_id);
-            if (balance.second != 0) {
-                response->set_message("User not found.");
-                return grpc::Status::OK;
-            }
-            response->set_balance(balance.first);
-        }
-        catch (const std::exception& e) {
-            std::cerr << ("Database error: " + std::string(e.what()));
-        }
+// DB_ENGINE=memory serves a process-local ledger seeded with
+// MEMORY_ACCOUNTS accounts (ids 1..N) holding MEMORY_INITIAL_BALANCE each
+std::unique_ptr<IDatabase> MakeInMemoryDatabase() {
+    int accounts = env_int("MEMORY_ACCOUNTS", 1000);
+    int capacity = std::max(env_int("MEMORY_CAPACITY", 1 << 20), accounts);
+    double initial_balance = getenv("MEMORY_INITIAL_BALANCE") ? std::stod(getenv("MEMORY_INITIAL_BALANCE")) : 1000.0;
 
-        return grpc::Status::OK;
+    auto db = std::make_unique<InMemoryDatabase>(capacity);
+    for (int user_id = 1; user_id <= accounts; ++user_id) {
+        db->CreateAccount(user_id, initial_balance);
     }
+    std::cout << "Using in-memory ledger with " << accounts << " accounts" << std::endl;
+    return db;
+}
 
-    grpc::Status GetTransactionHistory(grpc::ServerContext* context, const payment::HistoryRequest* request, payment::HistoryResponse* response) override {
-        int sender_id = request->user_id();
-        try {
-            std::vector<Transaction> out = db->GetTransactions(sender_id);
+// DB_ENGINE=durable keeps the in-memory ledger in DURABLE_DIR as a WAL
+// plus snapshots taken every CHECKPOINT_INTERVAL seconds; a fresh
+// directory is seeded like the memory engine
+std::unique_ptr<IDatabase> MakeDurableDatabase() {
+    const char* dir = getenv("DURABLE_DIR");
+    int accounts = env_int("MEMORY_ACCOUNTS", 1000);
+    int capacity = std::max(env_int("MEMORY_CAPACITY", 1 << 20), accounts);
+    double initial_balance = getenv("MEMORY_INITIAL_BALANCE") ? std::stod(getenv("MEMORY_INITIAL_BALANCE")) : 1000.0;
 
-            for (const auto& row : out) {
-                payment::Transaction* transaction = response->add_transactions();
-                transaction->set_transaction_id(row.transaction_id);
-                transaction->set_sender_id(row.sender_id);
-                transaction->set_receiver_id(row.receiver_id);
-                transaction->set_amount(row.amount);
-                transaction->set_timestamp(row.timestamp);
-                transaction->set_status(row.status);
-            }
+    auto db = std::make_unique<DurableDatabase>(dir ? dir : "data", capacity,
+                                                env_int("WAL_GROUP_COMMIT_US", 0),
+                                                env_int("REPLAY_THREADS", std::thread::hardware_concurrency()));
+    if (db->AccountCount() == 0) {
+        for (int user_id = 1; user_id <= accounts; ++user_id) {
+            db->CreateAccount(user_id, initial_balance);
         }
-        catch (const std::exception& e) {
-            std::cerr << ("Database error: " + std::string(e.what()));
-        }
-
-        return grpc::Status::OK;
+        db->Checkpoint();
     }
+    db->StartCheckpoints(env_int("CHECKPOINT_INTERVAL", 60));
+    return db;
+}
 
-    grpc::Status DepositMoney(grpc::ServerContext* context, const payment::DepositRequest* request, payment::DepositResponse* response) override {
-        int sender_id = request->user_id();
-        double amount = request->amount();
-        try {
-            db->DepositMoney(sender_id, amount);
-        }
-        catch (const std::exception& e) {
-            std::cerr << ("Database error: " + std::string(e.what()));
-        }
-
-        return grpc::Status::OK;
-    }
+// DB_ENGINE=sequencer applies every call on one SEQUENCER_CPU pinned
+// thread fed through a SEQUENCER_RING_SIZE slot ring; seeded like the
+// memory engine
+std::unique_ptr<IDatabase> MakeSequencedDatabase() {
+    int accounts = env_int("MEMORY_ACCOUNTS", 1000);
+    int capacity = std::max(env_int("MEMORY_CAPACITY", 1 << 20), accounts);
+    double initial_balance = getenv("MEMORY_INITIAL_BALANCE") ? std::stod(getenv("MEMORY_INITIAL_BALANCE")) : 1000.0;
+    const char* wait = getenv("SEQUENCER_WAIT");
 
-    grpc::Status WithdrawMoney(grpc::ServerContext* context, const payment::WithdrawRequest* request, payment::WithdrawResponse* response) override {
-        int sender_id = request->user_id();
-        double amount = request->amount();
-        try {
-            int result = db->WithdrawMoney(sender_id, amount);
-            if (result != 0) {
-                if (result == 1) {
-                    return grpc::Status::CANCELLED;
-                }
-            }
-        }
-        catch (const std::exception& e) {
-            std::cerr << ("Database error: " + std::string(e.what()));
-        }
+    SequencerOptions options;
+    options.ring_size = env_int("SEQUENCER_RING_SIZE", 65536);
+    options.wait = ParseWaitStrategy(wait ? wait : "block");
+    options.batch_size = env_int("SEQUENCER_BATCH", 256);
+    options.cpu = env_int("SEQUENCER_CPU", -1);
 
-        return grpc::Status::OK;
+    auto db = std::make_unique<SequencedDatabase>(capacity, options);
+    for (int user_id = 1; user_id <= accounts; ++user_id) {
+        db->CreateAccount(user_id, initial_balance);
     }
-};
+    std::cout << "Using sequenced ledger with " << accounts << " accounts" << std::endl;
+    return db;
+}
 
-void RunServer(PostgresDatabase* db) {
-    std::string server_address("0.0.0.0:50051");
-    PaymentServiceImpl service(db);
+// DB_ENGINE=sharded splits the accounts across SHARD_COUNT worker threads,
+// pinned from SHARD_FIRST_CPU on; seeded like the memory engine
+std::unique_ptr<IDatabase> MakeShardedDatabase() {
+    int accounts = env_int("MEMORY_ACCOUNTS", 1000);
+    int capacity = std::max(env_int("MEMORY_CAPACITY", 1 << 20), accounts);
+    double initial_balance = getenv("MEMORY_INITIAL_BALANCE") ? std::stod(getenv("MEMORY_INITIAL_BALANCE")) : 1000.0;
+    const char* wait = getenv("SHARD_WAIT");
 
-    grpc::ServerBuilder builder;
-    builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
-    builder.RegisterService(&service);
+    ShardOptions options;
+    options.shards = env_int("SHARD_COUNT", std::max(1u, std::thread::hardware_concurrency()));
+    options.ring_size = env_int("SHARD_RING_SIZE", 16384);
+    options.channel_size = env_int("SHARD_CHANNEL_SIZE", 4096);
+    options.wait = ParseWaitStrategy(wait ? wait : "block");
+    options.batch_size = env_int("SHARD_BATCH", 256);
+    options.first_cpu = env_int("SHARD_FIRST_CPU", -1);
 
-    std::unique_ptr<Server> server(builder.BuildAndStart());
-    std::cout << "Server listening on " << server_address << std::endl;
-    server->Wait();
+    auto db = std::make_unique<ShardedDatabase>(capacity, options);
+    for (int user_id = 1; user_id <= accounts; ++user_id) {
+        db->CreateAccount(user_id, initial_balance);
+    }
+    std::cout << "Using " << options.shards << " ledger shards with " << accounts << " accounts" << std::endl;
+    return db;
+}
+
+// DB_ENGINE=writebehind serves the durable engine kept in WRITE_BEHIND_DIR
+// and streams its commits to Postgres in batches of WRITE_BEHIND_BATCH rows
+// at least every WRITE_BEHIND_FLUSH_MS; mutations wait once more than
+// WRITE_BEHIND_MAX_LAG rows are not in Postgres yet. A fresh directory is
+// loaded from Postgres, which no other server may write to meanwhile.
+void RunWriteBehindServer(const std::string& conn) {
+    PostgresWriteBehindSink sink(conn);
+    const char* dir = getenv("WRITE_BEHIND_DIR");
+    int capacity = env_int("MEMORY_CAPACITY", 1 << 20);
+    DurableDatabase local(dir ? dir : "write-behind", capacity, env_int("WAL_GROUP_COMMIT_US", 0),
+                          env_int("REPLAY_THREADS", std::thread::hardware_concurrency()));
+    if (local.AccountCount() == 0) {
+        sink.Seed(&local);
+        std::cout << "Loaded " << local.AccountCount() << " accounts from Postgres" << std::endl;
+    }
+    local.StartCheckpoints(env_int("CHECKPOINT_INTERVAL", 60));
+    WriteBehindDatabase db(&local, &sink, env_int("WRITE_BEHIND_MAX_LAG", 100000),
+                           env_int("WRITE_BEHIND_BATCH", 5000), env_int("WRITE_BEHIND_FLUSH_MS", 50));
+    RunServer(&db, "");
 }
 
 int main() {
     load_env();
-    std::string db_user = getenv("DB_USER");
-    std::string db_pass = getenv("DB_PASSWORD");
-    std::string db_name = getenv("DB_NAME");
-    std::string db_host = getenv("DB_HOST");
-    std::string db_port = getenv("DB_PORT");
-
-    const std::string conn("user=" + db_user +
-                            " password=" + db_pass +
-                            " dbname=" + db_name +
-                            " host=" + db_host +
-                            " port=" + db_port);
-    PostgresDatabase db(conn);
-    RunServer(&db);
+    const char* engine = getenv("DB_ENGINE");
+    if (engine && std::string(engine) == "memory") {
+        std::unique_ptr<IDatabase> db = MakeInMemoryDatabase();
+        RunServer(db.get(), "");
+        return 0;
+    }
+    if (engine && std::string(engine) == "durable") {
+        std::unique_ptr<IDatabase> db = MakeDurableDatabase();
+        RunServer(db.get(), "");
+        return 0;
+    }
+    if (engine && std::string(engine) == "sequencer") {
+        std::unique_ptr<IDatabase> db = MakeSequencedDatabase();
+        RunServer(db.get(), "");
+        return 0;
+    }
+    if (engine && std::string(engine) == "sharded") {
+        std::unique_ptr<IDatabase> db = MakeShardedDatabase();
+        RunServer(db.get(), "");
+        return 0;
+    }
+
+    if (engine && std::string(engine) == "writebehind") {
+        RunWriteBehindServer(PostgresConnection());
+        return 0;
+    }
+
+    // one pooled connection per concurrent call, up to DB_POOL_SIZE
+    const std::string conn = PostgresConnection();
+    PostgresDatabase db(conn, env_int("DB_POOL_SIZE", 8));
+    RunServer(&db, conn);
     return 0;
 }
\ No newline at end of file
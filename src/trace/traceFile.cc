@@ -0,0 +1,92 @@
+#include "traceFile.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+const char* const kTraceMethods[kTraceMethodCount] = {
+    "/payment.PaymentService/TransferMoney",
+    "/payment.PaymentService/CheckBalance",
+    "/payment.PaymentService/GetTransactionHistory",
+    "/payment.PaymentService/DepositMoney",
+    "/payment.PaymentService/WithdrawMoney",
+    "/payment.PaymentService/GetAccountSummary",
+};
+
+int TraceMethodIndex(const char* method) {
+    for (int i = 0; i < kTraceMethodCount; ++i) {
+        if (std::strcmp(method, kTraceMethods[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void PutVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static bool GetVarint(const std::string& in, size_t& pos, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AppendTraceEntry(std::string& out, int method, int status, int64_t arrival_us, int64_t latency_us,
+                      const void* request, size_t size) {
+    out.push_back(static_cast<char>(method));
+    PutVarint(out, static_cast<uint64_t>(status));
+    PutVarint(out, static_cast<uint64_t>(std::max<int64_t>(arrival_us, 0)));
+    PutVarint(out, static_cast<uint64_t>(std::max<int64_t>(latency_us, 0)));
+    PutVarint(out, size);
+    out.append(static_cast<const char*>(request), size);
+}
+
+std::vector<TraceEntry> ReadTrace(const std::string& path, int64_t* start_unix_us) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("cannot open trace " + path);
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 16 || std::memcmp(data.data(), kTraceMagic, sizeof(kTraceMagic)) != 0) {
+        throw std::runtime_error(path + " is not a trace");
+    }
+    if (start_unix_us) {
+        std::memcpy(start_unix_us, data.data() + 8, sizeof(int64_t));
+    }
+
+    std::vector<TraceEntry> entries;
+    size_t pos = 16;
+    while (pos < data.size()) {
+        TraceEntry entry;
+        uint64_t status, arrival, latency, size;
+        entry.method = static_cast<uint8_t>(data[pos++]);
+        if (!GetVarint(data, pos, &status) || !GetVarint(data, pos, &arrival) || !GetVarint(data, pos, &latency) ||
+            !GetVarint(data, pos, &size) || size > data.size() - pos) {
+            break; // torn tail of a recording that was cut off
+        }
+        if (entry.method >= kTraceMethodCount) {
+            throw std::runtime_error(path + " has an unknown method at offset " + std::to_string(pos));
+        }
+        entry.status = static_cast<int>(status);
+        entry.arrival_us = static_cast<int64_t>(arrival);
+        entry.latency_us = static_cast<int64_t>(latency);
+        entry.request.assign(data, pos, size);
+        pos += size;
+        entries.push_back(std::move(entry));
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const TraceEntry& a, const TraceEntry& b) { return a.arrival_us < b.arrival_us; });
+    return entries;
+}
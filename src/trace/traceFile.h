@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A trace is a 16 byte header ("BANKTRC1", then the recording's start as
+// int64 microseconds since the epoch) followed by one record per RPC:
+// method index byte, then varints for the status code, arrival (us since
+// start), server latency (us) and request size, then the serialized
+// request. Records follow completion order, so arrivals are not sorted.
+
+constexpr char kTraceMagic[8] = {'B', 'A', 'N', 'K', 'T', 'R', 'C', '1'};
+
+// unary methods a trace can hold, by index; WatchAccount streams are not recorded
+constexpr int kTraceMethodCount = 6;
+extern const char* const kTraceMethods[kTraceMethodCount];
+
+// index of a full "/payment.PaymentService/Name" method, -1 when not traced
+int TraceMethodIndex(const char* method);
+
+struct TraceEntry {
+    int64_t arrival_us = 0;
+    int64_t latency_us = 0;
+    int method = 0;
+    int status = 0;
+    std::string request;
+};
+
+void AppendTraceEntry(std::string& out, int method, int status, int64_t arrival_us, int64_t latency_us,
+                      const void* request, size_t size);
+
+// every entry of the file, sorted by arrival; throws runtime_error when the
+// file is unreadable or corrupt, a torn last record is dropped
+std::vector<TraceEntry> ReadTrace(const std::string& path, int64_t* start_unix_us = nullptr);
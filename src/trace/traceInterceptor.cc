@@ -0,0 +1,49 @@
+#include "traceInterceptor.h"
+#include <google/protobuf/message.h>
+
+namespace {
+
+using grpc::experimental::InterceptionHookPoints;
+
+// arrival is when the call was matched to a method, the request is
+// serialized again once it has been parsed and the call is recorded with
+// the status it ends with
+class TraceInterceptor : public grpc::experimental::Interceptor {
+public:
+    TraceInterceptor(TraceRecorder* recorder, int method)
+        : recorder(recorder), method(method), arrival_us(recorder->Now()) {}
+
+    void Intercept(grpc::experimental::InterceptorBatchMethods* methods) override {
+        if (methods->QueryInterceptionHookPoint(InterceptionHookPoints::POST_RECV_MESSAGE)) {
+            auto* message = static_cast<const google::protobuf::Message*>(methods->GetRecvMessage());
+            if (message != nullptr) {
+                message->SerializeToString(&request);
+            }
+        }
+        if (methods->QueryInterceptionHookPoint(InterceptionHookPoints::PRE_SEND_STATUS)) {
+            recorder->Record(method, methods->GetSendStatus().error_code(), arrival_us, recorder->Now() - arrival_us,
+                             request.data(), request.size());
+        }
+        methods->Proceed();
+    }
+
+private:
+    TraceRecorder* recorder;
+    int method;
+    int64_t arrival_us;
+    std::string request;
+};
+
+}
+
+grpc::experimental::Interceptor* TraceInterceptorFactory::CreateServerInterceptor(
+    grpc::experimental::ServerRpcInfo* info) {
+    if (info->type() != grpc::experimental::ServerRpcInfo::Type::UNARY) {
+        return nullptr;
+    }
+    int method = TraceMethodIndex(info->method());
+    if (method < 0 || !recorder->Sample()) {
+        return nullptr;
+    }
+    return new TraceInterceptor(recorder, method);
+}
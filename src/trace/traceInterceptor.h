@@ -0,0 +1,16 @@
+#pragma once
+#include <grpcpp/support/server_interceptor.h>
+#include "traceRecorder.h"
+
+// Records the sampled unary calls of a server into a TraceRecorder:
+//   builder.experimental().SetInterceptorCreators(...TraceInterceptorFactory(&recorder)...)
+// Calls that are not sampled get no interceptor at all.
+class TraceInterceptorFactory : public grpc::experimental::ServerInterceptorFactoryInterface {
+public:
+    explicit TraceInterceptorFactory(TraceRecorder* recorder) : recorder(recorder) {}
+
+    grpc::experimental::Interceptor* CreateServerInterceptor(grpc::experimental::ServerRpcInfo* info) override;
+
+private:
+    TraceRecorder* recorder;
+};
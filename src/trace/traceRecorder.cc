@@ -0,0 +1,87 @@
+#include "traceRecorder.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "src/metrics/metrics.h"
+
+TraceRecorder::TraceRecorder(const std::string& path, int sample_every, size_t buffer_records)
+    : file(std::fopen(path.c_str(), "wb")), sample_every(std::max(sample_every, 1)),
+      start(std::chrono::steady_clock::now()), ring(buffer_records),
+      recorded(Metrics::Global().Counter("trace.recorded")),
+      dropped(Metrics::Global().Counter("trace.dropped")) {
+    if (file == nullptr) {
+        throw std::runtime_error("cannot create trace " + path);
+    }
+    int64_t start_unix_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    char header[16];
+    std::memcpy(header, kTraceMagic, sizeof(kTraceMagic));
+    std::memcpy(header + 8, &start_unix_us, sizeof(start_unix_us));
+    std::fwrite(header, 1, sizeof(header), file);
+
+    writer = std::thread([this] {
+        std::unique_lock<std::mutex> lock(writer_mutex);
+        while (!writer_cv.wait_for(lock, std::chrono::milliseconds(20), [this] { return stopping; })) {
+            Drain();
+        }
+        Drain();
+    });
+}
+
+TraceRecorder::~TraceRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        stopping = true;
+    }
+    writer_cv.notify_all();
+    writer.join();
+    std::fclose(file);
+}
+
+bool TraceRecorder::Sample() {
+    thread_local uint64_t calls = 0;
+    return ++calls % sample_every == 0;
+}
+
+int64_t TraceRecorder::Now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool TraceRecorder::Record(int method, int status, int64_t arrival_us, int64_t latency_us,
+                           const void* request, size_t size) {
+    if (size > kMaxRequestBytes) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Call call;
+    call.arrival_us = arrival_us;
+    call.latency_us = latency_us;
+    call.status = status;
+    call.size = static_cast<uint16_t>(size);
+    call.method = static_cast<uint8_t>(method);
+    std::memcpy(call.request, request, size);
+    if (!ring.TryPush(call)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    recorded.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void TraceRecorder::Flush() {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    Drain();
+}
+
+// writer_mutex held, which makes the caller the ring's only consumer
+void TraceRecorder::Drain() {
+    Call call;
+    buffer.clear();
+    while (ring.TryPop(call)) {
+        AppendTraceEntry(buffer, call.method, call.status, call.arrival_us, call.latency_us, call.request, call.size);
+    }
+    if (!buffer.empty()) {
+        std::fwrite(buffer.data(), 1, buffer.size(), file);
+        std::fflush(file);
+    }
+}
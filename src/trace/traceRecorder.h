@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "src/db/mpscRing.h"
+#include "traceFile.h"
+
+// Writes sampled RPCs to a trace file (see traceFile.h) off the request
+// path: Record copies the call into a fixed size cell of a lock-free MPSC
+// ring and returns, a writer thread drains the ring every few
+// milliseconds. When the ring is full or a request exceeds
+// kMaxRequestBytes the call is dropped and counted, never waited for.
+class TraceRecorder {
+public:
+    static constexpr size_t kMaxRequestBytes = 232;
+
+    // records every sample_every-th call; throws when path cannot be created
+    TraceRecorder(const std::string& path, int sample_every, size_t buffer_records);
+    ~TraceRecorder();
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    // decided per call, on a counter of the calling thread
+    bool Sample();
+    // microseconds since the recording started
+    int64_t Now() const;
+    bool Record(int method, int status, int64_t arrival_us, int64_t latency_us, const void* request, size_t size);
+    // writes out everything recorded so far
+    void Flush();
+
+private:
+    struct Call {
+        int64_t arrival_us;
+        int64_t latency_us;
+        int32_t status;
+        uint16_t size;
+        uint8_t method;
+        char request[kMaxRequestBytes];
+    };
+
+    void Drain();
+
+    FILE* file;
+    const int sample_every;
+    const std::chrono::steady_clock::time_point start;
+    MpscRing<Call> ring;
+    std::atomic<int64_t>& recorded;
+    std::atomic<int64_t>& dropped;
+
+    std::mutex writer_mutex;
+    std::condition_variable writer_cv;
+    bool stopping = false;
+    std::string buffer;
+    std::thread writer;
+};
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <climits>
+#include <thread>
+#include <vector>
+#include "src/cache/accountFilter.h"
+
+TEST(AccountFilterTest, ContainsExactlyTheAddedIds) {
+    AccountFilter filter;
+    EXPECT_FALSE(filter.Loaded());
+    const int ids[] = {1, 63, 64, AccountFilter::kPageBits - 1, AccountFilter::kPageBits, 5000000, INT_MAX};
+    for (int user_id : ids) {
+        EXPECT_FALSE(filter.Contains(user_id));
+        filter.Add(user_id);
+    }
+    for (int user_id : ids) {
+        EXPECT_TRUE(filter.Contains(user_id)) << user_id;
+    }
+    for (int user_id : {2, 62, 65, AccountFilter::kPageBits + 1, 4999999, INT_MAX - 1}) {
+        EXPECT_FALSE(filter.Contains(user_id)) << user_id;
+    }
+    filter.Add(0);
+    filter.Add(-5);
+    EXPECT_FALSE(filter.Contains(0));
+    EXPECT_FALSE(filter.Contains(-5));
+    EXPECT_FALSE(filter.Contains(INT_MIN));
+
+    filter.MarkLoaded();
+    EXPECT_TRUE(filter.Loaded());
+    filter.MarkUnloaded();
+    EXPECT_FALSE(filter.Loaded());
+    EXPECT_TRUE(filter.Contains(1));
+}
+
+//only ids just past the highest one added can be creations still in flight
+TEST(AccountFilterTest, OnlyIdsJustPastTheHighestMayBeUnannounced) {
+    AccountFilter filter;
+    EXPECT_EQ(filter.Highest(), 0);
+    filter.Add(500);
+    filter.Add(20);
+    EXPECT_EQ(filter.Highest(), 500);
+    EXPECT_FALSE(filter.MayBeUnannounced(21));
+    EXPECT_FALSE(filter.MayBeUnannounced(500));
+    EXPECT_TRUE(filter.MayBeUnannounced(501));
+    EXPECT_TRUE(filter.MayBeUnannounced(500 + AccountFilter::kUnannouncedIds));
+    EXPECT_FALSE(filter.MayBeUnannounced(501 + AccountFilter::kUnannouncedIds));
+    EXPECT_FALSE(filter.MayBeUnannounced(INT_MAX));
+    EXPECT_FALSE(filter.MayBeUnannounced(-1));
+}
+
+//threads racing on the same fresh pages lose no ids
+TEST(AccountFilterTest, ConcurrentAddsAreNotLost) {
+    AccountFilter filter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&filter, t] {
+            for (int user_id = 1 + t; user_id < 300000; user_id += 4) {
+                filter.Add(user_id);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int user_id = 1; user_id < 300000; ++user_id) {
+        ASSERT_TRUE(filter.Contains(user_id)) << user_id;
+    }
+    EXPECT_FALSE(filter.Contains(300000));
+}
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include "src/db/archived.h"
+#include "src/db/inMemory.h"
+#include "src/db/segment.h"
+#include "temporaryDirectory.h"
+
+namespace {
+
+LedgerRecord Record(int transaction_id, int sender_id, int receiver_id) {
+    Transaction row = {transaction_id, sender_id, receiver_id, 1.5 * transaction_id, "2025-01-01 10:00:00.25",
+                       sender_id == receiver_id ? "deposit" : "transfer"};
+    return ToRecord(row);
+}
+
+std::vector<int> Ids(const std::vector<Transaction>& rows) {
+    std::vector<int> ids;
+    for (const Transaction& row : rows) {
+        ids.push_back(row.transaction_id);
+    }
+    return ids;
+}
+
+void ExpectSameRows(const std::vector<Transaction>& actual, const std::vector<Transaction>& expected) {
+    ASSERT_EQ(Ids(actual), Ids(expected));
+    for (size_t i = 0; i < actual.size(); ++i) {
+        EXPECT_EQ(actual[i].sender_id, expected[i].sender_id);
+        EXPECT_EQ(actual[i].receiver_id, expected[i].receiver_id);
+        EXPECT_DOUBLE_EQ(actual[i].amount, expected[i].amount);
+        EXPECT_EQ(actual[i].timestamp, expected[i].timestamp);
+        EXPECT_EQ(actual[i].status, expected[i].status);
+    }
+}
+
+}
+
+class ArchiveTest : public ::testing::Test {
+protected:
+    // a few hundred transfers, deposits and withdrawals between 5 accounts
+    void Populate(InMemoryDatabase& db) {
+        for (int user_id = 1; user_id <= 5; ++user_id) {
+            db.CreateAccount(user_id, 1000.0);
+        }
+        for (int i = 0; i < 300; ++i) {
+            int sender = 1 + i % 5, receiver = 1 + (i * 3 + 1) % 5;
+            if (i % 7 == 0) {
+                db.DepositMoney(sender, 2.0);
+            }
+            else if (i % 11 == 0) {
+                db.WithdrawMoney(sender, 1.0);
+            }
+            else {
+                db.TransferMoney(sender, receiver, 0.5 + i % 3);
+            }
+        }
+    }
+
+    // what the archiver would write for ids in (after, last]
+    void Archive(InMemoryDatabase& db, int after, int last) {
+        std::map<int, LedgerRecord> rows;
+        for (int user_id = 1; user_id <= 5; ++user_id) {
+            for (const Transaction& row : db.GetTransactions(user_id)) {
+                if (row.transaction_id > after && row.transaction_id <= last) {
+                    rows[row.transaction_id] = ToRecord(row);
+                }
+            }
+        }
+        std::vector<LedgerRecord> records;
+        for (const auto& entry : rows) {
+            records.push_back(entry.second);
+        }
+        WriteSegment(dir, after, last, records);
+    }
+
+    TemporaryDirectory temporary{"archive_test"};
+    std::string dir = temporary.Path();
+};
+
+TEST_F(ArchiveTest, SegmentFilesRecordsUnderEveryAccount) {
+    std::string path = WriteSegment(dir, 10, 20, {Record(11, 3, 1), Record(12, 2, 2), Record(14, 1, 2), Record(20, 3, 3)});
+    EXPECT_EQ(ListSegments(dir), std::vector<std::string>({path}));
+
+    MappedSegment segment(path);
+    EXPECT_EQ(segment.AfterTransactionId(), 10);
+    EXPECT_EQ(segment.LastTransactionId(), 20);
+    EXPECT_EQ(segment.AccountCount(), 3);
+    EXPECT_EQ(segment.RecordCount(), 6);
+
+    auto ids = [&segment](int user_id) {
+        std::vector<int> out;
+        std::pair<const LedgerRecord*, size_t> records = segment.Find(user_id);
+        for (size_t i = 0; i < records.second; ++i) {
+            out.push_back(records.first[i].transaction_id);
+        }
+        return out;
+    };
+    EXPECT_EQ(ids(1), std::vector<int>({11, 14}));
+    EXPECT_EQ(ids(2), std::vector<int>({12, 14}));
+    EXPECT_EQ(ids(3), std::vector<int>({11, 20}));
+    EXPECT_TRUE(ids(4).empty());
+    EXPECT_EQ(ToTransaction(segment.Find(2).first[0]).timestamp, "2025-01-01 10:00:00.25");
+
+    EXPECT_THROW(WriteSegment(dir, 20, 30, {Record(20, 1, 2)}), std::invalid_argument);
+}
+
+TEST_F(ArchiveTest, CorruptSegmentIsRejected) {
+    std::string path = WriteSegment(dir, 0, 5, {Record(1, 1, 2), Record(5, 2, 1)});
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(8);
+        file.put('\x7f');
+    }
+    EXPECT_THROW(MappedSegment segment(path), std::runtime_error);
+
+    std::filesystem::resize_file(path, sizeof(SegmentFooter) - 1);
+    EXPECT_THROW(MappedSegment segment(path), std::runtime_error);
+}
+
+//the engine still has every row, as during the archiver's grace period;
+//rows up to the archive's end come from the segments only, once each
+TEST_F(ArchiveTest, MergesSegmentsWithLiveRows) {
+    InMemoryDatabase live(16);
+    Populate(live);
+    Archive(live, 0, 100);
+    Archive(live, 100, 180);
+
+    ArchivedDatabase db(&live, dir);
+    EXPECT_EQ(db.ArchivedThrough(), 180);
+    for (int user_id = 1; user_id <= 6; ++user_id) {
+        ExpectSameRows(db.GetTransactions(user_id), live.GetTransactionsSince(user_id, 0));
+        for (int since : {50, 100, 150, 180, 250}) {
+            ExpectSameRows(db.GetTransactionsSince(user_id, since), live.GetTransactionsSince(user_id, since));
+        }
+        EXPECT_EQ(db.GetLatestTransactionId(user_id), live.GetLatestTransactionId(user_id));
+
+        HistoryFilter filter;
+        filter.direction = HistoryFilter::Sent;
+        ExpectSameRows(db.FindTransactions(user_id, filter), live.FindTransactions(user_id, filter));
+        for (bool newest_first : {false, true}) {
+            for (int limit : {5, 40, 200}) {
+                filter = HistoryFilter();
+                filter.newest_first = newest_first;
+                filter.limit = limit;
+                filter.since_transaction_id = 20;
+                ExpectSameRows(db.FindTransactions(user_id, filter), live.FindTransactions(user_id, filter));
+            }
+        }
+
+        std::pair<AccountSummary, bool> summary = db.GetAccountSummary(user_id, 500, 0);
+        std::pair<AccountSummary, bool> expected = live.GetAccountSummary(user_id, 500, 0);
+        ASSERT_EQ(summary.second, expected.second);
+        ExpectSameRows(summary.first.recent, expected.first.recent);
+    }
+}
+
+TEST_F(ArchiveTest, RefreshMapsNewSegments) {
+    InMemoryDatabase live(16);
+    Populate(live);
+    ArchivedDatabase db(&live, dir);
+    EXPECT_EQ(db.ArchivedThrough(), 0);
+
+    Archive(live, 0, 120);
+    //a segment that does not continue the archive is left out
+    Archive(live, 150, 200);
+    db.Refresh();
+    EXPECT_EQ(db.ArchivedThrough(), 120);
+    ExpectSameRows(db.GetTransactions(2), live.GetTransactionsSince(2, 0));
+
+    Archive(live, 120, 150);
+    db.Refresh();
+    EXPECT_EQ(db.ArchivedThrough(), 200);
+    ExpectSameRows(db.GetTransactions(2), live.GetTransactionsSince(2, 0));
+}
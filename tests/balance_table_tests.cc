@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "src/cache/balanceTable.h"
+#include "src/db/inMemory.h"
+
+TEST(BalanceTableTest, ReadMissesUntilPublished) {
+    BalanceTable table(16);
+    double balance;
+    EXPECT_FALSE(table.Read(1, &balance));
+
+    EXPECT_TRUE(table.Publish(1, 100.0, 0));
+    int version;
+    ASSERT_TRUE(table.Read(1, &balance, &version));
+    EXPECT_DOUBLE_EQ(balance, 100.0);
+    EXPECT_EQ(version, 0);
+}
+
+//late or duplicate updates never move an entry backwards
+TEST(BalanceTableTest, OlderVersionsAreDropped) {
+    BalanceTable table(16);
+    table.Publish(1, 50.0, 7);
+    table.Publish(1, 80.0, 5);
+    table.Publish(1, 90.0, 7);
+
+    double balance;
+    ASSERT_TRUE(table.Read(1, &balance));
+    EXPECT_DOUBLE_EQ(balance, 50.0);
+
+    table.Publish(1, 60.0, 8);
+    ASSERT_TRUE(table.Read(1, &balance));
+    EXPECT_DOUBLE_EQ(balance, 60.0);
+}
+
+//after a clear any version is taken again
+TEST(BalanceTableTest, ClearForgetsEveryBalance) {
+    BalanceTable table(16);
+    table.Publish(1, 50.0, 7);
+    table.Publish(2, 20.0, 3);
+    table.Clear();
+
+    double balance;
+    EXPECT_FALSE(table.Read(1, &balance));
+    EXPECT_FALSE(table.Read(2, &balance));
+    table.Publish(1, 40.0, 6);
+    int version;
+    ASSERT_TRUE(table.Read(1, &balance, &version));
+    EXPECT_DOUBLE_EQ(balance, 40.0);
+    EXPECT_EQ(version, 6);
+}
+
+//a bypassed table keeps taking updates but serves none until it is cleared
+TEST(BalanceTableTest, BypassMissesUntilClear) {
+    BalanceTable table(16);
+    table.Publish(1, 50.0, 7);
+    table.Bypass();
+
+    double balance;
+    EXPECT_FALSE(table.Read(1, &balance));
+    EXPECT_TRUE(table.Publish(2, 20.0, 3));
+    EXPECT_FALSE(table.Read(2, &balance));
+    table.Clear();
+    EXPECT_FALSE(table.Read(1, &balance));
+    table.Publish(1, 40.0, 8);
+    ASSERT_TRUE(table.Read(1, &balance));
+    EXPECT_DOUBLE_EQ(balance, 40.0);
+}
+
+TEST(BalanceTableTest, FullTableStopsCaching) {
+    BalanceTable table(4);
+    int published = 0;
+    for (int user_id = 1; user_id <= 64; ++user_id) {
+        published += table.Publish(user_id, user_id, 1);
+    }
+    EXPECT_EQ(published, 16);
+    double balance;
+    EXPECT_TRUE(table.Read(1, &balance));
+}
+
+//a reader never sees a balance paired with another update's version
+TEST(BalanceTableTest, ReadersSeeConsistentPairs) {
+    BalanceTable table(16);
+    table.Publish(1, 0.0, 0);
+    std::atomic<bool> done{false};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 2; ++t) {
+        writers.emplace_back([&table, t] {
+            for (int version = 1 + t; version <= 20000; version += 2) {
+                table.Publish(1, version * 10.0, version);
+            }
+        });
+    }
+    std::thread reader([&table, &done] {
+        int last = 0;
+        while (!done.load()) {
+            double balance;
+            int version;
+            ASSERT_TRUE(table.Read(1, &balance, &version));
+            EXPECT_DOUBLE_EQ(balance, version * 10.0);
+            EXPECT_GE(version, last);
+            last = version;
+        }
+    });
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    done = true;
+    reader.join();
+
+    int version;
+    double balance;
+    table.Read(1, &balance, &version);
+    EXPECT_EQ(version, 20000);
+}
+
+//the engines report every committed balance with a growing version
+TEST(BalanceTableTest, FedByBalanceObserver) {
+    InMemoryDatabase db(16, 4);
+    db.CreateAccount(1, 100.0);
+    db.CreateAccount(2, 100.0);
+    BalanceTable table(16);
+    db.SetBalanceObserver([&table](int user_id, double balance, int version) {
+        table.Publish(user_id, balance, version);
+    });
+
+    db.TransferMoney(1, 2, 30.0);
+    db.DepositMoney(1, 5.0);
+    EXPECT_EQ(db.WithdrawMoney(2, 500.0), 1);
+
+    double balance;
+    int version;
+    ASSERT_TRUE(table.Read(1, &balance, &version));
+    EXPECT_DOUBLE_EQ(balance, 75.0);
+    EXPECT_EQ(version, 2);
+    ASSERT_TRUE(table.Read(2, &balance, &version));
+    EXPECT_DOUBLE_EQ(balance, 130.0);
+    EXPECT_EQ(version, 1);
+
+    int stored;
+    EXPECT_DOUBLE_EQ(db.GetVersionedBalance(1, &stored).first, 75.0);
+    EXPECT_EQ(stored, 2);
+}
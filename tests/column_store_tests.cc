@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+#include "src/analytics/columnStore.h"
+
+namespace {
+
+// four sealed blocks with different column widths plus an open block; the
+// third block has amounts that are not whole cents
+std::vector<LedgerRecord> MakeLedger() {
+    const int64_t steps[] = {0, 1, 1000, 1000000000, 7};
+    const int users[] = {50, 100000, 50, 300, 50};
+    std::vector<LedgerRecord> records;
+    int64_t time_us = 1700000000000000;
+    for (int block = 0; block < 5; ++block) {
+        size_t rows = block < 4 ? ColumnStore::kBlockRows : 1000;
+        for (size_t i = 0; i < rows; ++i) {
+            LedgerRecord record;
+            std::memset(&record, 0, sizeof(record));
+            record.transaction_id = static_cast<int32_t>(records.size() + 1);
+            record.sender_id = 1 + (i * 7) % users[block];
+            record.receiver_id = 1 + (i * 13) % users[block];
+            record.status = i % 5 == 0 ? kStatusDeposit : i % 5 == 1 ? kStatusWithdrawal : kStatusTransfer;
+            record.amount = (i % 97) * (block == 2 ? 0.125 : 0.25) + 1;
+            time_us += steps[block];
+            record.time_us = time_us;
+            records.push_back(record);
+        }
+    }
+    return records;
+}
+
+bool Matches(const LedgerRecord& record, const LedgerQuery& query) {
+    if (record.time_us < query.from_us || record.time_us >= query.to_us) {
+        return false;
+    }
+    if (query.user_id == 0) {
+        return true;
+    }
+    if (query.direction == HistoryFilter::Sent) {
+        return record.sender_id == query.user_id && record.status != kStatusDeposit;
+    }
+    if (query.direction == HistoryFilter::Received) {
+        return record.receiver_id == query.user_id && record.status != kStatusWithdrawal;
+    }
+    return record.sender_id == query.user_id || record.receiver_id == query.user_id;
+}
+
+std::vector<LedgerQuery> Queries(const std::vector<LedgerRecord>& records) {
+    std::vector<LedgerQuery> queries(6);
+    queries[1].from_us = records[5000].time_us;
+    queries[1].to_us = records[14000].time_us;
+    queries[2].user_id = 8;
+    queries[3].user_id = 8;
+    queries[3].direction = HistoryFilter::Sent;
+    queries[4].user_id = 8;
+    queries[4].direction = HistoryFilter::Received;
+    queries[4].from_us = records[3000].time_us;
+    queries[5].user_id = 99999;
+    return queries;
+}
+
+}
+
+class ColumnStoreTest : public ::testing::TestWithParam<ScanIsa> {
+protected:
+    void SetUp() override {
+        if (GetParam() == ScanIsa::Avx2 && BestScanIsa() != ScanIsa::Avx2) {
+            GTEST_SKIP() << "no AVX2 on this CPU";
+        }
+        records = MakeLedger();
+        for (const LedgerRecord& record : records) {
+            store.Append(record);
+        }
+    }
+
+    std::vector<LedgerRecord> records;
+    ColumnStore store{GetParam()};
+};
+
+TEST_P(ColumnStoreTest, RowsRoundTrip) {
+    ASSERT_EQ(store.Size(), records.size());
+    EXPECT_LT(store.EncodedBytes(), 4 * ColumnStore::kBlockRows * sizeof(LedgerRecord));
+
+    std::vector<LedgerRecord> out = store.Find({});
+    ASSERT_EQ(out.size(), records.size());
+    EXPECT_EQ(std::memcmp(out.data(), records.data(), records.size() * sizeof(LedgerRecord)), 0);
+}
+
+//amounts are multiples of 1/8, so every summation order is exact
+TEST_P(ColumnStoreTest, AggregatesMatchRowScan) {
+    for (const LedgerQuery& query : Queries(records)) {
+        LedgerTotals expected;
+        std::vector<int> ids;
+        for (const LedgerRecord& record : records) {
+            if (Matches(record, query)) {
+                expected.count++;
+                expected.amount += record.amount;
+                ids.push_back(record.transaction_id);
+            }
+        }
+        LedgerTotals totals = store.Sum(query);
+        EXPECT_EQ(totals.count, expected.count);
+        EXPECT_EQ(totals.amount, expected.amount);
+
+        std::vector<LedgerRecord> found = store.Find(query);
+        ASSERT_EQ(found.size(), ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            EXPECT_EQ(found[i].transaction_id, ids[i]);
+        }
+    }
+}
+
+TEST_P(ColumnStoreTest, HistogramMatchesRowScan) {
+    LedgerQuery query;
+    query.from_us = records[4000].time_us;
+    const int64_t bucket_us = 1000000000;
+    std::vector<LedgerTotals> expected(64);
+    for (const LedgerRecord& record : records) {
+        if (Matches(record, query) && (record.time_us - query.from_us) / bucket_us < 64) {
+            expected[(record.time_us - query.from_us) / bucket_us].count++;
+            expected[(record.time_us - query.from_us) / bucket_us].amount += record.amount;
+        }
+    }
+    std::vector<LedgerTotals> histogram = store.Histogram(query, bucket_us, 64);
+    ASSERT_EQ(histogram.size(), 64);
+    for (size_t i = 0; i < 64; ++i) {
+        EXPECT_EQ(histogram[i].count, expected[i].count) << i;
+        EXPECT_EQ(histogram[i].amount, expected[i].amount) << i;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Isas, ColumnStoreTest, ::testing::Values(ScanIsa::Scalar, ScanIsa::Avx2));
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <csignal>
+#include <fstream>
+#include <sys/resource.h>
+#include <thread>
+#include "src/db/crc32c.h"
+#include "src/db/durable.h"
+#include "src/db/snapshot.h"
+#include "src/db/wal.h"
+#include "temporaryDirectory.h"
+
+class DurableDatabaseTest : public ::testing::Test {
+protected:
+    std::unique_ptr<DurableDatabase> Open() {
+        return std::make_unique<DurableDatabase>(dir, 64, 0, 4);
+    }
+
+    TemporaryDirectory temporary{"durable_test"};
+    std::string dir = temporary.Path();
+};
+
+TEST(Crc32cTest, KnownVector) {
+    EXPECT_EQ(Crc32c("123456789", 9), 0xE3069283u);
+    EXPECT_EQ(Crc32c("56789", 5, Crc32c("1234", 4)), 0xE3069283u);
+}
+
+//state comes back from the WAL alone
+TEST_F(DurableDatabaseTest, RecoversFromWal) {
+    {
+        auto db = Open();
+        db->CreateAccount(1, 1000.0);
+        db->CreateAccount(2, 500.0);
+        EXPECT_EQ(db->TransferMoney(1, 2, 100.0), 0);
+        EXPECT_EQ(db->TransferMoney(1, 2, 10000.0), 3);
+        db->DepositMoney(2, 50.0);
+        EXPECT_EQ(db->WithdrawMoney(1, 200.0), 0);
+    }
+    auto db = Open();
+    EXPECT_EQ(db->AccountCount(), 2);
+    EXPECT_DOUBLE_EQ(db->GetBalance(1).first, 700.0);
+    EXPECT_DOUBLE_EQ(db->GetBalance(2).first, 650.0);
+
+    auto history = db->GetTransactions(2);
+    ASSERT_EQ(history.size(), 2);
+    EXPECT_EQ(history[0].status, "transfer");
+    EXPECT_EQ(history[1].status, "deposit");
+
+    //new ids continue after the replayed ones
+    db->DepositMoney(1, 1.0);
+    EXPECT_GT(db->GetTransactions(1).back().transaction_id, history[1].transaction_id);
+}
+
+//snapshot plus the WAL written after it
+TEST_F(DurableDatabaseTest, RecoversFromSnapshotAndWalTail) {
+    {
+        auto db = Open();
+        db->CreateAccount(1, 1000.0);
+        db->CreateAccount(2, 500.0);
+        db->TransferMoney(1, 2, 100.0);
+        db->Checkpoint();
+        db->TransferMoney(2, 1, 30.0);
+    }
+    EXPECT_EQ(ListSnapshots(dir).size(), 1);
+    EXPECT_EQ(ListWalFiles(dir).size(), 1);
+
+    auto db = Open();
+    EXPECT_DOUBLE_EQ(db->GetBalance(1).first, 930.0);
+    EXPECT_DOUBLE_EQ(db->GetBalance(2).first, 570.0);
+    auto history = db->GetTransactions(1);
+    ASSERT_EQ(history.size(), 2);
+    EXPECT_LT(history[0].transaction_id, history[1].transaction_id);
+    EXPECT_EQ(history[0].timestamp, db->GetTransactions(2)[0].timestamp);
+}
+
+//a transfer that spends a deposit is logged after it, so every LSN prefix
+//of the WAL replays without overdrawing
+TEST_F(DurableDatabaseTest, WalOrderFollowsDependencies) {
+    {
+        auto db = Open();
+        db->CreateAccount(1, 0.0);
+        db->CreateAccount(2, 0.0);
+        std::thread depositor([&db] {
+            for (int i = 0; i < 2000; ++i) {
+                db->DepositMoney(1, 1.0);
+            }
+        });
+        std::thread spender([&db] {
+            for (int spent = 0; spent < 2000;) {
+                if (db->TransferMoney(1, 2, 1.0) == 0) {
+                    spent++;
+                }
+            }
+        });
+        depositor.join();
+        spender.join();
+    }
+    std::vector<WalEntry> entries;
+    for (const auto& file : ListWalFiles(dir)) {
+        for (const WalEntry& entry : ReadWalFile(file.second)) {
+            entries.push_back(entry);
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const WalEntry& a, const WalEntry& b) {
+        return a.lsn < b.lsn;
+    });
+    double balance = 0;
+    for (const WalEntry& entry : entries) {
+        if (entry.type == WalEntry::kMutation) {
+            balance += entry.record.receiver_id == 1 ? entry.record.amount : -entry.record.amount;
+            ASSERT_GE(balance, 0.0) << entry.lsn;
+        }
+    }
+    EXPECT_DOUBLE_EQ(balance, 0.0);
+}
+
+//a torn last entry is dropped, everything before it survives
+TEST_F(DurableDatabaseTest, IgnoresTornWalTail) {
+    {
+        auto db = Open();
+        db->CreateAccount(1, 1000.0);
+        db->DepositMoney(1, 10.0);
+    }
+    std::string wal = ListWalFiles(dir).back().second;
+    std::ofstream(wal, std::ios::binary | std::ios::app) << "\x30\x00\x00\x00garbage";
+
+    auto db = Open();
+    EXPECT_DOUBLE_EQ(db->GetBalance(1).first, 1010.0);
+}
+
+//once a write fails nothing more is acknowledged or accepted
+TEST_F(DurableDatabaseTest, WalStopsAfterFailedWrite) {
+    WalWriter wal(dir, 1, 0);
+    LedgerRecord record = {};
+    wal.WaitDurable(wal.Append(WalEntry::kMutation, record));
+
+    // writes past the file size limit fail with EFBIG once SIGXFSZ is ignored
+    struct rlimit saved;
+    ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &saved), 0);
+    struct rlimit limit = saved;
+    limit.rlim_cur = 4 * (8 + sizeof(WalEntry));
+    auto handler = std::signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+    int acknowledged = 0;
+    bool failed = false;
+    for (int i = 0; i < 16 && !failed; ++i) {
+        try {
+            wal.WaitDurable(wal.Append(WalEntry::kMutation, record));
+            acknowledged++;
+        }
+        catch (const std::runtime_error&) {
+            failed = true;
+        }
+    }
+    setrlimit(RLIMIT_FSIZE, &saved);
+    std::signal(SIGXFSZ, handler);
+
+    EXPECT_TRUE(failed);
+    EXPECT_EQ(acknowledged, 3);
+    EXPECT_THROW(wal.Append(WalEntry::kMutation, record), std::runtime_error);
+    EXPECT_THROW(wal.Rotate(), std::runtime_error);
+    EXPECT_EQ(ReadWalFile(ListWalFiles(dir).back().second).size(), 4u);
+}
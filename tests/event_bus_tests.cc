@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "src/events/eventBus.h"
+
+static AccountEvent MakeEvent(int user_id, int transaction_id) {
+    return {user_id, 100.0, {transaction_id, user_id, 2, 10.0, "2025-01-01", "transfer"}};
+}
+
+class EventBusTest : public ::testing::Test {
+protected:
+    EventBus bus{4};
+};
+
+//delivered to subscribers of the user only
+TEST_F(EventBusTest, PublishReachesSubscriber) {
+    auto subscription = bus.Subscribe(1, 0);
+    bus.Publish(MakeEvent(1, 5));
+    bus.Publish(MakeEvent(2, 6));
+
+    AccountEvent event;
+    ASSERT_TRUE(subscription->Pop(event, 10));
+    EXPECT_EQ(event.transaction.transaction_id, 5);
+    EXPECT_FALSE(subscription->Pop(event, 10));
+}
+
+//same transaction from the local path and NOTIFY is queued once
+TEST_F(EventBusTest, DuplicateTransactionsSkipped) {
+    auto subscription = bus.Subscribe(1, 3);
+    bus.Publish(MakeEvent(1, 3));
+    bus.Publish(MakeEvent(1, 4));
+    bus.Publish(MakeEvent(1, 4));
+
+    AccountEvent event;
+    ASSERT_TRUE(subscription->Pop(event, 10));
+    EXPECT_EQ(event.transaction.transaction_id, 4);
+    EXPECT_FALSE(subscription->Pop(event, 10));
+    EXPECT_EQ(bus.Watermark(1), 4);
+}
+
+//slow consumer is cut off instead of growing the queue
+TEST_F(EventBusTest, FullQueueOverflows) {
+    auto subscription = bus.Subscribe(1, 0);
+    for (int id = 1; id <= 5; ++id) {
+        bus.Publish(MakeEvent(1, id));
+    }
+
+    AccountEvent event;
+    EXPECT_TRUE(subscription->Overflowed());
+    EXPECT_FALSE(subscription->Pop(event, 10));
+}
+
+TEST_F(EventBusTest, UnsubscribeRemovesSubscriber) {
+    auto subscription = bus.Subscribe(1, 0);
+    EXPECT_TRUE(bus.HasSubscribers(1));
+    bus.Unsubscribe(subscription);
+    EXPECT_FALSE(bus.HasSubscribers(1));
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include "src/db/faultInjecting.h"
+#include "src/db/inMemory.h"
+
+using Profile = FaultInjectingDatabase::Profile;
+using Latency = FaultInjectingDatabase::Latency;
+
+class FaultInjectingTest : public ::testing::Test {
+protected:
+    FaultInjectingTest() : ledger(64), db(&ledger) {
+        ledger.CreateAccount(1, 100.0);
+        ledger.CreateAccount(2, 100.0);
+    }
+
+    InMemoryDatabase ledger;
+    FaultInjectingDatabase db;
+};
+
+TEST_F(FaultInjectingTest, ForwardsWithoutFaults) {
+    EXPECT_EQ(db.Describe(), "");
+    EXPECT_EQ(db.TransferMoney(1, 2, 10.0), 0);
+    EXPECT_DOUBLE_EQ(db.GetBalance(2).first, 110.0);
+    EXPECT_EQ(db.GetTransactions(1).size(), 1u);
+    EXPECT_EQ(db.GetLatestTransactionId(2), db.GetTransactions(2)[0].transaction_id);
+}
+
+TEST_F(FaultInjectingTest, ParsesAndDescribesSpecs) {
+    db.Configure("all=lognormal:2:0.5,transfer=bimodal:1:0.01:500@0.02");
+    EXPECT_EQ(db.Describe(), "transfer=bimodal:1:0.01:500@0.02,balance=lognormal:2:0.5,deposit=lognormal:2:0.5,"
+                             "withdraw=lognormal:2:0.5,history=lognormal:2:0.5,summary=lognormal:2:0.5");
+    Profile transfer = db.GetProfile(FaultInjectingDatabase::Transfer);
+    EXPECT_EQ(transfer.latency, Latency::Bimodal);
+    EXPECT_DOUBLE_EQ(transfer.stall_ms, 500);
+    EXPECT_DOUBLE_EQ(transfer.error_rate, 0.02);
+
+    // applied on top, or instead with reset
+    db.Configure("history=fixed:3");
+    EXPECT_EQ(db.GetProfile(FaultInjectingDatabase::History).latency, Latency::Fixed);
+    EXPECT_EQ(db.GetProfile(FaultInjectingDatabase::Balance).latency, Latency::Lognormal);
+    db.Configure("balance=none@0.5", true);
+    EXPECT_EQ(db.Describe(), "balance=none@0.5");
+    db.Configure("", true);
+    EXPECT_EQ(db.Describe(), "");
+}
+
+TEST_F(FaultInjectingTest, RejectsBadSpecsWithoutChanges) {
+    db.Configure("deposit=fixed:1");
+    for (const char* spec : {"deposit", "bogus=fixed:1", "deposit=fixed", "deposit=fixed:-1", "deposit=fixed:1x",
+                             "deposit=lognormal:1", "deposit=none@2", "deposit=bimodal:1:1.5:10",
+                             "history=fixed:1,deposit=slow"}) {
+        EXPECT_THROW(db.Configure(spec, true), std::invalid_argument) << spec;
+    }
+    EXPECT_EQ(db.Describe(), "deposit=fixed:1");
+}
+
+TEST_F(FaultInjectingTest, DrawsLatencyFromTheProfile) {
+    Profile fixed;
+    fixed.latency = Latency::Fixed;
+    fixed.latency_ms = 1.5;
+    EXPECT_EQ(FaultInjectingDatabase::DelayMicros(fixed, 0.9, 3.0), 1500);
+
+    Profile lognormal;
+    lognormal.latency = Latency::Lognormal;
+    lognormal.latency_ms = 2;
+    lognormal.sigma = 0.5;
+    EXPECT_EQ(FaultInjectingDatabase::DelayMicros(lognormal, 0.5, 0.0), 2000);
+    EXPECT_NEAR(FaultInjectingDatabase::DelayMicros(lognormal, 0.5, 2.0), 2000 * std::exp(1.0), 1);
+
+    Profile bimodal;
+    bimodal.latency = Latency::Bimodal;
+    bimodal.latency_ms = 1;
+    bimodal.stall_probability = 0.1;
+    bimodal.stall_ms = 200;
+    EXPECT_EQ(FaultInjectingDatabase::DelayMicros(bimodal, 0.05, 0.0), 200000);
+    EXPECT_EQ(FaultInjectingDatabase::DelayMicros(bimodal, 0.5, 0.0), 1000);
+    EXPECT_EQ(FaultInjectingDatabase::DelayMicros(Profile(), 0.0, 0.0), 0);
+
+    db.Configure("balance=fixed:20");
+    auto start = std::chrono::steady_clock::now();
+    db.GetBalance(1);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+}
+
+TEST_F(FaultInjectingTest, FailedCallsNeverReachTheEngine) {
+    db.Configure("transfer=none@1,withdraw=none@1");
+    EXPECT_THROW(db.TransferMoney(1, 2, 10.0), FaultInjectingDatabase::FaultInjected);
+    EXPECT_THROW(db.WithdrawMoney(1, 10.0), std::runtime_error);
+    EXPECT_DOUBLE_EQ(ledger.GetBalance(1).first, 100.0);
+    EXPECT_TRUE(ledger.GetTransactions(1).empty());
+    db.DepositMoney(1, 5.0);
+    EXPECT_DOUBLE_EQ(db.GetBalance(1).first, 105.0);
+
+    db.Configure("balance=none@0.3");
+    int failed = 0;
+    for (int i = 0; i < 4000; ++i) {
+        try {
+            db.GetBalance(2);
+        }
+        catch (const FaultInjectingDatabase::FaultInjected&) {
+            failed++;
+        }
+    }
+    EXPECT_NEAR(failed, 1200, 150);
+}
@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "src/cache/historyIndex.h"
+#include "src/cache/indexedDatabase.h"
+#include "src/db/inMemory.h"
+
+namespace {
+
+Transaction Row(int transaction_id) {
+    return {transaction_id, 1, 2, 10.0 * transaction_id, "2025-01-01 10:00:00.000000", "transfer"};
+}
+
+std::vector<int> Ids(const HistoryIndex::View& view) {
+    std::vector<int> ids;
+    for (const RecordSpan& span : view.Spans()) {
+        for (const LedgerRecord& record : span) {
+            ids.push_back(record.transaction_id);
+        }
+    }
+    return ids;
+}
+
+bool Load(HistoryIndex& index, int user_id, const std::vector<Transaction>& rows) {
+    int version;
+    index.BeginSync(user_id, &version);
+    return index.Store(user_id, rows, version);
+}
+
+}
+
+TEST(HistoryIndexTest, ServesStoredRowsAfterSince) {
+    HistoryIndex index(1 << 20, 4);
+    HistoryIndex::View view;
+    EXPECT_EQ(index.Read(1, 0, &view), HistoryIndex::Stale);
+
+    Load(index, 1, {Row(1), Row(3), Row(5), Row(7), Row(9), Row(11)});
+    ASSERT_EQ(index.Read(1, 0, &view), HistoryIndex::Hit);
+    EXPECT_EQ(Ids(view), std::vector<int>({1, 3, 5, 7, 9, 11}));
+    ASSERT_EQ(index.Read(1, 4, &view), HistoryIndex::Hit);
+    EXPECT_EQ(Ids(view), std::vector<int>({5, 7, 9, 11}));
+    EXPECT_EQ(view.Spans().size(), 2);
+    ASSERT_EQ(index.Read(1, 11, &view), HistoryIndex::Hit);
+    EXPECT_EQ(view.Size(), 0);
+    view.Release();
+
+    int latest;
+    ASSERT_TRUE(index.Latest(1, &latest));
+    EXPECT_EQ(latest, 11);
+}
+
+//an observed commit makes the account stale until the missing rows are stored
+TEST(HistoryIndexTest, ObserveMarksStale) {
+    HistoryIndex index(1 << 20, 4);
+    index.Observe(1, 3);
+    Load(index, 1, {Row(1), Row(2)});
+
+    HistoryIndex::View view;
+    ASSERT_EQ(index.Read(1, 0, &view), HistoryIndex::Hit);
+    view.Release();
+
+    index.Observe(1, 4);
+    EXPECT_EQ(index.Read(1, 0, &view), HistoryIndex::Stale);
+    int latest;
+    EXPECT_FALSE(index.Latest(1, &latest));
+
+    int version;
+    EXPECT_EQ(index.BeginSync(1, &version), 2);
+    EXPECT_EQ(version, 4);
+    index.Store(1, {Row(2), Row(4)}, version);
+    ASSERT_EQ(index.Read(1, 1, &view), HistoryIndex::Hit);
+    EXPECT_EQ(Ids(view), std::vector<int>({2, 4}));
+}
+
+//a row that shows up after a newer one was stored is not silently skipped
+TEST(HistoryIndexTest, LateRowGivesUpOlderRows) {
+    HistoryIndex index(1 << 20, 4);
+    int early_version;
+    int early_after = index.BeginSync(1, &early_version);
+    int late_version;
+    int late_after = index.BeginSync(1, &late_version);
+    EXPECT_EQ(early_after, late_after);
+    // the early read ran before 4 committed, the late one after
+    index.Store(1, {Row(1), Row(2), Row(3), Row(5)}, early_version);
+    index.Store(1, {Row(1), Row(2), Row(3), Row(4), Row(5), Row(6)}, late_version);
+
+    HistoryIndex::View view;
+    ASSERT_EQ(index.Read(1, 5, &view), HistoryIndex::Hit);
+    EXPECT_EQ(Ids(view), std::vector<int>({6}));
+    ASSERT_EQ(index.Read(1, 2, &view), HistoryIndex::Evicted);
+    EXPECT_EQ(Ids(view), std::vector<int>({6}));
+    view.Release();
+
+    // rows stored again in order are fine
+    Load(index, 1, {Row(6), Row(7)});
+    ASSERT_EQ(index.Read(1, 5, &view), HistoryIndex::Hit);
+    EXPECT_EQ(Ids(view), std::vector<int>({6, 7}));
+}
+
+//the oldest chunk in the process goes first once the limit is reached
+TEST(HistoryIndexTest, EvictsOldestChunks) {
+    // room for two chunks of four rows and two accounts
+    size_t limit = 2 * HistoryIndex::ChunkBytes(4) + 2 * HistoryIndex::EntryBytes();
+    HistoryIndex index(limit, 4);
+    Load(index, 1, {Row(1), Row(2), Row(3), Row(4), Row(5)});
+    Load(index, 2, {Row(6)});
+
+    HistoryIndex::View view;
+    EXPECT_EQ(index.Read(1, 0, &view), HistoryIndex::Evicted);
+    EXPECT_EQ(Ids(view), std::vector<int>({5}));
+    ASSERT_EQ(index.Read(1, 4, &view), HistoryIndex::Hit);
+    EXPECT_EQ(Ids(view), std::vector<int>({5}));
+    ASSERT_EQ(index.Read(2, 0, &view), HistoryIndex::Hit);
+    EXPECT_EQ(Ids(view), std::vector<int>({6}));
+    view.Release();
+    EXPECT_LE(index.MemoryUsed(), limit);
+}
+
+//a read that finds no history leaves nothing behind
+TEST(HistoryIndexTest, UnknownAccountsAreNotKept) {
+    HistoryIndex index(1 << 20, 4);
+    EXPECT_TRUE(Load(index, 1, {Row(1)}));
+    size_t used = index.MemoryUsed();
+    for (int user_id = 100; user_id < 1100; ++user_id) {
+        EXPECT_FALSE(Load(index, user_id, {}));
+    }
+    EXPECT_EQ(index.MemoryUsed(), used);
+    HistoryIndex::View view;
+    EXPECT_EQ(index.Read(100, 0, &view), HistoryIndex::Stale);
+    EXPECT_EQ(index.Read(1, 0, &view), HistoryIndex::Hit);
+}
+
+//accounts count against the limit and leave with their last chunk
+TEST(HistoryIndexTest, AccountsCountAgainstTheLimit) {
+    size_t limit = 4 * HistoryIndex::ChunkBytes(1) + 4 * HistoryIndex::EntryBytes();
+    HistoryIndex index(limit, 1);
+    for (int user_id = 1; user_id <= 100; ++user_id) {
+        Load(index, user_id, {Row(user_id)});
+        EXPECT_LE(index.MemoryUsed(), limit) << user_id;
+    }
+    HistoryIndex::View view;
+    EXPECT_EQ(index.Read(1, 0, &view), HistoryIndex::Stale);
+    ASSERT_EQ(index.Read(100, 0, &view), HistoryIndex::Hit);
+    EXPECT_EQ(Ids(view), std::vector<int>({100}));
+}
+
+class IndexedDatabaseTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        engine.CreateAccount(1, 1000.0);
+        engine.CreateAccount(2, 1000.0);
+        engine.SetBalanceObserver([this](int user_id, double balance, int version) {
+            index.Observe(user_id, version);
+        });
+        for (int i = 0; i < 10; ++i) {
+            engine.TransferMoney(1, 2, 1.0 + i);
+        }
+    }
+
+    InMemoryDatabase engine{16, 4};
+    HistoryIndex index{1 << 20, 4};
+    IndexedDatabase db{&engine, &index};
+};
+
+TEST_F(IndexedDatabaseTest, MatchesEngineAcrossCommits) {
+    EXPECT_EQ(db.GetTransactions(1).size(), 10);
+    engine.DepositMoney(1, 5.0);
+    engine.TransferMoney(2, 1, 3.0);
+
+    auto indexed = db.GetTransactionsSince(1, 4);
+    auto direct = engine.GetTransactionsSince(1, 4);
+    ASSERT_EQ(indexed.size(), direct.size());
+    for (size_t i = 0; i < direct.size(); ++i) {
+        EXPECT_EQ(indexed[i].transaction_id, direct[i].transaction_id);
+        EXPECT_EQ(indexed[i].status, direct[i].status);
+        EXPECT_EQ(indexed[i].timestamp, direct[i].timestamp);
+        EXPECT_DOUBLE_EQ(indexed[i].amount, direct[i].amount);
+    }
+    EXPECT_EQ(db.GetLatestTransactionId(1), engine.GetLatestTransactionId(1));
+}
+
+TEST_F(IndexedDatabaseTest, FiltersLikeTheEngine) {
+    engine.DepositMoney(1, 5.0);
+    HistoryFilter filter;
+    filter.direction = HistoryFilter::Sent;
+    filter.newest_first = true;
+    filter.limit = 3;
+    filter.min_amount = 4.0;
+
+    auto indexed = db.FindTransactions(1, filter);
+    auto direct = engine.FindTransactions(1, filter);
+    ASSERT_EQ(indexed.size(), 3);
+    ASSERT_EQ(indexed.size(), direct.size());
+    for (size_t i = 0; i < direct.size(); ++i) {
+        EXPECT_EQ(indexed[i].transaction_id, direct[i].transaction_id);
+    }
+}
+
+//pages the kept chunks cannot fill go to the engine
+TEST_F(IndexedDatabaseTest, EvictedRowsFallBackToEngine) {
+    HistoryIndex small(2 * HistoryIndex::ChunkBytes(4), 4);
+    IndexedDatabase limited(&engine, &small);
+    EXPECT_EQ(limited.GetTransactions(1).size(), 10);
+
+    HistoryFilter filter;
+    filter.newest_first = true;
+    filter.limit = 2;
+    EXPECT_EQ(limited.FindTransactions(1, filter).size(), 2);
+    filter.limit = 8;
+    EXPECT_EQ(limited.FindTransactions(1, filter).size(), 8);
+    EXPECT_EQ(limited.GetTransactionsSince(1, 0).size(), 10);
+}
+
+//an account without history is answered by the catch up query alone
+TEST_F(IndexedDatabaseTest, EmptyAccountsAreAnswered) {
+    EXPECT_EQ(db.GetTransactions(1).size(), 10);
+    size_t used = index.MemoryUsed();
+    engine.CreateAccount(3, 0.0);
+    EXPECT_TRUE(db.GetTransactions(3).empty());
+    EXPECT_TRUE(db.GetTransactions(404).empty());
+    EXPECT_EQ(db.GetLatestTransactionId(404), 0);
+    HistoryFilter filter;
+    filter.limit = 5;
+    EXPECT_TRUE(db.FindTransactions(404, filter).empty());
+    EXPECT_EQ(index.MemoryUsed(), used);
+}
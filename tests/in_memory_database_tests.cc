@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "src/db/inMemory.h"
+
+class InMemoryDatabaseTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        db.CreateAccount(1, 1000.0);
+        db.CreateAccount(2, 500.0);
+    }
+
+    InMemoryDatabase db{64, 8};
+};
+
+TEST_F(InMemoryDatabaseTest, CreateAccountRejectsDuplicates) {
+    EXPECT_FALSE(db.CreateAccount(1, 10.0));
+    EXPECT_TRUE(db.CreateAccount(3, 10.0));
+    EXPECT_EQ(db.AccountCount(), 3);
+}
+
+//return codes match PostgresDatabase::TransferMoney
+TEST_F(InMemoryDatabaseTest, TransferMoneyReturnCodes) {
+    EXPECT_EQ(db.TransferMoney(1, 2, 100.0), 0);
+    EXPECT_EQ(db.TransferMoney(999, 2, 100.0), 1);
+    EXPECT_EQ(db.TransferMoney(1, 999, 100.0), 2);
+    EXPECT_EQ(db.TransferMoney(1, 2, 10000.0), 3);
+
+    EXPECT_DOUBLE_EQ(db.GetBalance(1).first, 900.0);
+    EXPECT_DOUBLE_EQ(db.GetBalance(2).first, 600.0);
+}
+
+TEST_F(InMemoryDatabaseTest, GetBalanceUserNotFound) {
+    auto result = db.GetBalance(999);
+    EXPECT_EQ(result.second, 1);
+    EXPECT_DOUBLE_EQ(result.first, -1);
+}
+
+TEST_F(InMemoryDatabaseTest, WithdrawMoneyRejectsOverdraftAndNonPositive) {
+    EXPECT_EQ(db.WithdrawMoney(1, 200.0), 0);
+    EXPECT_EQ(db.WithdrawMoney(1, 5000.0), 1);
+    EXPECT_EQ(db.WithdrawMoney(1, 0.0), 1);
+    EXPECT_THROW(db.WithdrawMoney(999, 1.0), std::out_of_range);
+    EXPECT_DOUBLE_EQ(db.GetBalance(1).first, 800.0);
+}
+
+TEST_F(InMemoryDatabaseTest, DepositMoneyUnknownUserThrows) {
+    db.DepositMoney(2, 50.0);
+    EXPECT_DOUBLE_EQ(db.GetBalance(2).first, 550.0);
+    EXPECT_THROW(db.DepositMoney(999, 50.0), std::invalid_argument);
+}
+
+TEST_F(InMemoryDatabaseTest, HistoryIsRecordedForBothSides) {
+    db.DepositMoney(1, 10.0);
+    db.TransferMoney(1, 2, 20.0);
+    db.WithdrawMoney(2, 5.0);
+
+    auto first = db.GetTransactions(1);
+    ASSERT_EQ(first.size(), 2);
+    EXPECT_EQ(first[0].status, "deposit");
+    EXPECT_EQ(first[1].status, "transfer");
+
+    auto second = db.GetTransactionsSince(2, first[1].transaction_id - 1);
+    ASSERT_EQ(second.size(), 2);
+    EXPECT_EQ(second[0].transaction_id, first[1].transaction_id);
+    EXPECT_EQ(second[1].status, "withdrawal");
+}
+
+//opposite transfers between the same pair must not deadlock or lose money
+TEST_F(InMemoryDatabaseTest, ConcurrentTransfersConserveMoney) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([this, t] {
+            for (int i = 0; i < 1000; ++i) {
+                if (t % 2 == 0) {
+                    db.TransferMoney(1, 2, 1.0);
+                }
+                else {
+                    db.TransferMoney(2, 1, 1.0);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_DOUBLE_EQ(db.GetBalance(1).first + db.GetBalance(2).first, 1500.0);
+}
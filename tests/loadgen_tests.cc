@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "src/load/latencyHistogram.h"
+#include "src/load/zipf.h"
+
+TEST(LatencyHistogramTest, PercentilesKeepThreeDigits) {
+    LatencyHistogram histogram;
+    for (int64_t value = 1; value <= 100000; ++value) {
+        histogram.Record(value);
+    }
+    EXPECT_EQ(histogram.Count(), 100000);
+    EXPECT_NEAR(histogram.ValueAtPercentile(50), 50000, 50);
+    EXPECT_NEAR(histogram.ValueAtPercentile(99), 99000, 99);
+    EXPECT_NEAR(histogram.ValueAtPercentile(99.99), 99990, 100);
+    EXPECT_NEAR(histogram.Max(), 100000, 100);
+    EXPECT_NEAR(histogram.Mean(), 50000.5, 50);
+    // small values are exact
+    LatencyHistogram small;
+    small.Record(7, 3);
+    small.Record(1500);
+    EXPECT_EQ(small.ValueAtPercentile(75), 7);
+    EXPECT_EQ(small.Max(), 1500);
+}
+
+TEST(LatencyHistogramTest, MergesAndClampsToHighest) {
+    LatencyHistogram a(1000000);
+    LatencyHistogram b(1000000);
+    a.Record(10);
+    b.Record(20);
+    b.Record(5000000);
+    a.Merge(b);
+    EXPECT_EQ(a.Count(), 3);
+    EXPECT_EQ(a.ValueAtPercentile(0), 10);
+    EXPECT_NEAR(a.Max(), 1000000, 1000);
+}
+
+//one 1000 stall of a client expecting a call every 100 stands for the
+//calls it would have made meanwhile: 900, 800, ... 100
+TEST(LatencyHistogramTest, CorrectsCoordinatedOmission) {
+    LatencyHistogram recorded;
+    recorded.RecordCorrected(1000, 100);
+    EXPECT_EQ(recorded.Count(), 10);
+    EXPECT_EQ(recorded.ValueAtPercentile(10), 100);
+    EXPECT_EQ(recorded.Max(), 1000);
+
+    LatencyHistogram raw;
+    for (int i = 0; i < 99; ++i) {
+        raw.Record(100);
+    }
+    raw.Record(1000);
+    LatencyHistogram corrected = raw.Corrected(100);
+    EXPECT_EQ(corrected.Count(), 109);
+    EXPECT_EQ(raw.ValueAtPercentile(95), 100);
+    EXPECT_GT(corrected.ValueAtPercentile(95), 100);
+    EXPECT_EQ(raw.Corrected(0).Count(), 100);
+}
+
+TEST(ZipfGeneratorTest, SkewsTowardsLowIds) {
+    const int n = 1000;
+    ZipfGenerator zipf(n, 0.99);
+    std::mt19937_64 rng(1);
+    std::vector<int> hits(n + 1);
+    const int draws = 200000;
+    for (int i = 0; i < draws; ++i) {
+        int id = zipf(rng);
+        ASSERT_GE(id, 1);
+        ASSERT_LE(id, n);
+        hits[id]++;
+    }
+    // P(1) / P(2) = 2^0.99, and id 1 takes 1 / zeta(1000, 0.99) of the draws
+    EXPECT_NEAR(double(hits[1]) / hits[2], 1.986, 0.1);
+    EXPECT_NEAR(double(hits[1]) / draws, 0.129, 0.005);
+    EXPECT_GT(hits[1], 10 * hits[50]);
+    EXPECT_EQ(zipf.Draw(0.0), 1);
+    EXPECT_EQ(zipf.Draw(0.999999999), n);
+}
+
+TEST(ZipfGeneratorTest, ThetaZeroIsUniform) {
+    ZipfGenerator uniform(10, 0);
+    std::mt19937_64 rng(2);
+    std::vector<int> hits(11);
+    for (int i = 0; i < 100000; ++i) {
+        hits[uniform(rng)]++;
+    }
+    for (int id = 1; id <= 10; ++id) {
+        EXPECT_NEAR(hits[id], 10000, 500) << id;
+    }
+}
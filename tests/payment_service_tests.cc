@@ -183,6 +183,128 @@ TEST_F(DatabaseTest, WithdrawMoneyDatabaseException) {
     EXPECT_THROW(db.WithdrawMoney(1, 200.0), std::runtime_error);
 }
 
+//FindTransactions
+
+//default implementation filters GetTransactions in memory
+TEST_F(DatabaseTest, FindTransactionsFiltersHistory) {
+    std::vector<Transaction> transactions = {
+    {1, 1, 1, 500.0, "2025-01-01 10:00:00", "deposit"},
+    {2, 1, 2, 100.0, "2025-02-01 10:00:00", "transfer"},
+    {3, 3, 1, 40.0, "2025-02-03 10:00:00", "transfer"},
+    {4, 1, 1, 20.0, "2025-02-04 10:00:00", "withdrawal"},
+    {5, 1, 1, 70.0, "2025-03-01 10:00:00", "withdrawal"}
+    };
+    EXPECT_CALL(db, GetTransactions(1))
+    .WillRepeatedly(Return(transactions));
+
+    HistoryFilter sent_in_february;
+    sent_in_february.direction = HistoryFilter::Sent;
+    sent_in_february.from_timestamp = "2025-02-01";
+    sent_in_february.to_timestamp = "2025-03-01";
+    auto result = db.FindTransactions(1, sent_in_february);
+    ASSERT_EQ(result.size(), 2);
+    EXPECT_EQ(result[0].transaction_id, 2);
+    EXPECT_EQ(result[1].transaction_id, 4);
+
+    HistoryFilter last_withdrawal;
+    last_withdrawal.status = "withdrawal";
+    last_withdrawal.min_amount = 10.0;
+    last_withdrawal.newest_first = true;
+    last_withdrawal.limit = 1;
+    result = db.FindTransactions(1, last_withdrawal);
+    ASSERT_EQ(result.size(), 1);
+    EXPECT_EQ(result[0].transaction_id, 5);
+}
+
+//only rows newer than the watermark
+TEST_F(DatabaseTest, FindTransactionsSinceWatermark) {
+    std::vector<Transaction> transactions = {
+    {1, 1, 2, 100.0, "2025-01-01", "transfer"},
+    {2, 1, 3, 50.0, "2025-01-02", "transfer"},
+    {3, 2, 1, 20.0, "2025-01-03", "transfer"}
+    };
+    EXPECT_CALL(db, GetTransactions(1))
+    .WillRepeatedly(Return(transactions));
+
+    HistoryFilter since;
+    since.since_transaction_id = 1;
+    auto result = db.FindTransactions(1, since);
+    ASSERT_EQ(result.size(), 2);
+    EXPECT_EQ(result[0].transaction_id, 2);
+    EXPECT_EQ(db.GetLatestTransactionId(1), 3);
+}
+
+//newest first pages still move the watermark over every row
+TEST_F(DatabaseTest, FindTransactionsPageNewestFirst) {
+    std::vector<Transaction> transactions = {
+    {1, 1, 2, 100.0, "2025-01-01", "transfer"},
+    {2, 1, 3, 50.0, "2025-01-02", "transfer"},
+    {3, 2, 1, 20.0, "2025-01-03", "transfer"}
+    };
+    EXPECT_CALL(db, GetTransactions(1))
+    .WillRepeatedly(Return(transactions));
+
+    HistoryFilter page;
+    page.newest_first = true;
+    page.limit = 1;
+    std::vector<int> seen;
+    for (int i = 0; i < 3; ++i) {
+        int latest = page.since_transaction_id > 0 ? db.GetLatestTransactionId(1) : 0;
+        int watermark;
+        auto result = db.FindTransactionsPage(1, page, latest, &watermark);
+        ASSERT_EQ(result.size(), 1);
+        seen.push_back(result[0].transaction_id);
+        page.since_transaction_id = watermark;
+    }
+    EXPECT_EQ(seen, std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(page.since_transaction_id, 3);
+
+    page.since_transaction_id = 0;
+    page.limit = 2;
+    int watermark;
+    auto result = db.FindTransactionsPage(1, page, 0, &watermark);
+    ASSERT_EQ(result.size(), 2);
+    EXPECT_EQ(result[0].transaction_id, 2);
+    EXPECT_EQ(result[1].transaction_id, 1);
+    EXPECT_EQ(watermark, 2);
+}
+
+//GetAccountSummary
+
+//default implementation built from GetBalance and GetTransactions
+TEST_F(DatabaseTest, GetAccountSummaryFromHistory) {
+    std::vector<Transaction> transactions = {
+    {1, 1, 1, 500.0, "2025-01-01", "deposit"},
+    {2, 1, 2, 100.0, "2025-01-02", "transfer"},
+    {3, 3, 1, 40.0, "2025-01-03", "transfer"},
+    {4, 1, 1, 20.0, "2025-01-04", "withdrawal"}
+    };
+    EXPECT_CALL(db, GetBalance(1))
+    .WillOnce(Return(std::pair<double, bool>{420.0, 0}));
+    EXPECT_CALL(db, GetTransactions(1))
+    .WillOnce(Return(transactions));
+
+    auto result = db.GetAccountSummary(1, 2, 0);
+    EXPECT_EQ(result.second, 0);
+    EXPECT_DOUBLE_EQ(result.first.balance, 420.0);
+    ASSERT_EQ(result.first.recent.size(), 2);
+    EXPECT_EQ(result.first.recent[0].transaction_id, 4);
+    EXPECT_EQ(result.first.recent[1].transaction_id, 3);
+    EXPECT_EQ(result.first.transaction_count, 4);
+    EXPECT_DOUBLE_EQ(result.first.total_in, 540.0);
+    EXPECT_DOUBLE_EQ(result.first.total_out, 120.0);
+}
+
+//user not found
+TEST_F(DatabaseTest, GetAccountSummaryUserNotFound) {
+    EXPECT_CALL(db, GetBalance(999))
+    .WillOnce(Return(std::pair<double, bool>{-1, 1}));
+    EXPECT_CALL(db, GetTransactions(_)).Times(0);
+
+    auto result = db.GetAccountSummary(999, 10, 30);
+    EXPECT_EQ(result.second, 1);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
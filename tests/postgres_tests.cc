@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include "src/db/postgres.h"
+#include "temporaryPostgres.h"
+
+// PostgresDatabase against the real SQL, on one TemporaryPostgres cluster
+// shared by the suite; every test starts from a fresh schema.sql with
+// accounts 1..10 holding 100 each. Skipped where no cluster can run (no
+// server binaries, or running as root). PAYMENT_TEST_PG_SETTINGS adds
+// postgresql.conf settings to the defaults below.
+
+class PostgresDatabaseTest : public ::testing::Test {
+protected:
+    static constexpr int kAccounts = 10;
+
+    static void SetUpTestSuite() {
+        if (!TemporaryPostgres::Available(&skip_reason)) {
+            return;
+        }
+        // the cluster is thrown away, durability only costs time
+        TemporaryPostgres::Settings settings = {{"fsync", "off"}, {"full_page_writes", "off"}};
+        const char* extra = getenv("PAYMENT_TEST_PG_SETTINGS");
+        for (auto& setting : TemporaryPostgres::ParseSettings(extra ? extra : "")) {
+            settings.push_back(setting);
+        }
+        try {
+            cluster = new TemporaryPostgres(settings);
+        }
+        catch (const std::exception& e) {
+            start_error = e.what();
+        }
+    }
+
+    static void TearDownTestSuite() {
+        delete cluster;
+        cluster = nullptr;
+    }
+
+    void SetUp() override {
+        if (!start_error.empty()) {
+            FAIL() << start_error;
+        }
+        if (cluster == nullptr) {
+            GTEST_SKIP() << skip_reason;
+        }
+        pqxx::connection conn(cluster->ConnectionString());
+        ResetPaymentSchema(conn, PAYMENT_SCHEMA, kAccounts, 100.0);
+        db = std::make_unique<PostgresDatabase>(cluster->ConnectionString(), 4);
+    }
+
+    double Balance(int user_id) {
+        return db->GetBalance(user_id).first;
+    }
+
+    static TemporaryPostgres* cluster;
+    static std::string skip_reason;
+    static std::string start_error;
+    std::unique_ptr<PostgresDatabase> db;
+};
+
+TemporaryPostgres* PostgresDatabaseTest::cluster = nullptr;
+std::string PostgresDatabaseTest::skip_reason;
+std::string PostgresDatabaseTest::start_error;
+
+TEST_F(PostgresDatabaseTest, TransferMovesMoneyAndRecordsOneRow) {
+    EXPECT_EQ(db->TransferMoney(1, 2, 30.0), 0);
+    EXPECT_DOUBLE_EQ(Balance(1), 70.0);
+    EXPECT_DOUBLE_EQ(Balance(2), 130.0);
+    EXPECT_EQ(db->TransferMoney(1, 2, 1000.0), 3);
+    EXPECT_EQ(db->TransferMoney(99, 1, 1.0), 1);
+    EXPECT_EQ(db->TransferMoney(1, 99, 1.0), 2);
+    EXPECT_EQ(db->GetBalance(99).second, 1);
+
+    // exactly the rows written, no empty ones in front of them
+    for (int user_id : {1, 2}) {
+        std::vector<Transaction> history = db->GetTransactions(user_id);
+        ASSERT_EQ(history.size(), 1u) << user_id;
+        EXPECT_GT(history[0].transaction_id, 0);
+        EXPECT_EQ(history[0].sender_id, 1);
+        EXPECT_EQ(history[0].receiver_id, 2);
+        EXPECT_DOUBLE_EQ(history[0].amount, 30.0);
+        EXPECT_EQ(history[0].status, "transfer");
+        EXPECT_FALSE(history[0].timestamp.empty());
+    }
+    EXPECT_TRUE(db->GetTransactions(3).empty());
+}
+
+TEST_F(PostgresDatabaseTest, DepositsAndWithdrawals) {
+    db->DepositMoney(3, 50.0);
+    EXPECT_DOUBLE_EQ(Balance(3), 150.0);
+    EXPECT_EQ(db->WithdrawMoney(3, 20.0), 0);
+    EXPECT_DOUBLE_EQ(Balance(3), 130.0);
+    EXPECT_EQ(db->WithdrawMoney(3, 1000.0), 1);
+    EXPECT_EQ(db->WithdrawMoney(3, -5.0), 1);
+    EXPECT_DOUBLE_EQ(Balance(3), 130.0);
+    // the same exceptions InMemoryDatabase throws for unknown accounts
+    EXPECT_THROW(db->DepositMoney(99, 1.0), pqxx::sql_error);
+    EXPECT_THROW(db->WithdrawMoney(99, 1.0), std::out_of_range);
+
+    std::vector<Transaction> history = db->GetTransactionsSince(3, 0);
+    ASSERT_EQ(history.size(), 2u);
+    EXPECT_EQ(history[0].status, "deposit");
+    EXPECT_EQ(history[1].status, "withdrawal");
+    EXPECT_EQ(history[1].sender_id, 3);
+}
+
+TEST_F(PostgresDatabaseTest, HistoryQueries) {
+    ASSERT_EQ(db->TransferMoney(1, 2, 1.0), 0);
+    ASSERT_EQ(db->TransferMoney(2, 1, 2.0), 0);
+    db->DepositMoney(1, 3.0);
+    ASSERT_EQ(db->TransferMoney(1, 3, 4.0), 0);
+    ASSERT_EQ(db->TransferMoney(2, 3, 5.0), 0);
+
+    std::vector<Transaction> all = db->GetTransactionsSince(1, 0);
+    ASSERT_EQ(all.size(), 4u);
+    for (size_t i = 1; i < all.size(); ++i) {
+        EXPECT_LT(all[i - 1].transaction_id, all[i].transaction_id);
+    }
+    std::vector<Transaction> newer = db->GetTransactionsSince(1, all[1].transaction_id);
+    ASSERT_EQ(newer.size(), 2u);
+    EXPECT_DOUBLE_EQ(newer[0].amount, 3.0);
+
+    HistoryFilter sent;
+    sent.direction = HistoryFilter::Sent;
+    std::vector<Transaction> rows = db->FindTransactions(1, sent);
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_DOUBLE_EQ(rows[0].amount, 1.0);
+    EXPECT_DOUBLE_EQ(rows[1].amount, 4.0);
+
+    HistoryFilter received;
+    received.direction = HistoryFilter::Received;
+    received.newest_first = true;
+    received.limit = 1;
+    rows = db->FindTransactions(1, received);
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0].status, "deposit");
+
+    HistoryFilter large;
+    large.min_amount = 4.0;
+    EXPECT_EQ(db->FindTransactions(3, large).size(), 2u);
+
+    EXPECT_EQ(db->GetLatestTransactionId(1), all.back().transaction_id);
+    EXPECT_EQ(db->GetLatestTransactionId(4), 0);
+    int version = -1;
+    std::pair<double, bool> balance = db->GetVersionedBalance(3, &version);
+    EXPECT_DOUBLE_EQ(balance.first, 109.0);
+    EXPECT_EQ(version, db->GetLatestTransactionId(3));
+    EXPECT_EQ(db->GetVersionedBalance(99, &version).second, 1);
+}
+
+TEST_F(PostgresDatabaseTest, AccountSummaryFromDailyStats) {
+    db->DepositMoney(1, 10.0);
+    ASSERT_EQ(db->WithdrawMoney(1, 4.0), 0);
+    ASSERT_EQ(db->TransferMoney(1, 2, 6.0), 0);
+    ASSERT_EQ(db->TransferMoney(2, 1, 1.0), 0);
+
+    std::pair<AccountSummary, bool> summary = db->GetAccountSummary(1, 2, 30);
+    ASSERT_EQ(summary.second, 0);
+    EXPECT_DOUBLE_EQ(summary.first.balance, 101.0);
+    EXPECT_EQ(summary.first.transaction_count, 4);
+    EXPECT_DOUBLE_EQ(summary.first.total_in, 11.0);
+    EXPECT_DOUBLE_EQ(summary.first.total_out, 10.0);
+    ASSERT_EQ(summary.first.recent.size(), 2u);
+    EXPECT_DOUBLE_EQ(summary.first.recent[0].amount, 1.0);
+    EXPECT_DOUBLE_EQ(summary.first.recent[1].amount, 6.0);
+    EXPECT_EQ(db->GetAccountSummary(99, 2, 30).second, 1);
+}
+
+// the pool runs debits of one account side by side; the balance check of
+// each must see the others, so exactly as many succeed as the money covers
+TEST_F(PostgresDatabaseTest, ConcurrentDebitsNeverOverdraw) {
+    std::atomic<int> withdrawn{0};
+    std::atomic<int> transferred{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            if (t % 2 == 0) {
+                withdrawn += db->WithdrawMoney(1, 30.0) == 0;
+            }
+            else {
+                transferred += db->TransferMoney(1, 2 + t, 30.0) == 0;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(withdrawn + transferred, 3);
+    EXPECT_DOUBLE_EQ(Balance(1), 10.0);
+    EXPECT_EQ(db->GetTransactions(1).size(), 3u);
+}
+
+// opposite transfers may deadlock and get rolled back, but money is never
+// created or lost and every committed transfer left exactly one row
+TEST_F(PostgresDatabaseTest, ConcurrentTransfersConserveMoney) {
+    std::atomic<int> committed{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> account(1, kAccounts);
+            for (int i = 0; i < 50; ++i) {
+                try {
+                    committed += db->TransferMoney(account(rng), account(rng), 1.0) == 0;
+                }
+                catch (const pqxx::transaction_rollback&) {
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double total = 0;
+    size_t rows = 0;
+    for (int user_id = 1; user_id <= kAccounts; ++user_id) {
+        total += Balance(user_id);
+        for (const Transaction& row : db->GetTransactions(user_id)) {
+            rows += row.sender_id == user_id;
+        }
+    }
+    EXPECT_DOUBLE_EQ(total, 100.0 * kAccounts);
+    EXPECT_EQ(rows, size_t(committed.load()));
+}
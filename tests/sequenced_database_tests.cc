@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "src/db/mpscRing.h"
+#include "src/db/sequenced.h"
+
+TEST(MpscRingTest, PushPopInOrderUntilFull) {
+    MpscRing<int> ring(4);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.TryPush(i));
+    }
+    EXPECT_FALSE(ring.TryPush(4));
+
+    int value;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.TryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_TRUE(ring.Empty());
+    EXPECT_FALSE(ring.TryPop(value));
+}
+
+class SequencedDatabaseTest : public ::testing::TestWithParam<WaitStrategy> {
+protected:
+    void SetUp() override {
+        SequencerOptions options;
+        options.ring_size = 2;
+        options.wait = GetParam();
+        options.batch_size = 8;
+        db = std::make_unique<SequencedDatabase>(64, options);
+        db->CreateAccount(1, 1000.0);
+        db->CreateAccount(2, 500.0);
+    }
+
+    std::unique_ptr<SequencedDatabase> db;
+};
+
+//return codes and exceptions match PostgresDatabase
+TEST_P(SequencedDatabaseTest, MatchesPostgresSemantics) {
+    EXPECT_FALSE(db->CreateAccount(1, 10.0));
+    EXPECT_EQ(db->TransferMoney(1, 2, 100.0), 0);
+    EXPECT_EQ(db->TransferMoney(999, 2, 100.0), 1);
+    EXPECT_EQ(db->TransferMoney(1, 999, 100.0), 2);
+    EXPECT_EQ(db->TransferMoney(1, 2, 10000.0), 3);
+    EXPECT_EQ(db->WithdrawMoney(1, 0.0), 1);
+    EXPECT_THROW(db->WithdrawMoney(999, 1.0), std::out_of_range);
+    EXPECT_THROW(db->DepositMoney(999, 1.0), std::invalid_argument);
+    EXPECT_EQ(db->GetBalance(999).second, 1);
+
+    EXPECT_DOUBLE_EQ(db->GetBalance(1).first, 900.0);
+    EXPECT_DOUBLE_EQ(db->GetBalance(2).first, 600.0);
+}
+
+TEST_P(SequencedDatabaseTest, HistoryFollowsSequenceOrder) {
+    db->DepositMoney(1, 10.0);
+    db->TransferMoney(1, 2, 20.0);
+    db->WithdrawMoney(2, 5.0);
+
+    auto first = db->GetTransactions(1);
+    ASSERT_EQ(first.size(), 2);
+    EXPECT_EQ(first[0].transaction_id, 1);
+    EXPECT_EQ(first[1].transaction_id, 2);
+
+    auto second = db->GetTransactionsSince(2, 2);
+    ASSERT_EQ(second.size(), 1);
+    EXPECT_EQ(second[0].transaction_id, 3);
+    EXPECT_EQ(second[0].status, "withdrawal");
+}
+
+//more producers than ring slots, nothing is lost or applied twice
+TEST_P(SequencedDatabaseTest, ConcurrentTransfersConserveMoney) {
+    if (GetParam() == WaitStrategy::Spin && std::thread::hardware_concurrency() < 6) {
+        GTEST_SKIP() << "five spinning threads need a core each";
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([this, t] {
+            for (int i = 0; i < 500; ++i) {
+                if (t % 2 == 0) {
+                    db->TransferMoney(1, 2, 1.0);
+                }
+                else {
+                    db->TransferMoney(2, 1, 1.0);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_DOUBLE_EQ(db->GetBalance(1).first + db->GetBalance(2).first, 1500.0);
+    EXPECT_EQ(db->GetTransactions(1).size(), 2000);
+}
+
+INSTANTIATE_TEST_SUITE_P(WaitStrategies, SequencedDatabaseTest,
+                         ::testing::Values(WaitStrategy::Spin, WaitStrategy::Yield, WaitStrategy::Block));
@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "src/cache/balanceTable.h"
+#include "src/db/sharded.h"
+#include "src/db/spscRing.h"
+
+TEST(SpscRingTest, PushPopInOrderUntilFull) {
+    SpscRing<int> ring(2);
+    EXPECT_TRUE(ring.TryPush(1));
+    EXPECT_TRUE(ring.TryPush(2));
+    EXPECT_FALSE(ring.TryPush(3));
+
+    int value;
+    ASSERT_TRUE(ring.TryPop(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_TRUE(ring.TryPush(3));
+    ASSERT_TRUE(ring.TryPop(value));
+    EXPECT_EQ(value, 2);
+    ASSERT_TRUE(ring.TryPop(value));
+    EXPECT_EQ(value, 3);
+    EXPECT_TRUE(ring.Empty());
+}
+
+//both sides of a cross shard transfer carry the row the receiver wrote
+TEST(LedgerTest, SettleKeepsTheCreditedId) {
+    std::atomic<int> ids{1};
+    Ledger sender_shard(4, &ids);
+    Ledger receiver_shard(4, &ids);
+    sender_shard.CreateAccount(1, 100.0);
+    receiver_shard.CreateAccount(2, 0.0);
+
+    ASSERT_EQ(sender_shard.Reserve(1, 30.0), 0);
+    EXPECT_EQ(sender_shard.Withdraw(1, 80.0, "t"), 1);
+    Transaction credited = receiver_shard.Credit(1, 2, 30.0, "t");
+    sender_shard.Settle(credited);
+
+    int version;
+    EXPECT_DOUBLE_EQ(sender_shard.GetVersionedBalance(1, &version).first, 70.0);
+    EXPECT_EQ(version, credited.transaction_id);
+    std::vector<Transaction> sent = sender_shard.GetTransactionsSince(1, 0);
+    std::vector<Transaction> received = receiver_shard.GetTransactionsSince(2, 0);
+    ASSERT_EQ(sent.size(), 1u);
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(sent[0].transaction_id, received[0].transaction_id);
+}
+
+// users 1 and 5 share shard 1, user 2 lives on shard 2
+class ShardedDatabaseTest : public ::testing::TestWithParam<WaitStrategy> {
+protected:
+    void SetUp() override {
+        ShardOptions options;
+        options.shards = 4;
+        options.ring_size = 4;
+        options.channel_size = 2;
+        options.wait = GetParam();
+        options.batch_size = 8;
+        db = std::make_unique<ShardedDatabase>(64, options);
+        db->CreateAccount(1, 1000.0);
+        db->CreateAccount(2, 500.0);
+        db->CreateAccount(5, 100.0);
+    }
+
+    std::unique_ptr<ShardedDatabase> db;
+};
+
+//return codes match PostgresDatabase within and across shards
+TEST_P(ShardedDatabaseTest, TransferMoneyReturnCodes) {
+    ASSERT_EQ(db->ShardOf(1), db->ShardOf(5));
+    ASSERT_NE(db->ShardOf(1), db->ShardOf(2));
+
+    EXPECT_EQ(db->TransferMoney(1, 5, 10.0), 0);
+    EXPECT_EQ(db->TransferMoney(1, 2, 100.0), 0);
+    EXPECT_EQ(db->TransferMoney(999, 2, 100.0), 1);
+    EXPECT_EQ(db->TransferMoney(1, 999, 100.0), 2);
+    EXPECT_EQ(db->TransferMoney(1, 2, 10000.0), 3);
+    EXPECT_EQ(db->TransferMoney(1, 998, 10000.0), 2);
+
+    EXPECT_DOUBLE_EQ(db->GetBalance(1).first, 890.0);
+    EXPECT_DOUBLE_EQ(db->GetBalance(2).first, 600.0);
+    EXPECT_DOUBLE_EQ(db->GetBalance(5).first, 110.0);
+}
+
+//refused transfers give the reservation back
+TEST_P(ShardedDatabaseTest, RefusedTransferReleasesReservation) {
+    EXPECT_EQ(db->TransferMoney(5, 999, 100.0), 2);
+    EXPECT_EQ(db->WithdrawMoney(5, 100.0), 0);
+    EXPECT_EQ(db->WithdrawMoney(5, 1.0), 1);
+    EXPECT_THROW(db->WithdrawMoney(999, 1.0), std::out_of_range);
+    EXPECT_THROW(db->DepositMoney(999, 1.0), std::invalid_argument);
+}
+
+TEST_P(ShardedDatabaseTest, CrossShardHistoryOnBothSides) {
+    db->DepositMoney(1, 10.0);
+    db->TransferMoney(1, 2, 20.0);
+    db->TransferMoney(2, 1, 5.0);
+
+    auto first = db->GetTransactions(1);
+    ASSERT_EQ(first.size(), 3);
+    EXPECT_EQ(first[0].status, "deposit");
+    EXPECT_LT(first[0].transaction_id, first[1].transaction_id);
+    EXPECT_LT(first[1].transaction_id, first[2].transaction_id);
+
+    auto second = db->GetTransactionsSince(2, first[1].transaction_id);
+    ASSERT_EQ(second.size(), 1);
+    EXPECT_EQ(second[0].sender_id, 2);
+    // one row, one id, on both sides
+    EXPECT_EQ(second[0].transaction_id, first[2].transaction_id);
+    EXPECT_EQ(db->GetTransactions(2)[0].transaction_id, first[1].transaction_id);
+}
+
+//settled transfers report the account's newest version, not their own
+TEST_P(ShardedDatabaseTest, BalanceObserverSeesGrowingVersions) {
+    std::mutex mtx;
+    std::map<int, std::pair<double, int>> latest;
+    db->SetBalanceObserver([&](int user_id, double balance, int version) {
+        std::lock_guard<std::mutex> lock(mtx);
+        EXPECT_GE(version, latest[user_id].second);
+        latest[user_id] = {balance, version};
+    });
+    db->TransferMoney(1, 2, 10.0);
+    db->DepositMoney(1, 5.0);
+    db->TransferMoney(2, 1, 20.0);
+
+    for (int user_id : {1, 2}) {
+        int version;
+        double balance = db->GetVersionedBalance(user_id, &version).first;
+        std::lock_guard<std::mutex> lock(mtx);
+        EXPECT_DOUBLE_EQ(latest[user_id].first, balance);
+        EXPECT_EQ(latest[user_id].second, version);
+    }
+}
+
+//a settled transfer moves the cached balance even when the sender wrote
+//rows of its own while the transfer was in flight
+TEST_P(ShardedDatabaseTest, CrossShardTransfersReachTheBalanceTable) {
+    if (GetParam() == WaitStrategy::Spin && std::thread::hardware_concurrency() < 7) {
+        GTEST_SKIP() << "four shards and two callers spinning need a core each";
+    }
+    BalanceTable table(64);
+    db->SetBalanceObserver([&table](int user_id, double balance, int version) {
+        table.Publish(user_id, balance, version);
+    });
+    std::thread transfers([this] {
+        for (int i = 0; i < 300; ++i) {
+            db->TransferMoney(1, 2, 1.0);
+        }
+    });
+    for (int i = 0; i < 300; ++i) {
+        db->DepositMoney(1, 1.0);
+    }
+    transfers.join();
+
+    for (int user_id : {1, 2}) {
+        int version;
+        double balance = db->GetVersionedBalance(user_id, &version).first;
+        double cached;
+        int cached_version;
+        ASSERT_TRUE(table.Read(user_id, &cached, &cached_version));
+        EXPECT_DOUBLE_EQ(cached, balance) << user_id;
+        EXPECT_EQ(cached_version, version) << user_id;
+
+        std::vector<Transaction> history = db->GetTransactions(user_id);
+        for (size_t i = 1; i < history.size(); ++i) {
+            ASSERT_LT(history[i - 1].transaction_id, history[i].transaction_id) << user_id;
+        }
+    }
+    // the sender lists every transfer under the id the receiver has
+    std::vector<int> sent;
+    for (const Transaction& row : db->GetTransactions(1)) {
+        if (row.status == "transfer") {
+            sent.push_back(row.transaction_id);
+        }
+    }
+    std::vector<int> received;
+    for (const Transaction& row : db->GetTransactions(2)) {
+        received.push_back(row.transaction_id);
+    }
+    EXPECT_EQ(sent, received);
+    EXPECT_DOUBLE_EQ(db->GetBalance(1).first, 1000.0);
+    EXPECT_DOUBLE_EQ(db->GetBalance(2).first, 800.0);
+}
+
+//channels and inboxes much smaller than the load, both directions at once
+TEST_P(ShardedDatabaseTest, ConcurrentTransfersConserveMoney) {
+    if (GetParam() == WaitStrategy::Spin && std::thread::hardware_concurrency() < 9) {
+        GTEST_SKIP() << "four shards and four callers spinning need a core each";
+    }
+    for (int user_id = 10; user_id < 20; ++user_id) {
+        db->CreateAccount(user_id, 100.0);
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([this, t] {
+            for (int i = 0; i < 500; ++i) {
+                db->TransferMoney(10 + (i + t) % 10, 10 + (i * 7 + t * 3) % 10, 15.0);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double total = 0;
+    std::map<int, std::vector<int>> sides;
+    for (int user_id = 10; user_id < 20; ++user_id) {
+        EXPECT_GE(db->GetBalance(user_id).first, 0.0);
+        total += db->GetBalance(user_id).first;
+        std::vector<Transaction> history = db->GetTransactions(user_id);
+        for (size_t i = 0; i < history.size(); ++i) {
+            ASSERT_TRUE(i == 0 || history[i - 1].transaction_id < history[i].transaction_id) << user_id;
+            sides[history[i].transaction_id].push_back(user_id);
+        }
+    }
+    EXPECT_DOUBLE_EQ(total, 1000.0);
+    // a transfer to oneself is listed once, any other on both sides
+    for (const auto& side : sides) {
+        EXPECT_EQ(side.second.size(), side.second[0] == side.second.back() ? 1u : 2u) << side.first;
+    }
+}
+
+//two accounts paying each other across shards at once never deadlock
+TEST_P(ShardedDatabaseTest, OppositeTransfersDoNotDeadlock) {
+    if (GetParam() == WaitStrategy::Spin && std::thread::hardware_concurrency() < 7) {
+        GTEST_SKIP() << "four shards and two callers spinning need a core each";
+    }
+    std::thread forward([this] {
+        for (int i = 0; i < 500; ++i) {
+            db->TransferMoney(1, 2, 1.0);
+        }
+    });
+    for (int i = 0; i < 500; ++i) {
+        db->TransferMoney(2, 1, 1.0);
+    }
+    forward.join();
+    EXPECT_DOUBLE_EQ(db->GetBalance(1).first, 1000.0);
+    EXPECT_DOUBLE_EQ(db->GetBalance(2).first, 500.0);
+    EXPECT_EQ(db->GetTransactions(1).size(), 1000u);
+    EXPECT_EQ(db->GetTransactions(2).size(), 1000u);
+}
+
+INSTANTIATE_TEST_SUITE_P(WaitStrategies, ShardedDatabaseTest,
+                         ::testing::Values(WaitStrategy::Spin, WaitStrategy::Yield, WaitStrategy::Block));
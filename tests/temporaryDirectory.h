@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+
+// An empty directory under /tmp named after prefix, deleted again with
+// everything in it by the destructor.
+class TemporaryDirectory {
+public:
+    // throws runtime_error when the directory cannot be created
+    explicit TemporaryDirectory(const std::string& prefix);
+    ~TemporaryDirectory();
+    TemporaryDirectory(const TemporaryDirectory&) = delete;
+    TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+    const std::string& Path() const { return path; }
+
+private:
+    std::string path;
+};
@@ -0,0 +1,178 @@
+#include "temporaryPostgres.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+std::string BinDir() {
+    if (const char* bin = getenv("PG_BIN")) {
+        return bin;
+    }
+    // Debian keeps the server binaries out of PATH, pg_config knows where
+    std::string out;
+    if (FILE* pipe = popen("pg_config --bindir 2>/dev/null", "r")) {
+        char buffer[512];
+        while (fgets(buffer, sizeof(buffer), pipe)) {
+            out += buffer;
+        }
+        pclose(pipe);
+    }
+    while (!out.empty() && std::isspace(static_cast<unsigned char>(out.back()))) {
+        out.pop_back();
+    }
+    return out;
+}
+
+std::string Binary(const std::string& bin_dir, const char* name) {
+    std::string path = bin_dir + "/" + name;
+    return !bin_dir.empty() && access(path.c_str(), X_OK) == 0 ? path : name;
+}
+
+// args[0] searched in PATH, stdout and stderr appended to log; the exit
+// code, or -1 when it did not run to completion
+int Run(const std::vector<std::string>& args, const std::string& log) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        std::vector<char*> argv;
+        for (const std::string& arg : args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+std::string Tail(const std::string& path, size_t bytes = 2000) {
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string all = text.str();
+    return all.size() > bytes ? all.substr(all.size() - bytes) : all;
+}
+
+}
+
+bool TemporaryPostgres::Available(std::string* reason) {
+    if (geteuid() == 0) {
+        *reason = "initdb refuses to run as root";
+        return false;
+    }
+    if (Run({Binary(BinDir(), "initdb"), "--version"}, "/dev/null") != 0) {
+        *reason = "initdb not found, set PG_BIN to the Postgres server binaries";
+        return false;
+    }
+    return true;
+}
+
+TemporaryPostgres::Settings TemporaryPostgres::ParseSettings(const std::string& text) {
+    Settings settings;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        size_t equal_pos = item.find('=');
+        if (equal_pos == std::string::npos) {
+            throw std::invalid_argument("bad Postgres setting \"" + item + "\"");
+        }
+        settings.emplace_back(item.substr(0, equal_pos), item.substr(equal_pos + 1));
+    }
+    return settings;
+}
+
+TemporaryPostgres::TemporaryPostgres(const Settings& settings) : bin_dir(BinDir()) {
+    char pattern[] = "/tmp/pg_fixture_XXXXXX";
+    if (mkdtemp(pattern) == nullptr) {
+        throw std::runtime_error("cannot create a directory for Postgres");
+    }
+    dir = pattern;
+    std::string data = dir + "/data";
+    std::string log = dir + "/postgres.log";
+    try {
+        if (Run({Binary(bin_dir, "initdb"), "-D", data, "-U", "postgres", "-A", "trust", "-E", "UTF8",
+                 "--no-locale", "--no-sync"}, log) != 0) {
+            throw std::runtime_error("initdb failed:\n" + Tail(log));
+        }
+        // no TCP listener at all: clients come in through the socket in dir,
+        // so the port only has to be unique among this machine's fixtures
+        std::random_device random;
+        port = std::uniform_int_distribution<int>(20000, 60000)(random);
+        {
+            std::ofstream conf(data + "/postgresql.conf", std::ios::app);
+            conf << "\nport = " << port << "\nlisten_addresses = ''\nunix_socket_directories = '" << dir << "'\n";
+            for (const auto& setting : settings) {
+                conf << setting.first << " = '" << setting.second << "'\n";
+            }
+        }
+        if (Run({Binary(bin_dir, "pg_ctl"), "-D", data, "-l", log, "-w", "-t", "60", "start"}, log) != 0) {
+            throw std::runtime_error("pg_ctl start failed:\n" + Tail(log));
+        }
+        running = true;
+
+        std::string server = "host=" + dir + " port=" + std::to_string(port) + " user=postgres";
+        pqxx::connection admin(server + " dbname=postgres");
+        pqxx::nontransaction(admin).exec("CREATE DATABASE payment");
+        conn_str = server + " dbname=payment";
+    }
+    catch (...) {
+        Stop();
+        std::error_code ignored;
+        std::filesystem::remove_all(dir, ignored);
+        throw;
+    }
+}
+
+TemporaryPostgres::~TemporaryPostgres() {
+    Stop();
+    std::error_code ignored;
+    std::filesystem::remove_all(dir, ignored);
+}
+
+// immediate: the cluster is thrown away, nothing needs a checkpoint
+void TemporaryPostgres::Stop() {
+    if (running) {
+        Run({Binary(bin_dir, "pg_ctl"), "-D", dir + "/data", "-m", "immediate", "-w", "stop"}, dir + "/postgres.log");
+        running = false;
+    }
+}
+
+void ResetPaymentSchema(pqxx::connection& conn, const std::string& schema_path, int accounts, double balance) {
+    std::ifstream in(schema_path);
+    if (!in) {
+        throw std::runtime_error("cannot read " + schema_path);
+    }
+    std::stringstream schema;
+    schema << in.rdbuf();
+
+    pqxx::work txn(conn);
+    txn.exec("DROP SCHEMA public CASCADE");
+    txn.exec("CREATE SCHEMA public");
+    txn.exec(schema.str());
+    txn.exec_params("INSERT INTO users (balance) SELECT $2 FROM generate_series(1, $1)", accounts, balance);
+    txn.commit();
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+#include <pqxx/pqxx>
+
+// A private Postgres cluster for one test or benchmark process: initdb into
+// a fresh directory under /tmp, started with pg_ctl on a random port that
+// only listens on a unix socket inside that directory, stopped and deleted
+// again by the destructor. Needs the server binaries, found through
+// PG_BIN, then `pg_config --bindir`, then PATH; initdb refuses to run as
+// root.
+//
+// settings are extra postgresql.conf lines, e.g. {"synchronous_commit",
+// "off"} or {"shared_buffers", "1GB"} for perf runs.
+class TemporaryPostgres {
+public:
+    using Settings = std::vector<std::pair<std::string, std::string>>;
+
+    // throws runtime_error with the tail of the server log on failure
+    explicit TemporaryPostgres(const Settings& settings = {});
+    ~TemporaryPostgres();
+    TemporaryPostgres(const TemporaryPostgres&) = delete;
+    TemporaryPostgres& operator=(const TemporaryPostgres&) = delete;
+
+    // libpq connection string of the empty database "payment"
+    const std::string& ConnectionString() const { return conn_str; }
+    int Port() const { return port; }
+
+    // false, with the reason, when this machine cannot run a cluster at all
+    static bool Available(std::string* reason);
+    // "synchronous_commit=off,shared_buffers=1GB" into Settings
+    static Settings ParseSettings(const std::string& text);
+
+private:
+    void Stop();
+
+    std::string dir;
+    std::string bin_dir;
+    int port = 0;
+    std::string conn_str;
+    bool running = false;
+};
+
+// drops the public schema of conn's database, runs schema_path (schema.sql)
+// and inserts accounts 1..accounts holding balance each
+void ResetPaymentSchema(pqxx::connection& conn, const std::string& schema_path, int accounts, double balance);
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include "src/trace/traceFile.h"
+#include "src/trace/traceRecorder.h"
+#include "temporaryDirectory.h"
+
+class TraceTest : public ::testing::Test {
+protected:
+    TemporaryDirectory temporary{"trace_test"};
+    std::string dir = temporary.Path();
+    std::string path = dir + "/calls.trace";
+};
+
+TEST_F(TraceTest, RecordsAndReadsBackSortedByArrival) {
+    {
+        TraceRecorder recorder(path, 1, 64);
+        EXPECT_TRUE(recorder.Record(0, 0, 300, 40, "abc", 3));
+        EXPECT_TRUE(recorder.Record(2, 5, 100, 1000000, "", 0));
+        recorder.Flush();
+        EXPECT_TRUE(recorder.Record(TraceMethodIndex("/payment.PaymentService/WithdrawMoney"), 9, 200, 7, "\0x", 2));
+    }
+    int64_t start_unix_us = 0;
+    std::vector<TraceEntry> entries = ReadTrace(path, &start_unix_us);
+    EXPECT_GT(start_unix_us, 0);
+    ASSERT_EQ(entries.size(), 3u);
+    EXPECT_EQ(entries[0].arrival_us, 100);
+    EXPECT_EQ(entries[0].method, 2);
+    EXPECT_EQ(entries[0].status, 5);
+    EXPECT_EQ(entries[0].latency_us, 1000000);
+    EXPECT_EQ(entries[0].request, "");
+    EXPECT_EQ(entries[1].method, 4);
+    EXPECT_EQ(entries[1].request, std::string("\0x", 2));
+    EXPECT_EQ(entries[2].arrival_us, 300);
+    EXPECT_EQ(entries[2].request, "abc");
+}
+
+TEST_F(TraceTest, DropsInsteadOfWaiting) {
+    std::string large(TraceRecorder::kMaxRequestBytes + 1, 'x');
+    int64_t recorded = 0;
+    {
+        TraceRecorder recorder(path, 1, 4);
+        EXPECT_FALSE(recorder.Record(0, 0, 1, 1, large.data(), large.size()));
+        EXPECT_TRUE(recorder.Record(0, 0, 2, 1, large.data(), large.size() - 1));
+        // far more than the writer drains between two wakeups
+        for (int i = 0; i < 10000; ++i) {
+            recorded += recorder.Record(1, 0, 3 + i, 1, "", 0);
+        }
+    }
+    EXPECT_LT(recorded, 10000);
+    std::vector<TraceEntry> entries = ReadTrace(path);
+    ASSERT_EQ(entries.size(), size_t(1 + recorded));
+    EXPECT_EQ(entries[0].request.size(), TraceRecorder::kMaxRequestBytes);
+}
+
+TEST_F(TraceTest, SamplesOneCallInN) {
+    TraceRecorder recorder(path, 10, 4);
+    int sampled = 0;
+    for (int i = 0; i < 1000; ++i) {
+        sampled += recorder.Sample();
+    }
+    EXPECT_EQ(sampled, 100);
+    EXPECT_EQ(TraceMethodIndex("/payment.PaymentService/WatchAccount"), -1);
+}
+
+TEST_F(TraceTest, DropsTornTailAndRejectsOtherFiles) {
+    {
+        TraceRecorder recorder(path, 1, 64);
+        recorder.Record(0, 0, 1, 1, "first", 5);
+        recorder.Record(1, 0, 2, 1, "second", 6);
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    std::vector<TraceEntry> entries = ReadTrace(path);
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0].request, "first");
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a trace at all";
+    EXPECT_THROW(ReadTrace(path), std::runtime_error);
+    EXPECT_THROW(ReadTrace(dir + "/missing.trace"), std::runtime_error);
+}
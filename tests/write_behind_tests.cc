@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
+#include <mutex>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <thread>
+#include "src/db/writeBehind.h"
+#include "src/metrics/metrics.h"
+#include "temporaryDirectory.h"
+
+namespace {
+
+// keeps what it was sent; fails the write_failures next calls and holds
+// every call while blocked
+class FakeSink : public WriteBehindSink {
+public:
+    int Checkpoint() override {
+        std::lock_guard<std::mutex> lock(mtx);
+        return rows.empty() ? 0 : rows.back().transaction_id;
+    }
+
+    void Write(const std::vector<LedgerRecord>& batch) override {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this] { return !blocked; });
+        if (write_failures > 0) {
+            write_failures--;
+            throw std::runtime_error("injected failure");
+        }
+        int expected = rows.empty() ? 0 : rows.back().transaction_id;
+        for (const LedgerRecord& row : batch) {
+            EXPECT_EQ(row.transaction_id, ++expected);
+        }
+        rows.insert(rows.end(), batch.begin(), batch.end());
+        batches++;
+    }
+
+    void Fail(int calls) {
+        std::lock_guard<std::mutex> lock(mtx);
+        write_failures = calls;
+    }
+
+    void Block(bool block) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            blocked = block;
+        }
+        cv.notify_all();
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<LedgerRecord> rows;
+    int batches = 0;
+    int write_failures = 0;
+    bool blocked = false;
+};
+
+}
+
+class WriteBehindTest : public ::testing::Test {
+protected:
+    std::unique_ptr<DurableDatabase> Open() {
+        auto local = std::make_unique<DurableDatabase>(dir, 64, 0, 2);
+        if (local->AccountCount() == 0) {
+            local->Import({{1, 1000.0}, {2, 1000.0}, {3, 1000.0}}, {});
+        }
+        return local;
+    }
+
+    TemporaryDirectory temporary{"write_behind_test"};
+    std::string dir = temporary.Path();
+};
+
+//concurrent commits reach the sink once each, in id order
+TEST_F(WriteBehindTest, StreamsEveryCommitInOrder) {
+    auto local = Open();
+    FakeSink sink;
+    {
+        WriteBehindDatabase db(local.get(), &sink, 64, 16, 1);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&db, t] {
+                for (int i = 0; i < 100; ++i) {
+                    if (i % 10 == 0) {
+                        db.DepositMoney(1 + t % 3, 1.0);
+                    }
+                    else {
+                        db.TransferMoney(1 + (t + i) % 3, 1 + (t + i + 1) % 3, 0.25);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        db.Flush();
+        EXPECT_EQ(db.Lag(), 0);
+        EXPECT_EQ(db.GetTransactions(1).size() + db.GetTransactions(2).size() + db.GetTransactions(3).size(), 760);
+    }
+    ASSERT_EQ(sink.rows.size(), 400);
+    EXPECT_LT(sink.batches, 400);
+}
+
+//rows that were committed but never written come back after a restart,
+//rows that were written do not
+TEST_F(WriteBehindTest, ResumesFromCheckpoint) {
+    FakeSink sink;
+    {
+        auto local = Open();
+        WriteBehindDatabase db(local.get(), &sink, 1000, 10, 1);
+        for (int i = 0; i < 25; ++i) {
+            db.TransferMoney(1, 2, 1.0);
+        }
+        db.Flush();
+        sink.Block(true);
+        sink.Fail(1000);
+        for (int i = 0; i < 15; ++i) {
+            db.TransferMoney(2, 3, 1.0);
+        }
+        EXPECT_EQ(db.Lag(), 15);
+        sink.Block(false);
+    }
+    ASSERT_EQ(sink.rows.size(), 25);
+    sink.Fail(0);
+
+    auto local = Open();
+    sink.Block(true);
+    WriteBehindDatabase db(local.get(), &sink, 1000, 10, 1);
+    EXPECT_EQ(db.Lag(), 15);
+    sink.Block(false);
+    db.DepositMoney(3, 5.0);
+    db.Flush();
+    ASSERT_EQ(sink.rows.size(), 41);
+    EXPECT_EQ(sink.rows[40].status, kStatusDeposit);
+}
+
+//with the sink stalled, a commit past max_lag waits for it
+TEST_F(WriteBehindTest, BlocksPastMaxLag) {
+    auto local = Open();
+    FakeSink sink;
+    WriteBehindDatabase db(local.get(), &sink, 8, 4, 1);
+    sink.Block(true);
+    for (int i = 0; i < 8; ++i) {
+        db.DepositMoney(1, 1.0);
+    }
+    std::atomic<bool> done{false};
+    std::thread late([&db, &done] {
+        db.DepositMoney(1, 1.0);
+        done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(done);
+    EXPECT_LE(db.Lag(), 8);
+    sink.Block(false);
+    late.join();
+    db.Flush();
+    EXPECT_EQ(sink.rows.size(), 9);
+}
+
+TEST_F(WriteBehindTest, RejectsLocalLedgerBehindSink) {
+    auto local = Open();
+    FakeSink sink;
+    sink.rows.resize(1);
+    sink.rows[0].transaction_id = 5;
+    EXPECT_THROW(WriteBehindDatabase(local.get(), &sink, 8, 4, 1), std::runtime_error);
+}
+
+//an id the WAL lost is skipped, so the rows before it still drain
+TEST_F(WriteBehindTest, SkipsIdsTheWalLost) {
+    auto local = Open();
+    FakeSink sink;
+    WriteBehindDatabase db(local.get(), &sink, 64, 16, 1);
+    auto& skipped = Metrics::Global().Counter("write_behind.skipped_ids");
+    int64_t skipped_before = skipped.load();
+
+    // writes past the file size limit fail with EFBIG once SIGXFSZ is ignored
+    struct rlimit saved;
+    ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &saved), 0);
+    struct rlimit limit = saved;
+    limit.rlim_cur = 2 * (8 + sizeof(WalEntry));
+    auto handler = std::signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+    int acknowledged = 0;
+    bool failed = false;
+    for (int i = 0; i < 8 && !failed; ++i) {
+        try {
+            db.DepositMoney(1, 1.0);
+            acknowledged++;
+        }
+        catch (const std::runtime_error&) {
+            failed = true;
+        }
+    }
+    setrlimit(RLIMIT_FSIZE, &saved);
+    std::signal(SIGXFSZ, handler);
+
+    ASSERT_TRUE(failed);
+    EXPECT_EQ(acknowledged, 2);
+    EXPECT_EQ(skipped.load() - skipped_before, 1);
+    db.Flush();
+    EXPECT_EQ(db.Lag(), 0);
+    EXPECT_EQ(sink.rows.size(), 2);
+}